@@ -0,0 +1,26 @@
+
+#pragma once
+
+#include "../src/defs.h"
+
+// a collection under measurement, its operations are driven by item indexes - maps turn them into keys via benchmarkKey, lists look items up by their positions instead;
+// remove is called with indexes in the insertion order, so lists just pop the oldest item
+
+typedef struct {
+    const char* const name;
+    const bool synchronizable; // whether the synchronized flag applies
+    const bool fixedSizeAllocations; // whether all internal allocations fit into BENCHMARK_POOL_OBJECT_SIZE so it can run on a pool
+    const bool positional; // whether lookup takes a position rather than an item index
+    void* (^ const create)(const Allocator* const allocator, const bool synchronized);
+    void (^ const insert)(void* const collection, const int index);
+    void* nullable (^ const nullable lookup)(void* const collection, const int index); // null if there's no sublinear lookup
+    int (^ const nullable iterate)(void* const collection); // returns the amount of visited items, null if there's no iterator
+    void (^ const remove)(void* const collection, const int index);
+    void (^ const destroy)(void* const collection);
+} BenchmarkSubject;
+
+extern const int BENCHMARK_POOL_OBJECT_SIZE;
+extern const BenchmarkSubject BENCHMARK_SUBJECTS[];
+extern const int BENCHMARK_SUBJECTS_COUNT;
+
+int benchmarkKey(const int index); // unique, non-negative, scattered
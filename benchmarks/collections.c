@@ -0,0 +1,109 @@
+
+#include "../src/collections/list.h"
+#include "../src/collections/deque.h"
+#include "../src/collections/blockDeque.h"
+#include "../src/collections/treeMap.h"
+#include "../src/collections/bPlusTreeMap.h"
+#include "../src/collections/hashtable.h"
+#include "benchmarks.h"
+
+const int BENCHMARK_POOL_OBJECT_SIZE = 128;
+
+wrapping int benchmarkKey(const int index) {
+    return (int) ((unsigned) index * 2'654'435'761u & 0x7fff'ffffu); // multiplication by an odd number is a bijection modulo 2^31
+}
+
+inline static void* value(const int index) {
+    return (void*) (long) (index + 1); // values must be non-null
+}
+
+const BenchmarkSubject BENCHMARK_SUBJECTS[] = {
+    {
+        "list", true, false, true,
+        ^ void* (const Allocator* const allocator, const bool synchronized) { return listCreate(allocator, synchronized, nullptr); },
+        ^ (void* const list, const int index) { listAddBack(list, value(index)); },
+        ^ void* nullable (void* const list, const int index) { return listGet(list, index); },
+        ^ int (void* const list) {
+            const int size = listSize(list);
+            for (int i = 0; i < size; listGet(list, i++));
+            return size;
+        },
+        ^ (void* const list, const int) { listPopFirst(list); },
+        ^ (void* const list) { listDestroy(list); }
+    },
+    {
+        "deque", true, true, true,
+        ^ void* (const Allocator* const allocator, const bool synchronized) { return dequeCreate(allocator, synchronized, nullptr); },
+        ^ (void* const deque, const int index) { dequePushBack(deque, value(index)); },
+        nullptr, // indexed access walks the nodes
+        nullptr,
+        ^ (void* const deque, const int) { dequePopFirst(deque); },
+        ^ (void* const deque) { dequeDestroy(deque); }
+    },
+    {
+        "blockDeque", true, false, true,
+        ^ void* (const Allocator* const allocator, const bool synchronized) { return blockDequeCreate(allocator, synchronized, nullptr); },
+        ^ (void* const deque, const int index) { blockDequePushBack(deque, value(index)); },
+        ^ void* nullable (void* const deque, const int index) { return blockDequeGet(deque, index, true); },
+        ^ int (void* const deque) {
+            BlockDequeIterator* iterator;
+            blockDequeIterateBegin(deque, iterator);
+            int count = 0;
+            while (blockDequeIterate(iterator)) count++;
+            blockDequeIterateEnd(iterator);
+            return count;
+        },
+        ^ (void* const deque, const int) { blockDequePopFirst(deque); },
+        ^ (void* const deque) { blockDequeDestroy(deque); }
+    },
+    {
+        "treeMap", true, true, false,
+        ^ void* (const Allocator* const allocator, const bool synchronized) { return treeMapCreate(allocator, synchronized, nullptr); },
+        ^ (void* const map, const int index) { treeMapInsert(map, benchmarkKey(index), value(index)); },
+        ^ void* nullable (void* const map, const int index) { return treeMapSearchKey(map, benchmarkKey(index)); },
+        ^ int (void* const map) {
+            TreeMapIterator* iterator;
+            treeMapIterateBegin(map, iterator);
+            int count = 0;
+            while (treeMapIterate(iterator, nullptr)) count++;
+            treeMapIterateEnd(iterator);
+            return count;
+        },
+        ^ (void* const map, const int index) { treeMapDelete(map, benchmarkKey(index)); },
+        ^ (void* const map) { treeMapDestroy(map); }
+    },
+    {
+        "bPlusTreeMap", true, false, false,
+        ^ void* (const Allocator* const allocator, const bool synchronized) { return bPlusTreeMapCreate(allocator, synchronized, nullptr); },
+        ^ (void* const map, const int index) { bPlusTreeMapInsert(map, benchmarkKey(index), value(index)); },
+        ^ void* nullable (void* const map, const int index) { return bPlusTreeMapSearchKey(map, benchmarkKey(index)); },
+        ^ int (void* const map) {
+            BPlusTreeMapIterator* iterator;
+            bPlusTreeMapIterateBegin(map, iterator);
+            int count = 0;
+            while (bPlusTreeMapIterate(iterator, nullptr)) count++;
+            bPlusTreeMapIterateEnd(iterator);
+            return count;
+        },
+        ^ (void* const map, const int index) { bPlusTreeMapDelete(map, benchmarkKey(index)); },
+        ^ (void* const map) { bPlusTreeMapDestroy(map); }
+    },
+    {
+        "hashtable", false, false, false,
+        ^ void* (const Allocator* const allocator, const bool) { return hashtableCreate(allocator, nullptr); },
+        ^ (void* const hashtable, const int index) { hashtablePut(hashtable, (unsigned long) benchmarkKey(index), value(index)); },
+        ^ void* nullable (void* const hashtable, const int index) { return hashtableGet(hashtable, (unsigned long) benchmarkKey(index)); },
+        ^ int (void* const hashtable) {
+            HashtableIterator* iterator;
+            hashtableIterateBegin(hashtable, iterator);
+            int count = 0;
+            while (hashtableIterate(iterator)) count++;
+            hashtableIterateEnd(iterator);
+            return count;
+        },
+        ^ (void* const hashtable, const int index) { hashtableRemove(hashtable, (unsigned long) benchmarkKey(index), false); },
+        ^ (void* const hashtable) { hashtableDestroy(hashtable); }
+    }
+};
+
+const int BENCHMARK_SUBJECTS_COUNT = arraySize(BENCHMARK_SUBJECTS);
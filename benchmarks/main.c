@@ -0,0 +1,176 @@
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../src/utils/poolAllocator.h"
+#include "../src/utils/arenaAllocator.h"
+#include "benchmarks.h"
+
+// usage: benchmarks [maxSize [collectionName]], prints csv to stdout;
+// every combination of collection, synchronization and allocator runs insert, lookup, iterate, remove and mixed (insert + lookup + remove) workloads
+// at sizes from 10 up to the maxSize (each step is 10 times the previous one), small sizes get repeated so each measurement covers about the same amount of work;
+// allocations are counted as calls of the collection's internalAllocator, frees aren't counted
+
+typedef enum {
+    ALLOCATOR_LIBC, // plain malloc, never tracked
+    ALLOCATOR_DEFAULT, // tracked if DEBUG is defined
+    ALLOCATOR_POOL,
+    ALLOCATOR_ARENA
+} AllocatorKind;
+
+typedef enum {
+    WORKLOAD_INSERT,
+    WORKLOAD_LOOKUP,
+    WORKLOAD_ITERATE,
+    WORKLOAD_REMOVE,
+    WORKLOAD_MIXED,
+    WORKLOADS_COUNT
+} Workload;
+
+static const char* const ALLOCATOR_NAMES[] = {"libc", "default", "pool", "arena"};
+static const char* const WORKLOAD_NAMES[] = {"insert", "lookup", "iterate", "remove", "mixed"};
+static const int DEFAULT_MAX_SIZE = 10'000'000, MIN_SIZE = 10, OPERATIONS_PER_MEASUREMENT = 1'000'000;
+static const int POOL_OBJECTS_PER_PAGE = 4096, ARENA_CHUNK_SIZE = 1 << 20;
+
+static const Allocator LIBC_ALLOCATOR = {
+    ^ void* (const unsigned long size) { return malloc(size); },
+    ^ void* (const unsigned long elements, const unsigned long size) { return calloc(elements, size); },
+    ^ void* (void* nullable const pointer, const unsigned long size) { return realloc(pointer, size); },
+    ^ (void* nullable const memory) { free(memory); }
+};
+
+static const Allocator* gUnderlyingAllocator = nullptr;
+static long gAllocations = 0;
+
+static const Allocator COUNTING_ALLOCATOR = {
+    ^ void* (const unsigned long size) {
+        gAllocations++;
+        return gUnderlyingAllocator->malloc(size);
+    },
+    ^ void* (const unsigned long elements, const unsigned long size) {
+        gAllocations++;
+        return gUnderlyingAllocator->calloc(elements, size);
+    },
+    ^ void* (void* nullable const pointer, const unsigned long size) {
+        if (size) gAllocations++;
+        return gUnderlyingAllocator->realloc(pointer, size);
+    },
+    ^ (void* nullable const memory) {
+        gUnderlyingAllocator->free(memory);
+    }
+};
+
+static long nanoTime(void) {
+    struct timespec time;
+    assert(!clock_gettime(CLOCK_MONOTONIC, &time));
+    return time.tv_sec * 1'000'000'000l + time.tv_nsec;
+}
+
+typedef struct {
+    long nanos, allocations, operations;
+} Measurement;
+
+static void measure(Measurement* const measurement, void (^ const body)(void)) {
+    const long allocations = gAllocations, start = nanoTime();
+    body();
+    measurement->nanos += nanoTime() - start;
+    measurement->allocations += gAllocations - allocations;
+}
+
+static void runRound(const BenchmarkSubject* const subject, const bool synchronized, const int size, Measurement* const measurements) {
+    void* const collection = subject->create(&COUNTING_ALLOCATOR, synchronized);
+
+    measure(measurements + WORKLOAD_INSERT, ^{
+        for (int i = 0; i < size; subject->insert(collection, i++));
+    });
+    measurements[WORKLOAD_INSERT].operations += size;
+
+    if (subject->lookup) {
+        measure(measurements + WORKLOAD_LOOKUP, ^{
+            for (int i = 0; i < size; i++) assert(subject->lookup(collection, i));
+        });
+        measurements[WORKLOAD_LOOKUP].operations += size;
+    }
+
+    if (subject->iterate) {
+        measure(measurements + WORKLOAD_ITERATE, ^{
+            assert(subject->iterate(collection) == size);
+        });
+        measurements[WORKLOAD_ITERATE].operations += size;
+    }
+
+    measure(measurements + WORKLOAD_MIXED, ^{ // a sliding window - the size stays the same
+        for (int i = 0; i < size; i++) {
+            subject->insert(collection, size + i);
+            if (subject->lookup) assert(subject->lookup(collection, subject->positional ? size : size + i));
+            subject->remove(collection, i);
+        }
+    });
+    measurements[WORKLOAD_MIXED].operations += size * (subject->lookup ? 3l : 2l);
+
+    measure(measurements + WORKLOAD_REMOVE, ^{
+        for (int i = size; i < size * 2; subject->remove(collection, i++));
+    });
+    measurements[WORKLOAD_REMOVE].operations += size;
+
+    subject->destroy(collection);
+}
+
+static void run(const BenchmarkSubject* const subject, const bool synchronized, const AllocatorKind allocatorKind, const int size) {
+    Measurement measurements[WORKLOADS_COUNT] = {};
+    const int rounds = max(1, OPERATIONS_PER_MEASUREMENT / size);
+
+    PoolAllocator* const pool = allocatorKind == ALLOCATOR_POOL ? poolAllocatorCreate(BENCHMARK_POOL_OBJECT_SIZE, POOL_OBJECTS_PER_PAGE, false, false) : nullptr;
+    ArenaAllocator* const arena = allocatorKind == ALLOCATOR_ARENA ? arenaCreate(ARENA_CHUNK_SIZE) : nullptr;
+
+    switch (allocatorKind) {
+        case ALLOCATOR_LIBC: gUnderlyingAllocator = &LIBC_ALLOCATOR; break;
+        case ALLOCATOR_DEFAULT: gUnderlyingAllocator = DEFAULT_ALLOCATOR; break;
+        case ALLOCATOR_POOL: gUnderlyingAllocator = poolAllocatorAllocator(pool); break;
+        case ALLOCATOR_ARENA: gUnderlyingAllocator = arenaAllocator(arena); break;
+    }
+
+    for (int i = 0; i < rounds; i++) {
+        runRound(subject, synchronized, size, measurements);
+        if (arena) arenaReset(arena);
+    }
+
+    if (pool) poolAllocatorDestroy(pool);
+    if (arena) arenaDestroy(arena);
+
+    for (Workload workload = 0; workload < WORKLOADS_COUNT; workload++) {
+        const Measurement* const measurement = measurements + workload;
+        if (!measurement->operations) continue;
+
+        printf("%s,%s,%s,%d,%s,%.2f,%.3f\n",
+            subject->name, boolToStr(synchronized), ALLOCATOR_NAMES[allocatorKind], size, WORKLOAD_NAMES[workload],
+            (double) measurement->nanos / (double) measurement->operations,
+            (double) measurement->allocations / (double) measurement->operations);
+    }
+}
+
+int main(const int argc, const char* const* const argv) {
+    const int maxSize = argc > 1 ? (int) strtol(argv[1], nullptr, 10) : DEFAULT_MAX_SIZE;
+    const char* nullable const only = argc > 2 ? argv[2] : nullptr;
+    assert(maxSize >= MIN_SIZE && maxSize <= 1'000'000'000);
+
+    printf("collection,synchronized,allocator,size,operation,ns_per_op,allocations_per_op\n");
+
+    for (int i = 0; i < BENCHMARK_SUBJECTS_COUNT; i++) {
+        const BenchmarkSubject* const subject = BENCHMARK_SUBJECTS + i;
+        if (only && strcmp(only, subject->name)) continue;
+
+        for (int synchronized = 0; synchronized <= (subject->synchronizable ? 1 : 0); synchronized++) {
+            for (AllocatorKind allocatorKind = ALLOCATOR_LIBC; allocatorKind <= ALLOCATOR_ARENA; allocatorKind++) {
+                if (allocatorKind == ALLOCATOR_POOL && !subject->fixedSizeAllocations) continue;
+
+                for (long size = MIN_SIZE; size <= maxSize; size *= 10)
+                    run(subject, synchronized, allocatorKind, (int) size);
+            }
+        }
+    }
+
+    checkUnfreedAllocations();
+    return 0;
+}
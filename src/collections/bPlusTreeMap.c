@@ -0,0 +1,555 @@
+
+#include <limits.h>
+#include <emmintrin.h>
+#include "../utils/rwMutex.h"
+#include "bPlusTreeMap.h"
+
+// splits and merges are done top-down while descending (preemptively) so neither parent pointers nor a path stack are needed:
+// a full child is split before entering it on insertion and a minimal child is refilled (borrowed into or merged) before entering it on deletion;
+// separators in internal nodes are only routing hints - children[i] contains keys k so that keys[i - 1] <= k < keys[i]
+
+enum : int {
+    MAX_KEYS = 32, // 128 bytes of keys, both kinds of nodes are ~400 bytes
+    MIN_KEYS = MAX_KEYS / 2 - 1 // non-root nodes never have less keys, two minimal internal nodes together with their separator fit in a single node
+};
+
+typedef struct {
+    int keys[MAX_KEYS]; // sorted, the unused tail is padded with INT_MAX so the simd search needs no masking
+    int count;
+    bool leaf;
+} Node;
+
+typedef struct _Leaf {
+    Node node;
+    void* values[MAX_KEYS];
+    struct _Leaf* nullable previous, * nullable next;
+} Leaf;
+
+typedef struct {
+    Node node;
+    Node* children[MAX_KEYS + 1];
+} Internal;
+
+struct _BPlusTreeMap {
+    const Allocator* const internalAllocator;
+    const Deallocator nullable deallocator;
+    RWMutex* nullable const rwMutex;
+    Node* nullable root; // the only leaf which is allowed to be underfull, freed when emptied
+    int count;
+    bool iterating;
+};
+
+struct _BPlusTreeMapIterator {
+    BPlusTreeMap* const map;
+    Leaf* nullable leaf;
+    int index, last; // last - inclusive bound of the range
+    bool reverse;
+};
+
+const int B_PLUS_TREE_MAP_ITERATOR_SIZE = sizeof(BPlusTreeMapIterator);
+static const int MAX_SIZE = ~0u / 2u; // 0x7fffffff
+
+staticAssert(!(MAX_KEYS % 4));
+
+BPlusTreeMap* bPlusTreeMapCreate(const Allocator* const internalAllocator, const bool synchronized, const Deallocator nullable deallocator) {
+    BPlusTreeMap* const map = internalAllocator->malloc(sizeof *map);
+    unconst(map->internalAllocator) = internalAllocator;
+    unconst(map->deallocator) = deallocator;
+    unconst(map->rwMutex) = synchronized ? rwMutexCreate(RW_MUTEX_FLAG_RECURSIVE | (COLLECTIONS_OPTIMISTIC_READS ? RW_MUTEX_FLAG_OPTIMISTIC_READS : RW_MUTEX_FLAG_NONE)) : nullptr;
+    map->root = nullptr;
+    map->count = 0;
+    map->iterating = false;
+    return map;
+}
+
+static inline void xRwMutexCommand(BPlusTreeMap* const map, const RWMutexCommand command) {
+    if (map->rwMutex) rwMutexCommand(map->rwMutex, command);
+}
+
+int bPlusTreeMapCount(BPlusTreeMap* const map) {
+    if (COLLECTIONS_OPTIMISTIC_READS && map->rwMutex) return rwMutexOptimisticRead(map->rwMutex, map->count);
+
+    xRwMutexCommand(map, RW_MUTEX_COMMAND_READ_LOCK);
+    const int count = map->count;
+    xRwMutexCommand(map, RW_MUTEX_COMMAND_READ_UNLOCK);
+    return count;
+}
+
+static void nodeInit(Node* const node, const bool leaf) {
+    for (int i = 0; i < MAX_KEYS; node->keys[i++] = INT_MAX);
+    node->count = 0;
+    node->leaf = leaf;
+}
+
+static Leaf* leafCreate(const BPlusTreeMap* const map) {
+    Leaf* const leaf = map->internalAllocator->malloc(sizeof *leaf);
+    nodeInit(&leaf->node, true);
+    leaf->previous = leaf->next = nullptr;
+    return leaf;
+}
+
+static Internal* internalCreate(const BPlusTreeMap* const map) {
+    Internal* const internal = map->internalAllocator->malloc(sizeof *internal);
+    nodeInit(&internal->node, false);
+    return internal;
+}
+
+static inline void padKeys(Node* const node) { // after the count has been decreased
+    for (int i = node->count; i < MAX_KEYS && node->keys[i] != INT_MAX; node->keys[i++] = INT_MAX);
+}
+
+static inline int countLess(const Node* const node, const int key) { // amount of keys strictly less than the given one, 4 keys per comparison
+    const __m128i needle = _mm_set1_epi32(key);
+    unsigned mask = 0;
+
+    for (int i = 0; i < (node->count + 3) / 4; i++) {
+        const __m128i keys = _mm_loadu_si128((const __m128i*) node->keys + i);
+        mask |= (unsigned) _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(keys, needle))) << (i * 4);
+    }
+
+    return __builtin_popcount(mask);
+}
+
+static inline int countLessOrEqual(const Node* const node, const int key) {
+    return key == INT_MAX ? node->count : countLess(node, key + 1);
+}
+
+static inline Internal* asInternal(Node* const node) {
+    assert(!node->leaf);
+    return (Internal*) node;
+}
+
+static inline Leaf* asLeaf(Node* const node) {
+    assert(node->leaf);
+    return (Leaf*) node;
+}
+
+static Leaf* nullable findLeaf(const BPlusTreeMap* const map, const int key) {
+    Node* node = map->root;
+    if (!node) return nullptr;
+
+    while (!node->leaf)
+        node = asInternal(node)->children[countLessOrEqual(node, key)];
+
+    return asLeaf(node);
+}
+
+static Leaf* nullable findOutermostLeaf(const BPlusTreeMap* const map, const bool leftmostOrRightmost) {
+    Node* node = map->root;
+    if (!node) return nullptr;
+
+    while (!node->leaf)
+        node = asInternal(node)->children[leftmostOrRightmost ? 0 : node->count];
+
+    return asLeaf(node);
+}
+
+static void internalInsertAt(Internal* const parent, const int index, const int key, Node* const rightChild) {
+    Node* const node = &parent->node;
+    assert(node->count < MAX_KEYS);
+
+    xmemmove(node->keys + index + 1, node->keys + index, (node->count - index) * sizeof(int));
+    xmemmove(parent->children + index + 2, parent->children + index + 1, (node->count - index) * sizeof(Node*));
+
+    node->keys[index] = key;
+    parent->children[index + 1] = rightChild;
+    node->count++;
+}
+
+static void internalRemoveAt(Internal* const parent, const int index) { // removes the key and its right child
+    Node* const node = &parent->node;
+
+    xmemmove(node->keys + index, node->keys + index + 1, (node->count - index - 1) * sizeof(int));
+    xmemmove(parent->children + index + 1, parent->children + index + 2, (node->count - index - 1) * sizeof(Node*));
+
+    node->count--;
+    padKeys(node);
+}
+
+static void splitChild(const BPlusTreeMap* const map, Internal* const parent, const int index) {
+    Node* const child = parent->children[index];
+    assert(child->count == MAX_KEYS);
+
+    const int half = MAX_KEYS / 2;
+    Node* right;
+    int separator;
+
+    if (child->leaf) {
+        Leaf* const leftLeaf = asLeaf(child), * const rightLeaf = leafCreate(map);
+
+        xmemcpy(rightLeaf->node.keys, child->keys + half, (MAX_KEYS - half) * sizeof(int));
+        xmemcpy(rightLeaf->values, leftLeaf->values + half, (MAX_KEYS - half) * sizeof(void*));
+        rightLeaf->node.count = MAX_KEYS - half;
+
+        rightLeaf->next = leftLeaf->next;
+        if (rightLeaf->next) rightLeaf->next->previous = rightLeaf;
+        rightLeaf->previous = leftLeaf;
+        leftLeaf->next = rightLeaf;
+
+        right = &rightLeaf->node;
+        separator = right->keys[0];
+    } else {
+        Internal* const leftInternal = asInternal(child), * const rightInternal = internalCreate(map);
+
+        xmemcpy(rightInternal->node.keys, child->keys + half + 1, (MAX_KEYS - half - 1) * sizeof(int));
+        xmemcpy(rightInternal->children, leftInternal->children + half + 1, (MAX_KEYS - half) * sizeof(Node*));
+        rightInternal->node.count = MAX_KEYS - half - 1;
+
+        right = &rightInternal->node;
+        separator = child->keys[half]; // moves up
+    }
+
+    child->count = half;
+    padKeys(child);
+
+    internalInsertAt(parent, index, separator, right);
+}
+
+void bPlusTreeMapInsert(BPlusTreeMap* const map, const int key, void* const value) {
+    xRwMutexCommand(map, RW_MUTEX_COMMAND_WRITE_LOCK);
+    assert(map->count < MAX_SIZE && !map->iterating);
+
+    if (!map->root) map->root = &leafCreate(map)->node;
+
+    if (map->root->count == MAX_KEYS) { // the tree grows in height only from the root
+        Internal* const root = internalCreate(map);
+        root->children[0] = map->root;
+        splitChild(map, root, 0);
+        map->root = &root->node;
+    }
+
+    Node* node = map->root;
+    while (!node->leaf) {
+        Internal* const internal = asInternal(node);
+        int index = countLessOrEqual(node, key);
+
+        if (internal->children[index]->count == MAX_KEYS) {
+            splitChild(map, internal, index);
+            if (key >= node->keys[index]) index++;
+        }
+
+        node = internal->children[index];
+    }
+
+    Leaf* const leaf = asLeaf(node);
+    const int position = countLess(node, key);
+    assert(position == node->count || node->keys[position] != key);
+
+    xmemmove(node->keys + position + 1, node->keys + position, (node->count - position) * sizeof(int));
+    xmemmove(leaf->values + position + 1, leaf->values + position, (node->count - position) * sizeof(void*));
+    node->keys[position] = key;
+    leaf->values[position] = value;
+    node->count++;
+
+    map->count++;
+    xRwMutexCommand(map, RW_MUTEX_COMMAND_WRITE_UNLOCK);
+}
+
+void* nullable bPlusTreeMapSearchKey(BPlusTreeMap* const map, const int key) {
+    xRwMutexCommand(map, RW_MUTEX_COMMAND_READ_LOCK);
+
+    void* value = nullptr;
+    Leaf* const leaf = findLeaf(map, key);
+
+    if (leaf) {
+        const int position = countLess(&leaf->node, key);
+        if (position < leaf->node.count && leaf->node.keys[position] == key) value = leaf->values[position];
+    }
+
+    xRwMutexCommand(map, RW_MUTEX_COMMAND_READ_UNLOCK);
+    return value;
+}
+
+void* nullable bPlusTreeMapSearchMinOrMax(BPlusTreeMap* const map, const bool minOrMax, int* nullable const key) {
+    xRwMutexCommand(map, RW_MUTEX_COMMAND_READ_LOCK);
+
+    Leaf* const leaf = findOutermostLeaf(map, minOrMax);
+    const int position = leaf ? (minOrMax ? 0 : leaf->node.count - 1) : -1;
+
+    if (key) *key = leaf ? leaf->node.keys[position] : 0;
+    void* const value = leaf ? leaf->values[position] : nullptr;
+
+    xRwMutexCommand(map, RW_MUTEX_COMMAND_READ_UNLOCK);
+    return value;
+}
+
+static Leaf* nullable locate(const BPlusTreeMap* const map, const int key, const bool floorOrCeiling, int* const position) {
+    Leaf* leaf = findLeaf(map, key);
+    if (!leaf) return nullptr;
+
+    if (floorOrCeiling) {
+        *position = countLessOrEqual(&leaf->node, key) - 1;
+        if (*position >= 0) return leaf;
+
+        leaf = leaf->previous; // all keys in the previous leaf are less than the given one
+        if (leaf) *position = leaf->node.count - 1;
+    } else {
+        *position = countLess(&leaf->node, key);
+        if (*position < leaf->node.count) return leaf;
+
+        leaf = leaf->next;
+        *position = 0;
+    }
+
+    return leaf;
+}
+
+static void* nullable floorOrCeiling(BPlusTreeMap* const map, const int key, const bool floorOrCeiling, int* nullable const foundKey) {
+    xRwMutexCommand(map, RW_MUTEX_COMMAND_READ_LOCK);
+
+    int position;
+    Leaf* const leaf = locate(map, key, floorOrCeiling, &position);
+
+    if (foundKey) *foundKey = leaf ? leaf->node.keys[position] : 0;
+    void* const value = leaf ? leaf->values[position] : nullptr;
+
+    xRwMutexCommand(map, RW_MUTEX_COMMAND_READ_UNLOCK);
+    return value;
+}
+
+void* nullable bPlusTreeMapFloor(BPlusTreeMap* const map, const int key, int* nullable const foundKey) {
+    return floorOrCeiling(map, key, true, foundKey);
+}
+
+void* nullable bPlusTreeMapCeiling(BPlusTreeMap* const map, const int key, int* nullable const foundKey) {
+    return floorOrCeiling(map, key, false, foundKey);
+}
+
+static void borrowFromLeft(Internal* const parent, const int index) {
+    Node* const child = parent->children[index], * const left = parent->children[index - 1];
+
+    xmemmove(child->keys + 1, child->keys, child->count * sizeof(int));
+
+    if (child->leaf) {
+        Leaf* const childLeaf = asLeaf(child), * const leftLeaf = asLeaf(left);
+        xmemmove(childLeaf->values + 1, childLeaf->values, child->count * sizeof(void*));
+
+        child->keys[0] = left->keys[left->count - 1];
+        childLeaf->values[0] = leftLeaf->values[left->count - 1];
+        parent->node.keys[index - 1] = child->keys[0];
+    } else {
+        Internal* const childInternal = asInternal(child), * const leftInternal = asInternal(left);
+        xmemmove(childInternal->children + 1, childInternal->children, (child->count + 1) * sizeof(Node*));
+
+        child->keys[0] = parent->node.keys[index - 1]; // rotates through the parent
+        childInternal->children[0] = leftInternal->children[left->count];
+        parent->node.keys[index - 1] = left->keys[left->count - 1];
+    }
+
+    child->count++;
+    left->count--;
+    padKeys(left);
+}
+
+static void borrowFromRight(Internal* const parent, const int index) {
+    Node* const child = parent->children[index], * const right = parent->children[index + 1];
+
+    if (child->leaf) {
+        Leaf* const childLeaf = asLeaf(child), * const rightLeaf = asLeaf(right);
+
+        child->keys[child->count] = right->keys[0];
+        childLeaf->values[child->count] = rightLeaf->values[0];
+        xmemmove(rightLeaf->values, rightLeaf->values + 1, (right->count - 1) * sizeof(void*));
+        xmemmove(right->keys, right->keys + 1, (right->count - 1) * sizeof(int));
+        parent->node.keys[index] = right->keys[0];
+    } else {
+        Internal* const childInternal = asInternal(child), * const rightInternal = asInternal(right);
+
+        child->keys[child->count] = parent->node.keys[index];
+        childInternal->children[child->count + 1] = rightInternal->children[0];
+        parent->node.keys[index] = right->keys[0];
+        xmemmove(right->keys, right->keys + 1, (right->count - 1) * sizeof(int));
+        xmemmove(rightInternal->children, rightInternal->children + 1, right->count * sizeof(Node*));
+    }
+
+    child->count++;
+    right->count--;
+    padKeys(right);
+}
+
+static void merge(const BPlusTreeMap* const map, Internal* const parent, const int index) { // merges the right sibling into the child
+    Node* const left = parent->children[index], * const right = parent->children[index + 1];
+
+    if (left->leaf) {
+        Leaf* const leftLeaf = asLeaf(left), * const rightLeaf = asLeaf(right);
+
+        xmemcpy(left->keys + left->count, right->keys, right->count * sizeof(int));
+        xmemcpy(leftLeaf->values + left->count, rightLeaf->values, right->count * sizeof(void*));
+        left->count += right->count;
+
+        leftLeaf->next = rightLeaf->next;
+        if (leftLeaf->next) leftLeaf->next->previous = leftLeaf;
+    } else {
+        Internal* const leftInternal = asInternal(left), * const rightInternal = asInternal(right);
+
+        left->keys[left->count] = parent->node.keys[index]; // moves down
+        xmemcpy(left->keys + left->count + 1, right->keys, right->count * sizeof(int));
+        xmemcpy(leftInternal->children + left->count + 1, rightInternal->children, (right->count + 1) * sizeof(Node*));
+        left->count += right->count + 1;
+    }
+
+    assert(left->count <= MAX_KEYS);
+    internalRemoveAt(parent, index);
+    map->internalAllocator->free(right);
+}
+
+static int refillChild(const BPlusTreeMap* const map, Internal* const parent, const int index) { // returns the index of the child to descend into
+    const Node
+        * const left = index > 0 ? parent->children[index - 1] : nullptr,
+        * const right = index < parent->node.count ? parent->children[index + 1] : nullptr;
+
+    if (left && left->count > MIN_KEYS) {
+        borrowFromLeft(parent, index);
+        return index;
+    }
+
+    if (right && right->count > MIN_KEYS) {
+        borrowFromRight(parent, index);
+        return index;
+    }
+
+    if (left) {
+        merge(map, parent, index - 1);
+        return index - 1;
+    }
+
+    merge(map, parent, index);
+    return index;
+}
+
+void bPlusTreeMapDelete(BPlusTreeMap* const map, const int key) {
+    xRwMutexCommand(map, RW_MUTEX_COMMAND_WRITE_LOCK);
+    assert(!map->iterating);
+
+    Node* node = map->root;
+    if (!node) {
+        xRwMutexCommand(map, RW_MUTEX_COMMAND_WRITE_UNLOCK);
+        return;
+    }
+
+    while (!node->leaf) {
+        Internal* const internal = asInternal(node);
+
+        int index = countLessOrEqual(node, key);
+        if (internal->children[index]->count <= MIN_KEYS) index = refillChild(map, internal, index);
+
+        Node* const child = internal->children[index];
+
+        if (!node->count) { // the root's last two children have been merged - the tree shrinks in height
+            assert(node == map->root);
+            map->root = child;
+            map->internalAllocator->free(node);
+        }
+
+        node = child;
+    }
+
+    Leaf* const leaf = asLeaf(node);
+    const int position = countLess(node, key);
+
+    if (position == node->count || node->keys[position] != key) {
+        xRwMutexCommand(map, RW_MUTEX_COMMAND_WRITE_UNLOCK);
+        return;
+    }
+
+    void* const value = leaf->values[position];
+
+    xmemmove(node->keys + position, node->keys + position + 1, (node->count - position - 1) * sizeof(int));
+    xmemmove(leaf->values + position, leaf->values + position + 1, (node->count - position - 1) * sizeof(void*));
+    node->count--;
+    padKeys(node);
+
+    map->count--;
+
+    if (!node->count) {
+        assert(node == map->root);
+        map->internalAllocator->free(node);
+        map->root = nullptr;
+    }
+
+    xRwMutexCommand(map, RW_MUTEX_COMMAND_WRITE_UNLOCK);
+
+    if (map->deallocator) map->deallocator(value);
+}
+
+static void iterateBegin(BPlusTreeMap* const map, BPlusTreeMapIterator* const iterator, const int first, const int last) {
+    xRwMutexCommand(map, RW_MUTEX_COMMAND_WRITE_LOCK);
+    assert(!map->iterating);
+    map->iterating = true;
+    xRwMutexCommand(map, RW_MUTEX_COMMAND_WRITE_UNLOCK);
+
+    xRwMutexCommand(map, RW_MUTEX_COMMAND_READ_LOCK);
+
+    unconst(iterator->map) = map;
+    iterator->reverse = first > last;
+    iterator->last = last;
+    iterator->index = 0;
+    iterator->leaf = locate(map, first, iterator->reverse, &iterator->index);
+}
+
+#undef bPlusTreeMapIterateBegin
+void bPlusTreeMapIterateBegin(BPlusTreeMap* const map, BPlusTreeMapIterator* const iterator) {
+    iterateBegin(map, iterator, INT_MIN, INT_MAX);
+}
+
+#undef bPlusTreeMapIterateReverseBegin
+void bPlusTreeMapIterateReverseBegin(BPlusTreeMap* const map, BPlusTreeMapIterator* const iterator) {
+    iterateBegin(map, iterator, INT_MAX, INT_MIN);
+}
+
+#undef bPlusTreeMapIterateRangeBegin
+void bPlusTreeMapIterateRangeBegin(BPlusTreeMap* const map, BPlusTreeMapIterator* const iterator, const int from, const int to) {
+    iterateBegin(map, iterator, from, to);
+}
+
+void* nullable bPlusTreeMapIterate(BPlusTreeMapIterator* const iterator, int* nullable const key) {
+    assert(iterator->map->iterating);
+
+    Leaf* const leaf = iterator->leaf;
+    const int index = iterator->index;
+
+    if (!leaf || (iterator->reverse ? leaf->node.keys[index] < iterator->last : leaf->node.keys[index] > iterator->last)) {
+        iterator->leaf = nullptr;
+        if (key) *key = 0;
+        return nullptr;
+    }
+
+    if (iterator->reverse) {
+        if (--iterator->index < 0 && (iterator->leaf = leaf->previous))
+            iterator->index = iterator->leaf->node.count - 1;
+    } else {
+        if (++iterator->index == leaf->node.count) {
+            iterator->leaf = leaf->next;
+            iterator->index = 0;
+        }
+    }
+
+    if (key) *key = leaf->node.keys[index];
+    return leaf->values[index];
+}
+
+void bPlusTreeMapIterateEnd(BPlusTreeMapIterator* const iterator) {
+    assert(iterator->map->iterating);
+    iterator->map->iterating = false; // still under the read lock, which keeps the writers out - otherwise a waiting one could get in before the flag is cleared
+    xRwMutexCommand(iterator->map, RW_MUTEX_COMMAND_READ_UNLOCK);
+
+    iterator->leaf = nullptr;
+}
+
+static void destroyNode(const BPlusTreeMap* const map, Node* const node) { // recursion depth is the tree's height which is tiny
+    if (node->leaf) {
+        if (map->deallocator)
+            for (int i = 0; i < node->count; map->deallocator(asLeaf(node)->values[i++]));
+    } else
+        for (int i = 0; i <= node->count; destroyNode(map, asInternal(node)->children[i++]));
+
+    map->internalAllocator->free(node);
+}
+
+void bPlusTreeMapDestroy(BPlusTreeMap* const map) {
+    if (map->rwMutex) rwMutexDestroy(map->rwMutex);
+    assert(!map->iterating);
+
+    if (map->root) destroyNode(map, map->root);
+    map->internalAllocator->free(map);
+}
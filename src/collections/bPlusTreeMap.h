@@ -0,0 +1,30 @@
+
+#pragma once
+
+#include "../defs.h"
+
+// B+ tree ordered map - keys are stored contiguously inside wide nodes and are searched via simd, values live in doubly linked leaves,
+// the same shape as the TreeMap's but with far less allocations and pointer chasing, optionally thread-safe, only works with non-null and unique values
+
+typedef struct _BPlusTreeMap BPlusTreeMap;
+typedef struct _BPlusTreeMapIterator BPlusTreeMapIterator;
+
+extern const int B_PLUS_TREE_MAP_ITERATOR_SIZE;
+
+BPlusTreeMap* bPlusTreeMapCreate(const Allocator* const internalAllocator, const bool synchronized, const Deallocator nullable deallocator);
+int bPlusTreeMapCount(BPlusTreeMap* const map);
+void bPlusTreeMapInsert(BPlusTreeMap* const map, const int key, void* const value);
+void* nullable bPlusTreeMapSearchKey(BPlusTreeMap* const map, const int key);
+void* nullable bPlusTreeMapSearchMinOrMax(BPlusTreeMap* const map, const bool minOrMax, int* nullable const key);
+void* nullable bPlusTreeMapFloor(BPlusTreeMap* const map, const int key, int* nullable const foundKey); // the greatest key less than or equal to the given one
+void* nullable bPlusTreeMapCeiling(BPlusTreeMap* const map, const int key, int* nullable const foundKey); // the least key greater than or equal to the given one
+void bPlusTreeMapDelete(BPlusTreeMap* const map, const int key);
+void bPlusTreeMapIterateBegin(BPlusTreeMap* const map, BPlusTreeMapIterator* const iterator); // ascending
+#define bPlusTreeMapIterateBegin(x, y) bPlusTreeMapIterateBegin(x, (y = xalloca2(B_PLUS_TREE_MAP_ITERATOR_SIZE)))
+void bPlusTreeMapIterateReverseBegin(BPlusTreeMap* const map, BPlusTreeMapIterator* const iterator); // descending
+#define bPlusTreeMapIterateReverseBegin(x, y) bPlusTreeMapIterateReverseBegin(x, (y = xalloca2(B_PLUS_TREE_MAP_ITERATOR_SIZE)))
+void bPlusTreeMapIterateRangeBegin(BPlusTreeMap* const map, BPlusTreeMapIterator* const iterator, const int from, const int to); // both inclusive, descending if from > to
+#define bPlusTreeMapIterateRangeBegin(x, y, f, t) bPlusTreeMapIterateRangeBegin(x, (y = xalloca2(B_PLUS_TREE_MAP_ITERATOR_SIZE)), f, t)
+void* nullable bPlusTreeMapIterate(BPlusTreeMapIterator* const iterator, int* nullable const key); // assumed readonly - don't do any write operations while iterating, iteration involves mutex read-locking
+void bPlusTreeMapIterateEnd(BPlusTreeMapIterator* const iterator);
+void bPlusTreeMapDestroy(BPlusTreeMap* const map);
@@ -0,0 +1,294 @@
+
+#include "../utils/rwMutex.h"
+#include "blockDeque.h"
+
+// values are addressed by their position counted from the start of the first block: position = head + index,
+// the block is map[(mapHead + position / BLOCK_SIZE) % mapCapacity] and the offset inside it is position % BLOCK_SIZE
+
+enum : int {
+    BLOCK_SIZE = 64 // values per block, 512 bytes - 8 cache lines
+};
+
+typedef struct {
+    void* values[BLOCK_SIZE];
+} Block;
+
+struct _BlockDeque {
+    const Allocator* const internalAllocator;
+    Block* nullable* nullable map; // circular buffer of blocks
+    int mapHead, mapSize, mapCapacity; // mapCapacity - power of two
+    int head, size; // head - offset of the first value inside the first block
+    Block* nullable spare; // the last released block is kept to avoid allocating a new one when a queue oscillates around a block boundary
+    RWMutex* nullable const rwMutex;
+    const Deallocator nullable deallocator;
+    bool iterating;
+};
+
+struct _BlockDequeIterator {
+    BlockDeque* const deque;
+    int index;
+};
+
+const int BLOCK_DEQUE_ITERATOR_SIZE = sizeof(BlockDequeIterator);
+static const int MAX_SIZE = 1 << 30;
+static const int MIN_MAP_CAPACITY = 8;
+
+staticAssert(!(BLOCK_SIZE & (BLOCK_SIZE - 1)));
+
+BlockDeque* blockDequeCreate(const Allocator* const internalAllocator, const bool synchronized, const Deallocator nullable deallocator) {
+    BlockDeque* const deque = internalAllocator->malloc(sizeof *deque);
+    unconst(deque->internalAllocator) = internalAllocator;
+    deque->map = nullptr;
+    deque->mapHead = deque->mapSize = deque->mapCapacity = 0;
+    deque->head = deque->size = 0;
+    deque->spare = nullptr;
+    unconst(deque->rwMutex) = synchronized ? rwMutexCreate(RW_MUTEX_FLAG_RECURSIVE | (COLLECTIONS_OPTIMISTIC_READS ? RW_MUTEX_FLAG_OPTIMISTIC_READS : RW_MUTEX_FLAG_NONE)) : nullptr;
+    unconst(deque->deallocator) = deallocator;
+    deque->iterating = false;
+    return deque;
+}
+
+static inline void deallocateValue(const BlockDeque* const deque, void* const value) {
+    if (deque->deallocator) deque->deallocator(value);
+}
+
+static inline void xRwMutexCommand(BlockDeque* const deque, const RWMutexCommand command) {
+    if (deque->rwMutex) rwMutexCommand(deque->rwMutex, command);
+}
+
+static inline Block** blockAt(const BlockDeque* const deque, const int blockIndex) {
+    return deque->map + ((deque->mapHead + blockIndex) & (deque->mapCapacity - 1));
+}
+
+static inline void** at(const BlockDeque* const deque, const int index) {
+    const int position = deque->head + index;
+    return (*blockAt(deque, position / BLOCK_SIZE))->values + (position & (BLOCK_SIZE - 1));
+}
+
+static Block* acquireBlock(BlockDeque* const deque) {
+    Block* const block = deque->spare ? deque->spare : deque->internalAllocator->malloc(sizeof(Block));
+    deque->spare = nullptr;
+    return block;
+}
+
+static void releaseBlock(BlockDeque* const deque, Block* const block) {
+    if (!deque->spare) deque->spare = block;
+    else deque->internalAllocator->free(block);
+}
+
+static void ensureMapSlot(BlockDeque* const deque) {
+    if (deque->mapSize < deque->mapCapacity) return;
+
+    const int capacity = max(deque->mapCapacity * 2, MIN_MAP_CAPACITY);
+    Block** const map = deque->internalAllocator->malloc(capacity * sizeof(Block*));
+    for (int i = 0; i < deque->mapSize; map[i] = *blockAt(deque, i), i++);
+
+    deque->internalAllocator->free(deque->map);
+    deque->map = map;
+    deque->mapHead = 0;
+    deque->mapCapacity = capacity;
+}
+
+static void dropFirst(BlockDeque* const deque) { // forgets the first value, releasing its block once it's empty
+    deque->size--;
+    if (++deque->head < BLOCK_SIZE && deque->size) return;
+
+    releaseBlock(deque, *blockAt(deque, 0));
+    deque->mapHead = (deque->mapHead + 1) & (deque->mapCapacity - 1);
+    deque->mapSize--;
+    deque->head = 0;
+}
+
+static void dropLast(BlockDeque* const deque) { // forgets the last value, releasing its block once it's empty
+    deque->size--;
+
+    while (deque->mapSize && (!deque->size || deque->head + deque->size <= (deque->mapSize - 1) * BLOCK_SIZE)) {
+        releaseBlock(deque, *blockAt(deque, deque->mapSize - 1));
+        deque->mapSize--;
+    }
+
+    if (!deque->mapSize) deque->head = 0;
+}
+
+void blockDequePushBack(BlockDeque* const deque, void* const value) {
+    xRwMutexCommand(deque, RW_MUTEX_COMMAND_WRITE_LOCK);
+    assert(deque->size < MAX_SIZE && !deque->iterating);
+
+    if (deque->head + deque->size == deque->mapSize * BLOCK_SIZE) {
+        ensureMapSlot(deque);
+        *blockAt(deque, deque->mapSize++) = acquireBlock(deque);
+    }
+
+    *at(deque, deque->size++) = value;
+    xRwMutexCommand(deque, RW_MUTEX_COMMAND_WRITE_UNLOCK);
+}
+
+void blockDequePushFront(BlockDeque* const deque, void* const value) {
+    xRwMutexCommand(deque, RW_MUTEX_COMMAND_WRITE_LOCK);
+    assert(deque->size < MAX_SIZE && !deque->iterating);
+
+    if (!deque->head) {
+        ensureMapSlot(deque);
+        deque->mapHead = (deque->mapHead - 1) & (deque->mapCapacity - 1);
+        deque->map[deque->mapHead] = acquireBlock(deque);
+        deque->mapSize++;
+        deque->head = BLOCK_SIZE;
+    }
+
+    deque->head--;
+    deque->size++;
+    *at(deque, 0) = value;
+
+    xRwMutexCommand(deque, RW_MUTEX_COMMAND_WRITE_UNLOCK);
+}
+
+void* nullable blockDequeGet(BlockDeque* const deque, const int index, const bool fromStartOrFromEnd) {
+    USED(fromStartOrFromEnd);
+    xRwMutexCommand(deque, RW_MUTEX_COMMAND_READ_LOCK);
+    void* const value = index >= 0 && index < deque->size ? *at(deque, index) : nullptr;
+    xRwMutexCommand(deque, RW_MUTEX_COMMAND_READ_UNLOCK);
+    return value;
+}
+
+int blockDequeSize(BlockDeque* const deque) {
+    if (COLLECTIONS_OPTIMISTIC_READS && deque->rwMutex) return rwMutexOptimisticRead(deque->rwMutex, deque->size);
+
+    xRwMutexCommand(deque, RW_MUTEX_COMMAND_READ_LOCK);
+    const int size = deque->size;
+    xRwMutexCommand(deque, RW_MUTEX_COMMAND_READ_UNLOCK);
+    return size;
+}
+
+void* nullable blockDequePopFirst(BlockDeque* const deque) {
+    xRwMutexCommand(deque, RW_MUTEX_COMMAND_WRITE_LOCK);
+    assert(!deque->iterating);
+
+    if (!deque->size) {
+        xRwMutexCommand(deque, RW_MUTEX_COMMAND_WRITE_UNLOCK);
+        return nullptr;
+    }
+
+    void* const value = *at(deque, 0);
+    dropFirst(deque);
+
+    xRwMutexCommand(deque, RW_MUTEX_COMMAND_WRITE_UNLOCK);
+    return value;
+}
+
+void* nullable blockDequePopLast(BlockDeque* const deque) {
+    xRwMutexCommand(deque, RW_MUTEX_COMMAND_WRITE_LOCK);
+    assert(!deque->iterating);
+
+    if (!deque->size) {
+        xRwMutexCommand(deque, RW_MUTEX_COMMAND_WRITE_UNLOCK);
+        return nullptr;
+    }
+
+    void* const value = *at(deque, deque->size - 1);
+    dropLast(deque);
+
+    xRwMutexCommand(deque, RW_MUTEX_COMMAND_WRITE_UNLOCK);
+    return value;
+}
+
+void blockDequeRemove(BlockDeque* const deque, const int index) {
+    xRwMutexCommand(deque, RW_MUTEX_COMMAND_WRITE_LOCK);
+    assert(!deque->iterating);
+
+    if (index < 0 || index >= deque->size) {
+        xRwMutexCommand(deque, RW_MUTEX_COMMAND_WRITE_UNLOCK);
+        return;
+    }
+
+    void* const value = *at(deque, index);
+
+    if (index < deque->size - 1 - index) {
+        for (int i = index; i > 0; i--)
+            *at(deque, i) = *at(deque, i - 1);
+        dropFirst(deque);
+    } else {
+        for (int i = index; i < deque->size - 1; i++)
+            *at(deque, i) = *at(deque, i + 1);
+        dropLast(deque);
+    }
+
+    xRwMutexCommand(deque, RW_MUTEX_COMMAND_WRITE_UNLOCK);
+
+    deallocateValue(deque, value);
+}
+
+void* nullable blockDequePeekFirst(BlockDeque* const deque) {
+    xRwMutexCommand(deque, RW_MUTEX_COMMAND_READ_LOCK);
+    void* const value = deque->size ? *at(deque, 0) : nullptr;
+    xRwMutexCommand(deque, RW_MUTEX_COMMAND_READ_UNLOCK);
+    return value;
+}
+
+void* nullable blockDequePeekLast(BlockDeque* const deque) {
+    xRwMutexCommand(deque, RW_MUTEX_COMMAND_READ_LOCK);
+    void* const value = deque->size ? *at(deque, deque->size - 1) : nullptr;
+    xRwMutexCommand(deque, RW_MUTEX_COMMAND_READ_UNLOCK);
+    return value;
+}
+
+#undef blockDequeIterateBegin
+void blockDequeIterateBegin(BlockDeque* const deque, BlockDequeIterator* const iterator) {
+    xRwMutexCommand(deque, RW_MUTEX_COMMAND_WRITE_LOCK);
+    assert(!deque->iterating);
+    deque->iterating = true;
+    xRwMutexCommand(deque, RW_MUTEX_COMMAND_WRITE_UNLOCK);
+
+    xRwMutexCommand(deque, RW_MUTEX_COMMAND_READ_LOCK);
+
+    unconst(iterator->deque) = deque;
+    iterator->index = 0;
+}
+
+void* nullable blockDequeIterate(BlockDequeIterator* const iterator) {
+    const BlockDeque* const deque = iterator->deque;
+    assert(deque->iterating);
+
+    if (iterator->index >= deque->size) return nullptr;
+
+    const int position = deque->head + iterator->index;
+    if (!(position & (BLOCK_SIZE - 1)) && position / BLOCK_SIZE + 1 < deque->mapSize) // entering a block - fetch the next one ahead as blocks aren't adjacent in memory
+        __builtin_prefetch(*blockAt(deque, position / BLOCK_SIZE + 1));
+
+    return *at(deque, iterator->index++);
+}
+
+void blockDequeIterateEnd(BlockDequeIterator* const iterator) {
+    assert(iterator->deque->iterating);
+    iterator->deque->iterating = false; // still under the read lock, which keeps the writers out - otherwise a waiting one could get in before the flag is cleared
+    xRwMutexCommand(iterator->deque, RW_MUTEX_COMMAND_READ_UNLOCK);
+
+    iterator->index = 0;
+}
+
+static void destroyBlocks(BlockDeque* const deque) {
+    for (int i = 0; i < deque->size; deallocateValue(deque, *at(deque, i++)));
+    for (int i = 0; i < deque->mapSize; deque->internalAllocator->free(*blockAt(deque, i++)));
+
+    deque->internalAllocator->free(deque->spare);
+    deque->spare = nullptr;
+
+    deque->internalAllocator->free(deque->map);
+    deque->map = nullptr;
+
+    deque->mapHead = deque->mapSize = deque->mapCapacity = 0;
+    deque->head = deque->size = 0;
+}
+
+void blockDequeClear(BlockDeque* const deque) {
+    xRwMutexCommand(deque, RW_MUTEX_COMMAND_WRITE_LOCK);
+    assert(!deque->iterating);
+    destroyBlocks(deque);
+    xRwMutexCommand(deque, RW_MUTEX_COMMAND_WRITE_UNLOCK);
+}
+
+void blockDequeDestroy(BlockDeque* const deque) {
+    if (deque->rwMutex) rwMutexDestroy(deque->rwMutex);
+    assert(!deque->iterating);
+    destroyBlocks(deque);
+    deque->internalAllocator->free(deque);
+}
@@ -0,0 +1,29 @@
+
+#pragma once
+
+#include "../defs.h"
+
+// Unrolled (chunked) deque - values are stored in fixed-size blocks referenced by a circular block map, constant time indexed access,
+// queue and stack, optionally thread-safe, only works with non-null values; an alternative engine for the Deque with the same api
+
+typedef struct _BlockDeque BlockDeque;
+typedef struct _BlockDequeIterator BlockDequeIterator;
+
+extern const int BLOCK_DEQUE_ITERATOR_SIZE;
+
+BlockDeque* blockDequeCreate(const Allocator* const internalAllocator, const bool synchronized, const Deallocator nullable deallocator); // blocks are allocated and recycled through the internalAllocator
+void blockDequePushBack(BlockDeque* const deque, void* const value); // vectorAdd, stackPush
+void blockDequePushFront(BlockDeque* const deque, void* const value); // queuePush
+void* nullable blockDequeGet(BlockDeque* const deque, const int index, const bool fromStartOrFromEnd); // index is always counted from the start, the direction is kept for the Deque api compatibility - access is constant time either way
+int blockDequeSize(BlockDeque* const deque);
+void* nullable blockDequePopFirst(BlockDeque* const deque); // retrieve just removed item, queuePop
+void* nullable blockDequePopLast(BlockDeque* const deque); // retrieve just removed item, stackPop
+void blockDequeRemove(BlockDeque* const deque, const int index); // shifts the shorter side of the deque
+void* nullable blockDequePeekFirst(BlockDeque* const deque); // queuePeek
+void* nullable blockDequePeekLast(BlockDeque* const deque); // stackPeek
+void blockDequeIterateBegin(BlockDeque* const deque, BlockDequeIterator* const iterator); // from the first to the last, don't do any write operations while iterating, iteration involves mutex read-locking
+#define blockDequeIterateBegin(x, y) blockDequeIterateBegin(x, (y = xalloca2(BLOCK_DEQUE_ITERATOR_SIZE)))
+void* nullable blockDequeIterate(BlockDequeIterator* const iterator); // returns null when there aren't any more items available
+void blockDequeIterateEnd(BlockDequeIterator* const iterator);
+void blockDequeClear(BlockDeque* const deque);
+void blockDequeDestroy(BlockDeque* const deque);
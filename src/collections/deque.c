@@ -28,7 +28,7 @@ Deque* dequeCreate(const Allocator* const internalAllocator, const bool synchron
     unconst(deque->internalAllocator) = internalAllocator;
     deque->first = deque->last = nullptr;
     deque->size = 0;
-    unconst(deque->rwMutex) = synchronized ? rwMutexCreate() : nullptr;
+    unconst(deque->rwMutex) = synchronized ? rwMutexCreate(RW_MUTEX_FLAG_RECURSIVE | (COLLECTIONS_OPTIMISTIC_READS ? RW_MUTEX_FLAG_OPTIMISTIC_READS : RW_MUTEX_FLAG_NONE)) : nullptr;
     unconst(deque->deallocator) = deallocator;
     return deque;
 }
@@ -102,6 +102,8 @@ void* nullable dequeGet(Deque* const deque, const int index, const bool fromStar
 }
 
 int dequeSize(Deque* const deque) {
+    if (COLLECTIONS_OPTIMISTIC_READS && deque->rwMutex) return rwMutexOptimisticRead(deque->rwMutex, deque->size);
+
     xRwMutexCommand(deque, RW_MUTEX_COMMAND_READ_LOCK);
     const int size = deque->size;
     xRwMutexCommand(deque, RW_MUTEX_COMMAND_READ_UNLOCK);
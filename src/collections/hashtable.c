@@ -1,99 +1,258 @@
 
-// TODO: remove internal mutex from all collections
+#include <emmintrin.h>
 #include "hashtable.h"
 
-typedef struct Node {
-    const unsigned long key;
+// open addressing with separate control bytes (aka swiss table), each control byte describes the slot with the same index,
+// control bytes are probed by groups of 16 at once via sse2, only the slots whose control bytes match the hash's lowest 7 bits get their keys compared
+
+typedef enum : byte {
+    CONTROL_EMPTY = 0b10000000,
+    CONTROL_DELETED = 0b11111110 // tombstone; full slots have the most significant bit cleared and contain the lowest 7 bits of their keys' hashes
+} Control;
+
+typedef struct {
+    unsigned long key;
     void* value;
-    int height;
-    struct Node
-        * nullable left,
-        * nullable right;
-} Node;
+} Slot;
 
 struct _Hashtable {
     const Allocator* const internalAllocator;
     const Deallocator nullable deallocator;
-    Node* nullable* buckets;
-    int capacity, count; // capacity - power of two actual allocated items, count - inserted items from outside
+    Slot* slots; // both slots and control bytes are stored in the same allocated chunk of memory, slots go first
+    byte* controls; // capacity + GROUP_SIZE items, the trailing group mirrors the leading one so a group can be loaded from any position without wrapping
+    int capacity, count, growthLeft; // capacity - power of two actual allocated slots, count - inserted items from outside, growthLeft - amount of empty slots that can be filled before rehashing
+    bool iterating;
 };
 
 struct _HashtableIterator {
     Hashtable* const hashtable;
     int index;
-    Node* nullable node;
 };
 
 const int HASHTABLE_ITERATOR_SIZE = sizeof(HashtableIterator);
-static const int INITIAL_CAPACITY = 8;
+static const int GROUP_SIZE = 16, INITIAL_CAPACITY = 16; // capacity must not be less than the group size
+static const int MAX_SIZE = ~0u / 2u / 4u; // 0x1fffffff so the capacity doesn't overflow
+
+staticAssert(sizeof(__m128i) == 16);
+
+static inline int maxLoad(const int capacity) {
+    return capacity - capacity / 8; // 7/8
+}
+
+static void allocateSlots(Hashtable* const hashtable, const int capacity) {
+    const unsigned long slotsSize = capacity * sizeof(Slot);
+
+    void* const memory = hashtable->internalAllocator->malloc(slotsSize + capacity + GROUP_SIZE);
+    hashtable->slots = memory;
+    hashtable->controls = memory + slotsSize;
+    xmemset(hashtable->controls, CONTROL_EMPTY, capacity + GROUP_SIZE);
+
+    hashtable->capacity = capacity;
+    hashtable->growthLeft = maxLoad(capacity) - hashtable->count;
+}
 
 Hashtable* hashtableCreate(const Allocator* const internalAllocator, const Deallocator nullable valueDeallocator) {
-    Hashtable* const hashtable = xmalloc(sizeof *hashtable);
+    Hashtable* const hashtable = internalAllocator->malloc(sizeof *hashtable);
     unconst(hashtable->internalAllocator) = internalAllocator;
     unconst(hashtable->deallocator) = valueDeallocator;
-    hashtable->buckets = xmalloc((hashtable->capacity = INITIAL_CAPACITY) * sizeof(void*));
     hashtable->count = 0;
+    hashtable->iterating = false;
+    allocateSlots(hashtable, INITIAL_CAPACITY);
     return hashtable;
 }
 
-static unsigned long calcHash(const unsigned long value) {
-    // Fowler–Noll–Vo (FNV‑1a) Hash Function
+static inline unsigned long calcHash(const unsigned long value) { // xxh3's 8-byte path - a couple of multiplies, every bit of the key affects both the position and the tag
+    return hashValueLong(&value, sizeof value);
+}
 
-    const unsigned long
-        FNV_OFFSET_BASIS = 0xcbf29ce484222325ULL,
-        FNV_PRIME = 0x100000001b3ULL,
-        SEED = 932579;
+static inline int hashPosition(const unsigned long hash) { // h1 - where to start probing
+    return (int) (hash >> 7);
+}
 
-    unsigned long hash = SEED ^ FNV_OFFSET_BASIS;
+static inline byte hashTag(const unsigned long hash) { // h2 - what to store in the control byte
+    return (byte) (hash & 0x7f);
+}
 
-    for (byte i = 0; i < (byte) sizeof(long); i++) {
-        hash ^= ((const byte*) &value)[i];
-        hash *= FNV_PRIME;
+static inline unsigned matchTag(const byte* const group, const byte tag) { // bit i is set if the control byte i in the group equals to the tag
+    const __m128i controls = _mm_loadu_si128((const __m128i*) group);
+    return (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(controls, _mm_set1_epi8((char) tag)));
+}
+
+static inline unsigned matchEmptyOrDeleted(const byte* const group) { // both have the most significant bit set
+    return (unsigned) _mm_movemask_epi8(_mm_loadu_si128((const __m128i*) group));
+}
+
+static inline unsigned matchFull(const byte* const group) {
+    return ~matchEmptyOrDeleted(group) & 0xffffu;
+}
+
+static inline void setControl(Hashtable* const hashtable, const int index, const byte control) {
+    hashtable->controls[index] = control;
+    if (index < GROUP_SIZE) hashtable->controls[hashtable->capacity + index] = control; // mirror
+}
+
+// triangular probing by groups - visits every group exactly once when the amount of groups is a power of two
+
+static int findIndex(const Hashtable* const hashtable, const unsigned long key, const unsigned long hash) { // returns -1 if not found
+    const int mask = hashtable->capacity - 1;
+    const byte tag = hashTag(hash);
+
+    for (int position = hashPosition(hash) & mask, stride = 0; stride <= hashtable->capacity; position = (position + (stride += GROUP_SIZE)) & mask) {
+        const byte* const group = hashtable->controls + position;
+
+        for (unsigned matches = matchTag(group, tag); matches; matches &= matches - 1) {
+            const int index = (position + __builtin_ctz(matches)) & mask;
+            if (hashtable->slots[index].key == key) return index;
+        }
+
+        if (matchTag(group, CONTROL_EMPTY)) return -1; // the key would've been inserted into this group otherwise
     }
 
-    return hash;
+    return -1;
 }
 
-static inline int calcIndex(const unsigned long hash, const int capacity) {
-    return (int) (hash & (capacity - 1));
+static int findInsertionIndex(const Hashtable* const hashtable, const unsigned long hash) {
+    const int mask = hashtable->capacity - 1;
+
+    for (int position = hashPosition(hash) & mask, stride = 0;; position = (position + (stride += GROUP_SIZE)) & mask) {
+        assert(stride <= hashtable->capacity);
+
+        const unsigned matches = matchEmptyOrDeleted(hashtable->controls + position);
+        if (matches) return (position + __builtin_ctz(matches)) & mask;
+    }
+}
+
+static int findInsertionIndexForKey(const Hashtable* const hashtable, const unsigned long key, const unsigned long hash) { // asserts that the key isn't there yet along the same probe
+    const int mask = hashtable->capacity - 1;
+    const byte tag = hashTag(hash);
+    int insertion = -1;
+
+    for (int position = hashPosition(hash) & mask, stride = 0;; position = (position + (stride += GROUP_SIZE)) & mask) {
+        assert(stride <= hashtable->capacity);
+        const byte* const group = hashtable->controls + position;
+
+        for (unsigned matches = matchTag(group, tag); matches; matches &= matches - 1)
+            assert(hashtable->slots[(position + __builtin_ctz(matches)) & mask].key != key);
+
+        const unsigned matches = matchEmptyOrDeleted(group);
+        if (insertion < 0 && matches) insertion = (position + __builtin_ctz(matches)) & mask; // the first free slot, though the key could still be in the groups that follow
+        if (matchTag(group, CONTROL_EMPTY)) return insertion; // the key would've been inserted into this group otherwise
+    }
+}
+
+static void rehash(Hashtable* const hashtable, const int capacity) {
+    Slot* const oldSlots = hashtable->slots;
+    const byte* const oldControls = hashtable->controls;
+    const int oldCapacity = hashtable->capacity;
+
+    allocateSlots(hashtable, capacity);
+
+    for (int i = 0; i < oldCapacity; i++) {
+        if (oldControls[i] & CONTROL_EMPTY) continue; // empty or deleted
+
+        const unsigned long hash = calcHash(oldSlots[i].key);
+        const int index = findInsertionIndex(hashtable, hash);
+
+        setControl(hashtable, index, hashTag(hash));
+        hashtable->slots[index] = oldSlots[i];
+    }
+
+    hashtable->internalAllocator->free(oldSlots);
+}
+
+static void reserveSlot(Hashtable* const hashtable) {
+    if (hashtable->growthLeft > 0) return;
+
+    // if tombstones occupy a half of the available slots or more then just cleanup them without growing
+    rehash(hashtable, hashtable->count * 2 <= maxLoad(hashtable->capacity) ? hashtable->capacity : hashtable->capacity * 2);
+    assert(hashtable->growthLeft > 0);
 }
 
 void hashtablePut(Hashtable* const hashtable, const unsigned long key, void* const value) {
+    assert(hashtable->count < MAX_SIZE && !hashtable->iterating);
+
     const unsigned long hash = calcHash(key);
-    const int index = calcIndex(hash, hashtable->capacity);
+    reserveSlot(hashtable);
 
-//    Node* const root = insert(hashtable->buckets[index], key, );
+    const int index = findInsertionIndexForKey(hashtable, key, hash);
+    if (hashtable->controls[index] == CONTROL_EMPTY) hashtable->growthLeft--; // tombstones are reused for free
+
+    setControl(hashtable, index, hashTag(hash));
+    hashtable->slots[index] = (Slot) {key, value};
+    hashtable->count++;
 }
 
 void* nullable hashtableGet(Hashtable* const hashtable, const unsigned long hash) {
-    return nullptr;
+    const int index = findIndex(hashtable, hash, calcHash(hash));
+    return index >= 0 ? hashtable->slots[index].value : nullptr;
 }
 
 void* nullable hashtableRemove(Hashtable* const hashtable, const unsigned long hash, const bool deallocate) {
+    assert(!hashtable->iterating);
+
+    const int index = findIndex(hashtable, hash, calcHash(hash));
+    if (index < 0) return nullptr;
+
+    void* const value = hashtable->slots[index].value;
+    setControl(hashtable, index, CONTROL_DELETED);
+    hashtable->count--;
+
+    if (!deallocate) return value;
+    if (hashtable->deallocator) hashtable->deallocator(value);
     return nullptr;
 }
 
 int hashtableCapacity(Hashtable* const hashtable) {
-    return 0;
+    return hashtable->capacity;
 }
 
 int hashtableCount(Hashtable* const hashtable) {
-    return 0;
+    return hashtable->count;
 }
 
 #undef hashtableIterateBegin
 void hashtableIterateBegin(Hashtable* const hashtable, HashtableIterator* const iterator) {
+    assert(!hashtable->iterating);
+    hashtable->iterating = true;
 
+    unconst(iterator->hashtable) = hashtable;
+    iterator->index = 0;
 }
 
 void* nullable hashtableIterate(HashtableIterator* const iterator) {
+    const Hashtable* const hashtable = iterator->hashtable;
+    assert(hashtable->iterating);
+
+    while (iterator->index < hashtable->capacity) { // skips whole groups of empty slots at once
+        const int position = iterator->index;
+        const unsigned matches = matchFull(hashtable->controls + position) & (0xffffu >> max(0, position + GROUP_SIZE - hashtable->capacity)); // mirrored bytes are excluded
+
+        if (!matches) {
+            iterator->index += GROUP_SIZE;
+            continue;
+        }
+
+        const int index = position + __builtin_ctz(matches);
+        iterator->index = index + 1;
+        return hashtable->slots[index].value;
+    }
+
     return nullptr;
 }
 
 void hashtableIterateEnd(HashtableIterator* const iterator) {
-
+    assert(iterator->hashtable->iterating);
+    iterator->hashtable->iterating = false;
+    iterator->index = 0;
 }
 
 void hashtableDestroy(Hashtable* const hashtable) {
+    assert(!hashtable->iterating);
+
+    if (hashtable->deallocator)
+        for (int i = 0; i < hashtable->capacity; i++)
+            if (!(hashtable->controls[i] & CONTROL_EMPTY)) hashtable->deallocator(hashtable->slots[i].value);
 
+    hashtable->internalAllocator->free(hashtable->slots);
+    hashtable->internalAllocator->free(hashtable);
 }
@@ -3,7 +3,7 @@
 
 #include "../defs.h"
 
-// Key-to-value mapping of items through hashing, optionally thread-safe, only works with non-null values
+// Key-to-value mapping of items through hashing (open addressing, sse2 probing), not thread-safe, only works with non-null values
 
 typedef struct _Hashtable Hashtable;
 typedef struct _HashtableIterator HashtableIterator;
@@ -13,10 +13,10 @@ extern const int HASHTABLE_ITERATOR_SIZE;
 Hashtable* hashtableCreate(const Allocator* const internalAllocator, const Deallocator nullable valueDeallocator);
 void hashtablePut(Hashtable* const hashtable, const unsigned long key, void* const value); // hashes are the keys and they must be unique
 void* nullable hashtableGet(Hashtable* const hashtable, const unsigned long hash);
-void* nullable hashtableRemove(Hashtable* const hashtable, const unsigned long hash, const bool deallocate);
-int hashtableCapacity(Hashtable* const hashtable); // amount of currently allocated cells for storing collision buckets
+void* nullable hashtableRemove(Hashtable* const hashtable, const unsigned long hash, const bool deallocate); // returns the removed value if it hasn't been deallocated
+int hashtableCapacity(Hashtable* const hashtable); // amount of currently allocated slots (power of two), items are stored directly in them
 int hashtableCount(Hashtable* const hashtable); // amount of elements being stored
-void hashtableIterateBegin(Hashtable* const hashtable, HashtableIterator* const iterator); // don't use put or remove while iterator is active, fails if there's another active iterator, fails if there's no items
+void hashtableIterateBegin(Hashtable* const hashtable, HashtableIterator* const iterator); // don't use put or remove while iterator is active, fails if there's another active iterator, the order is unspecified
 #define hashtableIterateBegin(x, y) hashtableIterateBegin(x, (y = xalloca2(HASHTABLE_ITERATOR_SIZE)))
 void* nullable hashtableIterate(HashtableIterator* const iterator); // returns null when there aren't any more items available
 void hashtableIterateEnd(HashtableIterator* const iterator); // must be called while its hashtable is still active
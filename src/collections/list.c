@@ -2,22 +2,28 @@
 #include "../utils/rwMutex.h"
 #include "list.h"
 
+// circular buffer - items are stored starting at the head index and wrap around the end of the allocated array,
+// so both ends can be pushed and popped without moving other items, indexes from outside are translated to the actual ones
+
 struct _List {
     const Allocator* const internalAllocator;
     void** nullable values;
-    int size;
+    int head, size, capacity; // head - actual index of the first item, capacity - power of two amount of allocated items, grows geometrically
+    void* nullable first, * nullable last; // cached ends, so peeking (optimistically) doesn't touch the buffer which might be reallocated meanwhile
     RWMutex* nullable const rwMutex;
     const Deallocator nullable deallocator;
 };
 
-static const int MAX_SIZE = ~0u / 2u; // 0x7fffffff
+static const int MAX_SIZE = 1 << 30; // the greatest power of two which fits into int
+static const int MIN_CAPACITY = 8, SHRINK_FACTOR = 4; // the capacity gets halved when the size becomes a quarter of it
 
 List* listCreate(const Allocator* const internalAllocator, const bool synchronized, const Deallocator nullable deallocator) {
     List* const list = internalAllocator->malloc(sizeof *list);
     unconst(list->internalAllocator) = internalAllocator;
     list->values = nullptr;
-    list->size = 0;
-    unconst(list->rwMutex) = synchronized ? rwMutexCreate() : nullptr;
+    list->head = list->size = list->capacity = 0;
+    list->first = list->last = nullptr;
+    unconst(list->rwMutex) = synchronized ? rwMutexCreate(RW_MUTEX_FLAG_RECURSIVE | (COLLECTIONS_OPTIMISTIC_READS ? RW_MUTEX_FLAG_OPTIMISTIC_READS : RW_MUTEX_FLAG_NONE)) : nullptr;
     unconst(list->deallocator) = deallocator;
     return list;
 }
@@ -30,6 +36,62 @@ static inline void xRwMutexCommand(List* const list, const RWMutexCommand comman
     if (list->rwMutex) rwMutexCommand(list->rwMutex, command);
 }
 
+static inline int actualIndex(const List* const list, const int index) {
+    return (list->head + index) & (list->capacity - 1);
+}
+
+static inline void** at(const List* const list, const int index) {
+    return list->values + actualIndex(list, index);
+}
+
+static void updateEnds(List* const list) { // after each modification of the items
+    list->first = list->size ? list->values[list->head] : nullptr;
+    list->last = list->size ? *at(list, list->size - 1) : nullptr;
+}
+
+static int roundUpToPowerOfTwo(const int value) {
+    assert(value > 0 && value <= MAX_SIZE);
+    return value == 1 ? 1 : 1 << (32 - __builtin_clz((unsigned) value - 1));
+}
+
+static void copyOut(const List* const list, void** const destination, const int index, const int count) { // copies from the circular buffer into a linear one
+    const int start = actualIndex(list, index), firstPart = min(count, list->capacity - start);
+    xmemcpy(destination, list->values + start, firstPart * sizeof(void*));
+    xmemcpy(destination + firstPart, list->values, (count - firstPart) * sizeof(void*));
+}
+
+static void copyIn(List* const list, const int index, void* const* const source, const int count) {
+    const int start = actualIndex(list, index), firstPart = min(count, list->capacity - start);
+    xmemcpy(list->values + start, source, firstPart * sizeof(void*));
+    xmemcpy(list->values, source + firstPart, (count - firstPart) * sizeof(void*));
+}
+
+static void resize(List* const list, const int capacity) { // also makes items contiguous, moving the head to zero
+    assert(capacity >= list->size && !(capacity & (capacity - 1)));
+
+    void** const values = capacity ? list->internalAllocator->malloc(capacity * sizeof(void*)) : nullptr;
+    if (list->size) copyOut(list, values, 0, list->size);
+
+    list->internalAllocator->free(list->values);
+    list->values = values;
+    list->head = 0;
+    list->capacity = capacity;
+}
+
+static void ensureCapacity(List* const list, const int additional) {
+    assert(additional >= 0 && list->size <= MAX_SIZE - additional);
+
+    const int required = list->size + additional;
+    if (required <= list->capacity) return;
+
+    resize(list, roundUpToPowerOfTwo(max(required, MIN_CAPACITY)));
+}
+
+static void shrinkIfSparse(List* const list) {
+    if (list->capacity > MIN_CAPACITY && list->size <= list->capacity / SHRINK_FACTOR)
+        resize(list, list->capacity / 2);
+}
+
 List* nullable listCopy(List* const old, const bool synchronized, const Duplicator nullable duplicator) {
     xRwMutexCommand(old, RW_MUTEX_COMMAND_READ_LOCK);
 
@@ -41,9 +103,10 @@ List* nullable listCopy(List* const old, const bool synchronized, const Duplicat
 
     List* const new = listCreate(old->internalAllocator, synchronized, old->deallocator);
 
-    new->values = old->internalAllocator->malloc(old->size * sizeof(void*));
+    ensureCapacity(new, old->size);
     new->size = old->size;
-    for (int i = 0; i < old->size; new->values[i] = duplicator ? duplicator(old->values[i]) : old->values[i], i++);
+    for (int i = 0; i < old->size; new->values[i] = duplicator ? duplicator(*at(old, i)) : *at(old, i), i++);
+    updateEnds(new);
 
     xRwMutexCommand(old, RW_MUTEX_COMMAND_READ_UNLOCK);
     return new;
@@ -51,32 +114,62 @@ List* nullable listCopy(List* const old, const bool synchronized, const Duplicat
 
 void listAddBack(List* const list, void* const value) {
     xRwMutexCommand(list, RW_MUTEX_COMMAND_WRITE_LOCK);
-    assert(list->size < MAX_SIZE);
 
-    list->values = list->internalAllocator->realloc(list->values, ++list->size * sizeof(void*));
-    list->values[list->size - 1] = value;
+    ensureCapacity(list, 1);
+    *at(list, list->size++) = value;
+    updateEnds(list);
 
     xRwMutexCommand(list, RW_MUTEX_COMMAND_WRITE_UNLOCK);
 }
 
 void listAddFront(List* const list, void* const value) {
     xRwMutexCommand(list, RW_MUTEX_COMMAND_WRITE_LOCK);
-    assert(list->size < MAX_SIZE);
 
-    void** const temp = list->internalAllocator->malloc(++list->size * sizeof(void*));
-    temp[0] = value;
-    for (int i = 1; i < list->size; temp[i] = list->values[i - 1], i++);
+    ensureCapacity(list, 1);
+    list->head = actualIndex(list, -1);
+    list->values[list->head] = value;
+    list->size++;
+    updateEnds(list);
 
-    list->internalAllocator->free(list->values);
-    list->values = temp;
+    xRwMutexCommand(list, RW_MUTEX_COMMAND_WRITE_UNLOCK);
+}
+
+void listAddAll(List* const list, void* const* const values, const int count) {
+    xRwMutexCommand(list, RW_MUTEX_COMMAND_WRITE_LOCK);
+    assert(count >= 0);
+
+    if (count) {
+        ensureCapacity(list, count);
+        copyIn(list, list->size, values, count);
+        list->size += count;
+        updateEnds(list);
+    }
+
+    xRwMutexCommand(list, RW_MUTEX_COMMAND_WRITE_UNLOCK);
+}
+
+void listReserve(List* const list, const int capacity) {
+    xRwMutexCommand(list, RW_MUTEX_COMMAND_WRITE_LOCK);
+    assert(capacity >= 0 && capacity <= MAX_SIZE);
+
+    if (capacity > list->capacity) resize(list, roundUpToPowerOfTwo(capacity));
+
+    xRwMutexCommand(list, RW_MUTEX_COMMAND_WRITE_UNLOCK);
+}
+
+void listShrinkToFit(List* const list) {
+    xRwMutexCommand(list, RW_MUTEX_COMMAND_WRITE_LOCK);
+
+    const int capacity = list->size ? roundUpToPowerOfTwo(list->size) : 0;
+    if (list->capacity > capacity) resize(list, capacity);
 
     xRwMutexCommand(list, RW_MUTEX_COMMAND_WRITE_UNLOCK);
 }
 
 void* nullable listGet(List* const list, const int index) {
     xRwMutexCommand(list, RW_MUTEX_COMMAND_READ_LOCK);
-    assert(!!list->size == !!list->values);
-    void* const value = index >= 0 && index < list->size && list->values ? list->values[index] : nullptr;
+    assert(!!list->capacity == !!list->values);
+    void* const value = index >= 0 && index < list->size ? *at(list, index) : nullptr;
     xRwMutexCommand(list, RW_MUTEX_COMMAND_READ_UNLOCK);
     return value;
 }
@@ -85,11 +178,13 @@ void listSwap(List* const list, const int index1, const int index2) {
     xRwMutexCommand(list, RW_MUTEX_COMMAND_WRITE_LOCK);
     assert(list->size && list->values && index1 < list->size && index2 < list->size && index1 >= 0 && index2 >= 0);
 
-    void* const value1 = list->values[index1];
-    void* const value2 = list->values[index2];
+    void** const value1 = at(list, index1);
+    void** const value2 = at(list, index2);
 
-    list->values[index1] = value2;
-    list->values[index2] = value1;
+    void* const temp = *value1;
+    *value1 = *value2;
+    *value2 = temp;
+    updateEnds(list);
 
     xRwMutexCommand(list, RW_MUTEX_COMMAND_WRITE_UNLOCK);
 }
@@ -102,19 +197,11 @@ void* nullable listPopFirst(List* const list) {
         return nullptr;
     }
 
-    void* const value = list->values[0];
+    void* const value = list->values[list->head];
+    list->head = actualIndex(list, 1);
     list->size--;
-
-    if (!list->size) {
-        list->internalAllocator->free(list->values);
-        list->values = nullptr;
-
-        xRwMutexCommand(list, RW_MUTEX_COMMAND_WRITE_UNLOCK);
-        return value;
-    }
-
-    xmemmove(list->values, (void*) list->values + sizeof(void*), list->size * sizeof(void*));
-    list->values = list->internalAllocator->realloc(list->values, list->size * sizeof(void*));
+    shrinkIfSparse(list);
+    updateEnds(list);
 
     xRwMutexCommand(list, RW_MUTEX_COMMAND_WRITE_UNLOCK);
     return value;
@@ -128,60 +215,73 @@ void* nullable listPopLast(List* const list) {
         return nullptr;
     }
 
-    list->size--;
-    void* const value = list->values[list->size];
-
-    if (list->size)
-        list->values = list->internalAllocator->realloc(list->values, list->size * sizeof(void*));
-    else {
-        list->internalAllocator->free(list->values);
-        list->values = nullptr;
-    }
+    void* const value = *at(list, --list->size);
+    shrinkIfSparse(list);
+    updateEnds(list);
 
     xRwMutexCommand(list, RW_MUTEX_COMMAND_WRITE_UNLOCK);
     return value;
 }
 
+static void closeGap(List* const list, const int index, const int count) { // shifts the shorter side of the list over the removed items
+    if (index < list->size - index - count) {
+        for (int i = index - 1; i >= 0; i--)
+            *at(list, i + count) = *at(list, i);
+        list->head = actualIndex(list, count);
+    } else
+        for (int i = index + count; i < list->size; i++)
+            *at(list, i - count) = *at(list, i);
+
+    list->size -= count;
+}
+
 void listRemove(List* const list, const int index) {
     xRwMutexCommand(list, RW_MUTEX_COMMAND_WRITE_LOCK);
     assert(list->size && list->values && index >= 0 && index < list->size);
 
-    deallocateValue(list, list->values[index]);
-    for (int i = index; i < list->size - 1; list->values[i] = list->values[i + 1], i++);
+    deallocateValue(list, *at(list, index));
+    closeGap(list, index, 1);
+    shrinkIfSparse(list);
+    updateEnds(list);
 
-    if (--list->size)
-        list->values = list->internalAllocator->realloc(list->values, list->size * sizeof(void*));
-    else {
-        list->internalAllocator->free(list->values);
-        list->values = nullptr;
-    }
+    xRwMutexCommand(list, RW_MUTEX_COMMAND_WRITE_UNLOCK);
+}
+
+void listRemoveRange(List* const list, const int index, const int count) {
+    xRwMutexCommand(list, RW_MUTEX_COMMAND_WRITE_LOCK);
+    assert(index >= 0 && count >= 0 && index <= list->size - count);
+
+    for (int i = index; i < index + count; deallocateValue(list, *at(list, i++)));
+    closeGap(list, index, count);
+    shrinkIfSparse(list);
+    updateEnds(list);
 
     xRwMutexCommand(list, RW_MUTEX_COMMAND_WRITE_UNLOCK);
 }
 
 void* nullable listPeekFirst(List* const list) {
-    xRwMutexCommand(list, RW_MUTEX_COMMAND_READ_LOCK);
-
-    assert(!list->size && !list->values || list->size && list->values);
-    void* const value = list->size ? list->values[0] : nullptr;
+    if (COLLECTIONS_OPTIMISTIC_READS && list->rwMutex) return rwMutexOptimisticRead(list->rwMutex, list->first);
 
+    xRwMutexCommand(list, RW_MUTEX_COMMAND_READ_LOCK);
+    void* const value = list->first;
     xRwMutexCommand(list, RW_MUTEX_COMMAND_READ_UNLOCK);
     return value;
 }
 
 void* nullable listPeekLast(List* const list) {
-    xRwMutexCommand(list, RW_MUTEX_COMMAND_READ_LOCK);
-
-    assert(!list->size && !list->values || list->size && list->values);
-    void* const value = list->size ? list->values[list->size - 1] : nullptr;
+    if (COLLECTIONS_OPTIMISTIC_READS && list->rwMutex) return rwMutexOptimisticRead(list->rwMutex, list->last);
 
+    xRwMutexCommand(list, RW_MUTEX_COMMAND_READ_LOCK);
+    void* const value = list->last;
     xRwMutexCommand(list, RW_MUTEX_COMMAND_READ_UNLOCK);
     return value;
 }
 
 int listSize(List* const list) {
+    if (COLLECTIONS_OPTIMISTIC_READS && list->rwMutex) return rwMutexOptimisticRead(list->rwMutex, list->size);
+
     xRwMutexCommand(list, RW_MUTEX_COMMAND_READ_LOCK);
-    assert(list->size && list->values || !list->size && !list->values);
+    assert(!!list->capacity == !!list->values);
     const int size = list->size;
     xRwMutexCommand(list, RW_MUTEX_COMMAND_READ_UNLOCK);
     return size;
@@ -193,13 +293,19 @@ void* nullable listBinarySearch(List* const list, const void* const key, const C
     xRwMutexCommand(list, RW_MUTEX_COMMAND_READ_LOCK);
     assert(list->size && list->values);
 
-    void* SDL_bsearch(
-        const void* const, const void* const, const unsigned long, const unsigned long, const SDL_CompareCallback
-    );
-
-    const unsigned long index =
-        (void**) SDL_bsearch(key, list->values, list->size, sizeof(void*), comparator) - list->values;
-    void* const value = (int) index >= list->size ? nullptr : list->values[index];
+    void* value = nullptr;
+    for (int low = 0, high = list->size - 1, middle; low <= high;) {
+        middle = low + (high - low) / 2;
+        void** const current = at(list, middle);
+
+        const Compared compared = comparator(current, key);
+        if (compared < COMPARED_EQUAL) low = middle + 1;
+        else if (compared > COMPARED_EQUAL) high = middle - 1;
+        else {
+            value = *current;
+            break;
+        }
+    }
 
     xRwMutexCommand(list, RW_MUTEX_COMMAND_READ_UNLOCK);
     return value;
@@ -211,15 +317,17 @@ void listQSort(List* const list, const Comparator comparator) {
     void SDL_qsort(void* const, const unsigned long, const unsigned long, const SDL_CompareCallback);
 
     assert(list->size && list->values);
-    SDL_qsort(list->values, list->size, sizeof(void*), comparator);
+    if (list->head + list->size > list->capacity) resize(list, list->capacity); // wrapped around - make contiguous
+    SDL_qsort(list->values + list->head, list->size, sizeof(void*), comparator);
+    updateEnds(list);
 
     xRwMutexCommand(list, RW_MUTEX_COMMAND_WRITE_UNLOCK);
 }
 
 static void destroyValuesIfNotEmpty(List* const list) {
     if (!list->deallocator) return;
-    assert(list->size && list->values || !list->size && !list->values);
-    for (int i = 0; i < list->size; list->deallocator(list->values[i++]));
+    assert(!!list->capacity == !!list->values);
+    for (int i = 0; i < list->size; list->deallocator(*at(list, i++)));
 }
 
 void listClear(List* const list) {
@@ -227,9 +335,8 @@ void listClear(List* const list) {
 
     destroyValuesIfNotEmpty(list);
     list->size = 0;
-
-    list->internalAllocator->free(list->values);
-    list->values = nullptr;
+    resize(list, 0);
+    updateEnds(list);
 
     xRwMutexCommand(list, RW_MUTEX_COMMAND_WRITE_UNLOCK);
 }
@@ -3,23 +3,25 @@
 
 #include "../defs.h"
 
-// Linear list (dynamically resizable array - aka vector), queue and stack operations support [deprecated], optionally thread-safe, only works with non-null values
+// Linear list (dynamically resizable circular buffer with geometric growth - aka vector/deque), constant time queue and stack operations at both ends, optionally thread-safe, only works with non-null values
 
 // TODO: rename to vector?
 
-// TODO: add bulk remove - deletion of several items at once
-
 typedef struct _List List;
 
 List* listCreate(const Allocator* const internalAllocator, const bool synchronized, const Deallocator nullable deallocator);
 List* nullable listCopy(List* const old, const bool synchronized, const Duplicator nullable duplicator);
 void listAddBack(List* const list, void* const value); // listAdd, stackPush
 void listAddFront(List* const list, void* const value); // queuePush
+void listAddAll(List* const list, void* const* const values, const int count); // appends count values at once to the back
+void listReserve(List* const list, const int capacity); // preallocates space for at least capacity items, never shrinks
+void listShrinkToFit(List* const list); // releases the unused preallocated space
 void* nullable listGet(List* const list, const int index);
 void listSwap(List* const list, const int index1, const int index2); // swap places items with corresponding indexes - first goes to second's position and v.v.
 void* nullable listPopFirst(List* const list); // queuePop // TODO: rename to remove(First|Last)
 void* nullable listPopLast(List* const list); // stackPop
 void listRemove(List* const list, const int index); // don't use in a loop - ConcurrentModificationException - or each iteration adjust loop counter
+void listRemoveRange(List* const list, const int index, const int count); // removes (and deallocates) count items starting at index
 void* nullable listPeekFirst(List* const list); // queuePeek
 void* nullable listPeekLast(List* const list); // stackPeek
 int listSize(List* const list);
@@ -0,0 +1,126 @@
+
+#include <stdatomic.h>
+#include "mpmcQueue.h"
+
+// each cell's sequence tells whose turn it is: sequence == position - free for the producer that claimed this position,
+// sequence == position + 1 - filled and ready for the consumer that claimed this position, after which it becomes position + capacity - free for the next lap;
+// positions are claimed via compare-and-swap, so producers and consumers only contend on their own counters
+
+enum : int {
+    CACHE_LINE_SIZE = 64
+};
+
+typedef struct {
+    atomic long sequence;
+    void* nullable value;
+} Cell;
+
+struct _MPMCQueue {
+    const Allocator* const internalAllocator;
+    const Deallocator nullable deallocator;
+    Cell* const cells;
+    const int mask; // capacity - 1
+    byte padding0[CACHE_LINE_SIZE];
+    atomic long pushPosition; // producers' and consumers' counters live on separate cache lines to avoid false sharing
+    byte padding1[CACHE_LINE_SIZE - sizeof(atomic long)];
+    atomic long popPosition;
+    byte padding2[CACHE_LINE_SIZE - sizeof(atomic long)];
+};
+
+static const int MAX_CAPACITY = 1 << 30;
+
+MPMCQueue* mpmcQueueCreate(const Allocator* const internalAllocator, const int capacity, const Deallocator nullable deallocator) {
+    assert(capacity > 0 && capacity <= MAX_CAPACITY);
+
+    int actualCapacity = 1;
+    while (actualCapacity < capacity) actualCapacity <<= 1;
+
+    MPMCQueue* const queue = internalAllocator->malloc(sizeof *queue);
+    unconst(queue->internalAllocator) = internalAllocator;
+    unconst(queue->deallocator) = deallocator;
+    unconst(queue->cells) = internalAllocator->malloc(actualCapacity * sizeof(Cell));
+    unconst(queue->mask) = actualCapacity - 1;
+
+    for (int i = 0; i < actualCapacity; i++) {
+        atomic_init(&queue->cells[i].sequence, i);
+        queue->cells[i].value = nullptr;
+    }
+
+    atomic_init(&queue->pushPosition, 0);
+    atomic_init(&queue->popPosition, 0);
+    return queue;
+}
+
+bool mpmcQueueTryPush(MPMCQueue* const queue, void* const value) {
+    assert(value);
+
+    long position = atomic_load_explicit(&queue->pushPosition, memory_order_relaxed);
+    Cell* cell;
+
+    while (true) {
+        cell = queue->cells + (position & queue->mask);
+        const long difference = atomic_load_explicit(&cell->sequence, memory_order_acquire) - position;
+
+        if (!difference) {
+            if (atomic_compare_exchange_weak_explicit(&queue->pushPosition, &position, position + 1, memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if (difference < 0)
+            return false; // the cell still holds a value from the previous lap
+        else
+            position = atomic_load_explicit(&queue->pushPosition, memory_order_relaxed); // another producer got ahead
+    }
+
+    cell->value = value;
+    atomic_store_explicit(&cell->sequence, position + 1, memory_order_release);
+    return true;
+}
+
+void mpmcQueuePush(MPMCQueue* const queue, void* const value) {
+    while (!mpmcQueueTryPush(queue, value)) xyield();
+}
+
+void* nullable mpmcQueuePop(MPMCQueue* const queue) {
+    long position = atomic_load_explicit(&queue->popPosition, memory_order_relaxed);
+    Cell* cell;
+
+    while (true) {
+        cell = queue->cells + (position & queue->mask);
+        const long difference = atomic_load_explicit(&cell->sequence, memory_order_acquire) - (position + 1);
+
+        if (!difference) {
+            if (atomic_compare_exchange_weak_explicit(&queue->popPosition, &position, position + 1, memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if (difference < 0)
+            return nullptr; // the cell hasn't been filled yet
+        else
+            position = atomic_load_explicit(&queue->popPosition, memory_order_relaxed); // another consumer got ahead
+    }
+
+    void* const value = cell->value;
+    cell->value = nullptr;
+    atomic_store_explicit(&cell->sequence, position + queue->mask + 1, memory_order_release);
+    return value;
+}
+
+bool mpmcQueueDrained(MPMCQueue* const queue) {
+    const long pushPosition = atomic_load_explicit(&queue->pushPosition, memory_order_acquire); // loaded first as the pop position never overtakes it
+    return atomic_load_explicit(&queue->popPosition, memory_order_acquire) >= pushPosition;
+}
+
+int mpmcQueueCapacity(MPMCQueue* const queue) {
+    return queue->mask + 1;
+}
+
+int mpmcQueueSize(MPMCQueue* const queue) {
+    const long size = atomic_load_explicit(&queue->pushPosition, memory_order_relaxed) - atomic_load_explicit(&queue->popPosition, memory_order_relaxed);
+    return (int) max(0l, min(size, (long) queue->mask + 1));
+}
+
+void mpmcQueueDestroy(MPMCQueue* const queue) {
+    void* value;
+    while ((value = mpmcQueuePop(queue)))
+        if (queue->deallocator) queue->deallocator(value);
+
+    queue->internalAllocator->free(queue->cells);
+    queue->internalAllocator->free(queue);
+}
@@ -0,0 +1,18 @@
+
+#pragma once
+
+#include "../defs.h"
+
+// Bounded lock-free multi-producer multi-consumer FIFO queue (Dmitry Vyukov's ring buffer with per-cell sequence numbers),
+// thread-safe without locking, only works with non-null values
+
+typedef struct _MPMCQueue MPMCQueue;
+
+MPMCQueue* mpmcQueueCreate(const Allocator* const internalAllocator, const int capacity, const Deallocator nullable deallocator); // capacity gets rounded up to a power of two
+bool mpmcQueueTryPush(MPMCQueue* const queue, void* const value); // returns false if the queue is full
+void mpmcQueuePush(MPMCQueue* const queue, void* const value); // yields until there's a free cell if the queue is full
+void* nullable mpmcQueuePop(MPMCQueue* const queue); // returns null if the queue is empty, but also if the producer of the oldest value hasn't finished storing it
+bool mpmcQueueDrained(MPMCQueue* const queue); // whether every pushed value has been popped, unlike a null from the pop it holds no value being stored
+int mpmcQueueCapacity(MPMCQueue* const queue);
+int mpmcQueueSize(MPMCQueue* const queue); // approximate if accessed concurrently
+void mpmcQueueDestroy(MPMCQueue* const queue); // not thread-safe, remaining values get deallocated
@@ -0,0 +1,67 @@
+
+#include <stdatomic.h>
+#include "../utils/rwMutex.h"
+#include "mpmcQueue.h"
+#include "deque.h"
+#include "spillingQueue.h"
+
+// values go into the ring while it has room and nothing has spilled, into the overflow otherwise; consumers only look into the overflow once the ring is drained
+// (a null from the ring's pop isn't enough, it also comes while a producer is in the middle of storing a value),
+// so a producer's values come out in the order they went in - after one of them has spilled, the following ones spill too until the overflow is drained
+
+struct _SpillingQueue {
+    const Allocator* const internalAllocator;
+    MPMCQueue* const ring;
+    RWMutex* const rwMutex;
+    Deque* const overflow; // guarded by rwMutex
+    atomic int spilled; // the overflow's size, so neither side touches the lock while nothing has spilled
+};
+
+SpillingQueue* spillingQueueCreate(const Allocator* const internalAllocator, const int capacity, const Deallocator nullable deallocator) {
+    SpillingQueue* const queue = internalAllocator->malloc(sizeof *queue);
+    unconst(queue->internalAllocator) = internalAllocator;
+    unconst(queue->ring) = mpmcQueueCreate(internalAllocator, capacity, deallocator);
+    unconst(queue->rwMutex) = rwMutexCreate(RW_MUTEX_FLAG_NONE);
+    unconst(queue->overflow) = dequeCreate(internalAllocator, false, deallocator);
+    atomic_init(&queue->spilled, 0);
+    return queue;
+}
+
+void spillingQueuePush(SpillingQueue* const queue, void* const value) {
+    if (!atomic_load_explicit(&queue->spilled, memory_order_acquire) && mpmcQueueTryPush(queue->ring, value)) return;
+
+    rwMutexWriteLock(queue->rwMutex);
+    dequePushBack(queue->overflow, value);
+    atomic_fetch_add_explicit(&queue->spilled, 1, memory_order_release);
+    rwMutexWriteUnlock(queue->rwMutex);
+}
+
+void* nullable spillingQueuePop(SpillingQueue* const queue) {
+    void* value;
+    while (!(value = mpmcQueuePop(queue->ring))) {
+        if (!atomic_load_explicit(&queue->spilled, memory_order_acquire)) return nullptr;
+        if (mpmcQueueDrained(queue->ring)) break;
+        xyield(); // a producer is still storing a value into the ring, the values that spilled after it must wait for it
+    }
+    if (value) return value;
+
+    rwMutexWriteLock(queue->rwMutex);
+    if ((value = dequePopFirst(queue->overflow))) atomic_fetch_sub_explicit(&queue->spilled, 1, memory_order_release);
+    rwMutexWriteUnlock(queue->rwMutex);
+    return value;
+}
+
+int spillingQueueSize(SpillingQueue* const queue) {
+    return mpmcQueueSize(queue->ring) + atomic_load_explicit(&queue->spilled, memory_order_relaxed);
+}
+
+int spillingQueueSpilled(SpillingQueue* const queue) {
+    return atomic_load_explicit(&queue->spilled, memory_order_relaxed);
+}
+
+void spillingQueueDestroy(SpillingQueue* const queue) {
+    mpmcQueueDestroy(queue->ring);
+    dequeDestroy(queue->overflow);
+    rwMutexDestroy(queue->rwMutex);
+    queue->internalAllocator->free(queue);
+}
@@ -0,0 +1,16 @@
+
+#pragma once
+
+#include "../defs.h"
+
+// Unbounded multi-producer multi-consumer FIFO queue: a bounded lock-free ring (see mpmcQueue) that spills over into a locked deque once full,
+// so pushing never waits for a consumer, which matters when the pushing thread is the consumer itself; thread-safe, only works with non-null values
+
+typedef struct _SpillingQueue SpillingQueue;
+
+SpillingQueue* spillingQueueCreate(const Allocator* const internalAllocator, const int capacity, const Deallocator nullable deallocator); // capacity - of the ring, gets rounded up to a power of two
+void spillingQueuePush(SpillingQueue* const queue, void* const value);
+void* nullable spillingQueuePop(SpillingQueue* const queue); // returns null if the queue is empty
+int spillingQueueSize(SpillingQueue* const queue); // approximate if accessed concurrently
+int spillingQueueSpilled(SpillingQueue* const queue); // how many of them are in the overflow
+void spillingQueueDestroy(SpillingQueue* const queue); // not thread-safe, remaining values get deallocated
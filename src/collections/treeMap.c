@@ -1,4 +1,5 @@
 
+#include <limits.h>
 #include "../utils/rwMutex.h"
 #include "treeMap.h"
 
@@ -28,10 +29,11 @@ struct _TreeMap {
     bool iterating;
 };
 
-struct _TreeMapIterator {
+struct _TreeMapIterator { // walks via parent pointers so it takes constant memory regardless of the map's size
     TreeMap* const map;
-    int currentStackTop;
-    Node* nullable stack[];
+    Node* nullable next;
+    int last; // inclusive bound of the range
+    bool reverse;
 };
 
 static const int MAX_SIZE = ~0u / 2u; // 0x7fffffff
@@ -40,7 +42,7 @@ TreeMap* treeMapCreate(const Allocator* const internalAllocator, const bool sync
     TreeMap* const map = internalAllocator->malloc(sizeof *map);
     unconst(map->internalAllocator) = internalAllocator;
     unconst(map->deallocator) = deallocator;
-    unconst(map->rwMutex) = synchronized ? rwMutexCreate() : nullptr;
+    unconst(map->rwMutex) = synchronized ? rwMutexCreate(RW_MUTEX_FLAG_RECURSIVE | (COLLECTIONS_OPTIMISTIC_READS ? RW_MUTEX_FLAG_OPTIMISTIC_READS : RW_MUTEX_FLAG_NONE)) : nullptr;
     map->root = nullptr;
     map->count = 0;
     map->iterating = false;
@@ -52,21 +54,17 @@ static inline void xRwMutexCommand(TreeMap* const map, const RWMutexCommand comm
 }
 
 int treeMapCount(TreeMap* const map) {
+    if (COLLECTIONS_OPTIMISTIC_READS && map->rwMutex) return rwMutexOptimisticRead(map->rwMutex, map->count);
+
     xRwMutexCommand(map, RW_MUTEX_COMMAND_READ_LOCK);
     const int count = map->count;
     xRwMutexCommand(map, RW_MUTEX_COMMAND_READ_UNLOCK);
     return count;
 }
 
-static int iteratorSize(TreeMap* const map) {
-    return (int) sizeof(TreeMapIterator) + (int) sizeof(Node*) * map->count;
-}
-
 int treeMapIteratorSize(TreeMap* const map) {
-    xRwMutexCommand(map, RW_MUTEX_COMMAND_READ_LOCK);
-    const int size = iteratorSize(map);
-    xRwMutexCommand(map, RW_MUTEX_COMMAND_READ_UNLOCK);
-    return size;
+    USED(map);
+    return (int) sizeof(TreeMapIterator);
 }
 
 static Node* nodeCreate(TreeMap* const map, const int key, void* const value) {
@@ -262,6 +260,37 @@ void* nullable treeMapSearchMinOrMax(TreeMap* const map, const bool minOrMax, in
     }
 }
 
+static Node* nullable searchFloorOrCeiling(const TreeMap* const map, const int key, const bool floorOrCeiling) {
+    Node* node = map->root, * candidate = nullptr;
+    while (node) {
+        if (key == node->key) return node;
+
+        if (floorOrCeiling == (key > node->key)) { // node satisfies the bound - remember it and look for a closer one
+            candidate = node;
+            node = floorOrCeiling ? node->right : node->left;
+        } else
+            node = floorOrCeiling ? node->left : node->right;
+    }
+    return candidate;
+}
+
+static void* nullable floorOrCeiling(TreeMap* const map, const int key, const bool floorOrCeiling, int* nullable const foundKey) {
+    xRwMutexCommand(map, RW_MUTEX_COMMAND_READ_LOCK);
+    Node* const node = searchFloorOrCeiling(map, key, floorOrCeiling);
+    if (foundKey) *foundKey = node ? node->key : 0;
+    void* const value = node ? node->value : nullptr;
+    xRwMutexCommand(map, RW_MUTEX_COMMAND_READ_UNLOCK);
+    return value;
+}
+
+void* nullable treeMapFloor(TreeMap* const map, const int key, int* nullable const foundKey) {
+    return floorOrCeiling(map, key, true, foundKey);
+}
+
+void* nullable treeMapCeiling(TreeMap* const map, const int key, int* nullable const foundKey) {
+    return floorOrCeiling(map, key, false, foundKey);
+}
+
 static void transplant(TreeMap* const map, Node* nullable const u, Node* nullable const v) {
     if (!parentOf(u)) map->root = v;
     else if (u == leftOf(parentOf(u))) setLeftOf(parentOf(u), v);
@@ -370,20 +399,20 @@ void treeMapDelete(TreeMap* const map, const int key) {
     xRwMutexCommand(map, RW_MUTEX_COMMAND_WRITE_UNLOCK);
 }
 
-static void iteratePutLeftChildrenIntoStack(TreeMapIterator* const iterator, Node* nullable node) {
-    while (node) {
-        assert(iterator->currentStackTop + 1 <= iterator->map->count);
-        iterator->stack[++iterator->currentStackTop] = node;
-        node = node->left;
-    }
-}
+static Node* nullable successorOrPredecessor(Node* const node, const bool successorOrPredecessor) {
+    Node* const child = successorOrPredecessor ? node->right : node->left;
+    if (child) return searchMinOrMax(child, successorOrPredecessor);
 
-static inline void clearIteratorStack(TreeMapIterator* const iterator) {
-    xmemset(iterator->stack, 0, sizeof(Node*) * iterator->map->count);
+    const Node* current = node; // climb up until coming from the opposite side
+    Node* parent = node->parent;
+    while (parent && current == (successorOrPredecessor ? parent->right : parent->left)) {
+        current = parent;
+        parent = parent->parent;
+    }
+    return parent;
 }
 
-#undef treeMapIterateBegin
-void treeMapIterateBegin(TreeMap* const map, TreeMapIterator* const iterator) {
+static void iterateBegin(TreeMap* const map, TreeMapIterator* const iterator, const int first, const int last) {
     xRwMutexCommand(map, RW_MUTEX_COMMAND_WRITE_LOCK);
     assert(!map->iterating);
     map->iterating = true;
@@ -392,52 +421,64 @@ void treeMapIterateBegin(TreeMap* const map, TreeMapIterator* const iterator) {
     xRwMutexCommand(map, RW_MUTEX_COMMAND_READ_LOCK);
 
     unconst(iterator->map) = map;
-    iterator->currentStackTop = -1;
-    clearIteratorStack(iterator);
+    iterator->reverse = first > last;
+    iterator->last = last;
+    iterator->next = searchFloorOrCeiling(map, first, iterator->reverse);
+}
+
+#undef treeMapIterateBegin
+void treeMapIterateBegin(TreeMap* const map, TreeMapIterator* const iterator) {
+    iterateBegin(map, iterator, INT_MIN, INT_MAX);
+}
 
-    iteratePutLeftChildrenIntoStack(iterator, map->root);
+#undef treeMapIterateReverseBegin
+void treeMapIterateReverseBegin(TreeMap* const map, TreeMapIterator* const iterator) {
+    iterateBegin(map, iterator, INT_MAX, INT_MIN);
 }
 
-void* nullable treeMapIterate(TreeMapIterator* const iterator) {
+#undef treeMapIterateRangeBegin
+void treeMapIterateRangeBegin(TreeMap* const map, TreeMapIterator* const iterator, const int from, const int to) {
+    iterateBegin(map, iterator, from, to);
+}
+
+void* nullable treeMapIterate(TreeMapIterator* const iterator, int* nullable const key) {
     assert(iterator->map->iterating);
-    if (iterator->currentStackTop < 0) return nullptr;
 
-    Node* const node = iterator->stack[iterator->currentStackTop--];
+    Node* const node = iterator->next;
+    if (!node || (iterator->reverse ? node->key < iterator->last : node->key > iterator->last)) {
+        iterator->next = nullptr;
+        if (key) *key = 0;
+        return nullptr;
+    }
 
-    if (rightOf(node))
-        iteratePutLeftChildrenIntoStack(iterator, node->right);
+    iterator->next = successorOrPredecessor(node, !iterator->reverse);
 
-    return node ? node->value : nullptr;
+    if (key) *key = node->key;
+    return node->value;
 }
 
 void treeMapIterateEnd(TreeMapIterator* const iterator) {
-    xRwMutexCommand(iterator->map, RW_MUTEX_COMMAND_READ_UNLOCK);
-
-    xRwMutexCommand(iterator->map, RW_MUTEX_COMMAND_WRITE_LOCK);
     assert(iterator->map->iterating);
-    iterator->map->iterating = false;
-    xRwMutexCommand(iterator->map, RW_MUTEX_COMMAND_WRITE_UNLOCK);
+    iterator->map->iterating = false; // still under the read lock, which keeps the writers out - otherwise a waiting one could get in before the flag is cleared
+    xRwMutexCommand(iterator->map, RW_MUTEX_COMMAND_READ_UNLOCK);
 
-    iterator->currentStackTop = -1;
-    clearIteratorStack(iterator);
+    iterator->next = nullptr;
 }
 
 void treeMapDestroy(TreeMap* const map) {
-    if (map->rwMutex) {
-        rwMutexDestroy(map->rwMutex);
-        unconst(map->rwMutex) = nullptr; // so the following dealing with iterator won't mess up the mutex
-    }
-
+    if (map->rwMutex) rwMutexDestroy(map->rwMutex);
     assert(!map->iterating);
 
-    TreeMapIterator* const iterator = xalloca2(iteratorSize(map));
-    treeMapIterateBegin(map, iterator);
-
-    Node* node;
-    while ((node = treeMapIterate(iterator)))
-        nodeDestroy(map, node);
-
-    treeMapIterateEnd(iterator); // unnecessary
+    for (Node* node = map->root; node;) { // post-order, detaching each freed leaf from its parent so no stack is needed
+        if (node->left) node = node->left;
+        else if (node->right) node = node->right;
+        else {
+            Node* const parent = node->parent;
+            if (parent) parent->left == node ? (parent->left = nullptr) : (parent->right = nullptr);
+            nodeDestroy(map, node);
+            node = parent;
+        }
+    }
 
     map->internalAllocator->free(map);
 }
@@ -3,7 +3,7 @@
 
 #include "../defs.h"
 
-// Red-Black Tree (self-balancing binary search tree), optionally thread-safe, only works with non-null and unique values
+// Red-Black Tree (self-balancing binary search tree), optionally thread-safe (the lock is recursive, so the map can be searched while iterating it), only works with non-null and unique values
 // TODO: embed in the Hashtable, replacing the linked list
 
 typedef struct _TreeMap TreeMap;
@@ -11,13 +11,19 @@ typedef struct _TreeMapIterator TreeMapIterator;
 
 TreeMap* treeMapCreate(const Allocator* const internalAllocator, const bool synchronized, const Deallocator nullable deallocator);
 int treeMapCount(TreeMap* const map);
-int treeMapIteratorSize(TreeMap* const map);
+int treeMapIteratorSize(TreeMap* const map); // constant, iterators don't depend on the map's size
 void treeMapInsert(TreeMap* const map, const int key, void* const value);
 void* nullable treeMapSearchKey(TreeMap* const map, const int key);
 void* nullable treeMapSearchMinOrMax(TreeMap* const map, const bool minOrMax, int* nullable const key);
+void* nullable treeMapFloor(TreeMap* const map, const int key, int* nullable const foundKey); // the greatest key less than or equal to the given one
+void* nullable treeMapCeiling(TreeMap* const map, const int key, int* nullable const foundKey); // the least key greater than or equal to the given one
 void treeMapDelete(TreeMap* const map, const int key);
-void treeMapIterateBegin(TreeMap* const map, TreeMapIterator* const iterator);
+void treeMapIterateBegin(TreeMap* const map, TreeMapIterator* const iterator); // ascending
 #define treeMapIterateBegin(x, y) treeMapIterateBegin(x, (y = xalloca2(treeMapIteratorSize(x))))
-void* nullable treeMapIterate(TreeMapIterator* const iterator); // assumed readonly - don't do any write operations while iterating, iteration involves mutex read-locking
+void treeMapIterateReverseBegin(TreeMap* const map, TreeMapIterator* const iterator); // descending
+#define treeMapIterateReverseBegin(x, y) treeMapIterateReverseBegin(x, (y = xalloca2(treeMapIteratorSize(x))))
+void treeMapIterateRangeBegin(TreeMap* const map, TreeMapIterator* const iterator, const int from, const int to); // both inclusive, descending if from > to
+#define treeMapIterateRangeBegin(x, y, f, t) treeMapIterateRangeBegin(x, (y = xalloca2(treeMapIteratorSize(x))), f, t)
+void* nullable treeMapIterate(TreeMapIterator* const iterator, int* nullable const key); // assumed readonly - don't do any write operations while iterating, iteration involves mutex read-locking
 void treeMapIterateEnd(TreeMapIterator* const iterator);
 void treeMapDestroy(TreeMap* const map);
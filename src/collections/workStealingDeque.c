@@ -0,0 +1,102 @@
+
+#include <stdatomic.h>
+#include "workStealingDeque.h"
+
+// top only grows (thieves and the owner's last-value pop claim values there via compare-and-swap), bottom is written by the owner only;
+// the values in between, [top, bottom), are present, positions map onto the ring buffer by the mask
+
+enum : int {
+    CACHE_LINE_SIZE = 64
+};
+
+struct _WorkStealingDeque {
+    const Allocator* const internalAllocator;
+    const Deallocator nullable deallocator;
+    void* atomic* const values;
+    const long mask; // capacity - 1
+    byte padding0[CACHE_LINE_SIZE];
+    atomic long top; // thieves' and owner's counters live on separate cache lines to avoid false sharing
+    byte padding1[CACHE_LINE_SIZE - sizeof(atomic long)];
+    atomic long bottom;
+    byte padding2[CACHE_LINE_SIZE - sizeof(atomic long)];
+};
+
+static const int MAX_CAPACITY = 1 << 30;
+
+WorkStealingDeque* workStealingDequeCreate(const Allocator* const internalAllocator, const int capacity, const Deallocator nullable deallocator) {
+    assert(capacity > 0 && capacity <= MAX_CAPACITY);
+
+    int actualCapacity = 1;
+    while (actualCapacity < capacity) actualCapacity <<= 1;
+
+    WorkStealingDeque* const deque = internalAllocator->malloc(sizeof *deque);
+    unconst(deque->internalAllocator) = internalAllocator;
+    unconst(deque->deallocator) = deallocator;
+    unconst(deque->values) = internalAllocator->malloc(actualCapacity * sizeof(void*));
+    unconst(deque->mask) = actualCapacity - 1;
+
+    for (int i = 0; i < actualCapacity; atomic_init(deque->values + i++, nullptr));
+    atomic_init(&deque->top, 0);
+    atomic_init(&deque->bottom, 0);
+    return deque;
+}
+
+bool workStealingDequePush(WorkStealingDeque* const deque, void* const value) {
+    assert(value);
+
+    const long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    const long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    if (bottom - top > deque->mask) return false;
+
+    atomic_store_explicit(deque->values + (bottom & deque->mask), value, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release); // the value is visible before the bottom that makes it stealable
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    return true;
+}
+
+void* nullable workStealingDequePop(WorkStealingDeque* const deque) {
+    const long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed); // reserve the bottom value before looking at the top
+    atomic_thread_fence(memory_order_seq_cst);
+    long top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    if (top > bottom) { // was empty
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        return nullptr;
+    }
+
+    void* value = atomic_load_explicit(deque->values + (bottom & deque->mask), memory_order_relaxed);
+    if (top == bottom) { // the last one, thieves may be after it too
+        if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed))
+            value = nullptr;
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    }
+
+    return value;
+}
+
+void* nullable workStealingDequeSteal(WorkStealingDeque* const deque) {
+    long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    const long bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+    if (top >= bottom) return nullptr;
+
+    void* const value = atomic_load_explicit(deque->values + (top & deque->mask), memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed))
+        return nullptr; // lost the race, the value belongs to someone else
+    return value;
+}
+
+int workStealingDequeSize(WorkStealingDeque* const deque) {
+    const long size = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - atomic_load_explicit(&deque->top, memory_order_relaxed);
+    return (int) max(0l, min(size, deque->mask + 1));
+}
+
+void workStealingDequeDestroy(WorkStealingDeque* const deque) {
+    void* value;
+    while ((value = workStealingDequePop(deque)))
+        if (deque->deallocator) deque->deallocator(value);
+
+    deque->internalAllocator->free(deque->values);
+    deque->internalAllocator->free(deque);
+}
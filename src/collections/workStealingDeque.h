@@ -0,0 +1,17 @@
+
+#pragma once
+
+#include "../defs.h"
+
+// Bounded lock-free work-stealing deque (Chase-Lev, with the C11 memory orderings of Lê et al.) - the owner thread pushes and pops
+// at the bottom (lifo, the most recently pushed values are the hottest in its cache), any other thread steals from the top (fifo);
+// the owner synchronizes with thieves only when they race for the last value, only works with non-null values
+
+typedef struct _WorkStealingDeque WorkStealingDeque;
+
+WorkStealingDeque* workStealingDequeCreate(const Allocator* const internalAllocator, const int capacity, const Deallocator nullable deallocator); // capacity gets rounded up to a power of two
+bool workStealingDequePush(WorkStealingDeque* const deque, void* const value); // owner only, returns false if the deque is full
+void* nullable workStealingDequePop(WorkStealingDeque* const deque); // owner only, returns null if the deque is empty
+void* nullable workStealingDequeSteal(WorkStealingDeque* const deque); // any thread, returns null if the deque is empty or if another thief (or the owner) has won the race for the value
+int workStealingDequeSize(WorkStealingDeque* const deque); // approximate if accessed concurrently
+void workStealingDequeDestroy(WorkStealingDeque* const deque); // not thread-safe, remaining values get deallocated
@@ -1,4 +1,5 @@
 
+#include <stdatomic.h>
 #include <SDL3/SDL.h>
 #include "../integration/xlvgl.h"
 #include "../integration/video.h"
@@ -6,39 +7,57 @@
 #include "../integration/resources.h"
 #include "../scenes/scenes.h"
 #include "../crypto/crypto.h"
-#include "../collections/list.h"
+#include "../collections/spillingQueue.h"
+#include "../collections/hashtable.h"
+#include "../utils/poolAllocator.h"
+#include "../utils/executor.h"
+#include "../utils/timerWheel.h"
+#include "../utils/coroutine.h"
+#include "../utils/reactor.h"
+#include "../utils/asyncIo.h"
 #include "../consts.h"
 #include "lifecycle.h"
 
 typedef struct {
     const LifecycleAsyncActionFunction function;
     void* nullable const parameter;
-    const int delayMillis;
+    const LifecycleLooper looper; // for timers only
 } AsyncAction;
 
-typedef enum {
-    LOOPER_BACKGROUND,
-    LOOPER_MAIN
-} Looper;
-
-static const int UPDATE_PERIOD = 16; // floorf(1000.0f / 60.0f)
+static const int ACTIONS_BUDGET = 8; // milliseconds (half a 60 fps frame) per main loop iteration for running the queued main thread actions, the rest are left for the next iteration so the ui keeps responding
+static const int MAX_WAIT = 1'000; // milliseconds, the main loop still wakes up that often while idle for the polled chores (heap profile dumps)
+static const int ACTIONS_QUEUE_CAPACITY = 1024; // of the lock-free part, the rest spill over into a locked list as the main thread, the only consumer, can't wait for itself
+static const int ACTIONS_PER_POOL_PAGE = 256;
+static const int COROUTINE_STACK_SIZE = 64 * 1024; // pages are only committed once touched
+static const int FILE_IO_DEPTH = 256, FILE_IO_BUFFERS = 8, FILE_IO_BUFFER_SIZE = 1024 * 1024; // the registered buffers stay pinned in memory
 
 static atomic bool gInitialized = false;
 static atomic bool gRunning = false;
+static atomic bool gWakeUpPosted = false; // whether there's a wake up event in sdl's queue yet to be seen by the main loop, so a burst of actions posts only one
+static unsigned gWakeUpEvent = 0; // a user event type that ends the main loop's waiting when a main thread action is enqueued
 
 static RWMutex* gUIRWMutex = nullptr;
+static PoolAllocator* gActionsPool = nullptr; // actions are created and freed by different threads
+static Executor* gBackgroundExecutor = nullptr; // a worker per cpu core, background actions run in parallel as soon as they're submitted
+static AsyncIo* gFileIo = nullptr; // its completions are reaped by the net looper
+static RWMutex* gTimersRWMutex = nullptr; // timers are scheduled and cancelled from any thread, only the main loop advances them
+static TimerWheel* gTimerWheel = nullptr; // <AsyncAction*>, in SDL_GetTicks' milliseconds, dispatched to the actions' loopers once due
+static RWMutex* gCoroutinesRWMutex = nullptr;
+static Reactor* gNetReactor = nullptr; // run by the net looper's thread, the sockets are watched there
+static Hashtable* gCoroutines = nullptr; // <address, Coroutine*>, the unfinished ones, those left at quit get destroyed without being resumed
 
 static struct {
-    List* nullable queue; // <AsyncAction*>
+    SpillingQueue* nullable queue; // <AsyncAction*>, fifo, never blocks the producers
     SDL_Thread* nullable thread;
 }
     gMainActionsLooper = {nullptr, nullptr},
-    gBackgroundActionsLooper = {nullptr, nullptr},
     gNetActionsLooper = {nullptr, nullptr};
 
 static unsigned getTicks(void);
-static int backgroundActionsLoop(void* nullable const);
 static int netActionsLoop(void* nullable const);
+static void freeAction(void* const action);
+static void destroyCoroutine(void* const coroutine);
+static void reapFileIo(const int, const int, void* nullable const);
 
 void lifecycleInit(void) {
     assert(!gInitialized);
@@ -52,10 +71,20 @@ void lifecycleInit(void) {
     lv_tick_set_cb(getTicks);
     lv_delay_set_cb(SDL_Delay);
 
-    gUIRWMutex = rwMutexCreate();
-
-    gMainActionsLooper.queue = listCreate(DEFAULT_ALLOCATOR, true, xfree);
-    gBackgroundActionsLooper.queue = listCreate(DEFAULT_ALLOCATOR, true, xfree);
+#ifdef DEBUG
+    gUIRWMutex = rwMutexCreate(RW_MUTEX_FLAG_STATISTICS); // to see how much the other threads contend with the rendering
+#else
+    gUIRWMutex = rwMutexCreate(RW_MUTEX_FLAG_NONE);
+#endif
+
+    gActionsPool = poolAllocatorCreate(sizeof(AsyncAction), ACTIONS_PER_POOL_PAGE, true, true);
+    gMainActionsLooper.queue = spillingQueueCreate(DEFAULT_ALLOCATOR, ACTIONS_QUEUE_CAPACITY, freeAction);
+    gTimersRWMutex = rwMutexCreate(RW_MUTEX_FLAG_NONE);
+    gTimerWheel = timerWheelCreate(SDL_GetTicks(), freeAction);
+    assert(gWakeUpEvent = SDL_RegisterEvents(1));
+    gCoroutinesRWMutex = rwMutexCreate(RW_MUTEX_FLAG_NONE);
+    gCoroutines = hashtableCreate(DEFAULT_ALLOCATOR, destroyCoroutine);
+    gNetReactor = reactorCreate();
 
     videoInit();
     inputInit();
@@ -64,7 +93,9 @@ void lifecycleInit(void) {
     cryptoInit();
 //    netInit();
 
-    assert(gBackgroundActionsLooper.thread = SDL_CreateThread(backgroundActionsLoop, constsConcatenateTitleWith(":bg"), nullptr));
+    gBackgroundExecutor = executorCreate(0, constsConcatenateTitleWith(":bg"));
+    gFileIo = asyncIoCreate(FILE_IO_DEPTH, FILE_IO_BUFFERS, FILE_IO_BUFFER_SIZE, gBackgroundExecutor, ASYNC_IO_FLAG_NONE);
+    if (asyncIoRing(gFileIo)) reactorWatch(gNetReactor, asyncIoEventFileDescriptor(gFileIo), REACTOR_EVENT_READABLE, reapFileIo, nullptr);
     assert(gNetActionsLooper.thread = SDL_CreateThread(netActionsLoop, constsConcatenateTitleWith(":net"), nullptr));
 }
 
@@ -72,76 +103,215 @@ static unsigned getTicks(void) {
     return (unsigned) SDL_GetTicks();
 }
 
-static void delayThread(const unsigned startMillis) {
-    const unsigned differenceMillis = (unsigned) SDL_GetTicks() - startMillis;
-    if (UPDATE_PERIOD > differenceMillis)
-        SDL_Delay(UPDATE_PERIOD - differenceMillis);
+static void freeAction(void* const action) {
+    poolAllocatorAllocator(gActionsPool)->free(action);
+}
+
+static void destroyCoroutine(void* const coroutine) {
+    coroutineDestroy(coroutine);
 }
 
-static AsyncAction* nullable nextAsyncAction(const Looper looper) {
-    return listPopFirst(looper == LOOPER_BACKGROUND ? gBackgroundActionsLooper.queue : gMainActionsLooper.queue);
+static int netActionsLoop(void* nullable const) { // sleeps in epoll until a watched descriptor is ready, no polling periods
+    reactorRun(gNetReactor);
+    return 0;
 }
 
-static void threadLoop(void (* const body)(void)) {
-    while (!gRunning); // wait for main thread to start looping
+bool lifecycleInitialized(void) {
+    return gInitialized;
+}
 
-    unsigned startMillis;
+bool lifecycleRunning(void) {
+    return gRunning;
+}
 
-    while (gRunning) {
-        assert(startMillis = (unsigned) SDL_GetTicks());
-        body();
-        delayThread(startMillis);
-    }
+unsigned long lifecycleCurrentTimeMillis(void) {
+    SDL_Time ticks; // TODO: replace with glibc's clock_gettime(CLOCK_REALTIME) and move to defs module
+    assert(SDL_GetCurrentTime(&ticks));
+    return ticks / 1'000'000ul;
+}
+
+static AsyncAction* newAction(const LifecycleAsyncActionFunction function, void* nullable const parameter, const LifecycleLooper looper) {
+    AsyncAction* const action = poolAllocatorAllocator(gActionsPool)->malloc(sizeof *action);
+    assignToStructWithConsts(action, function, parameter, looper)
+    return action;
+}
+
+void lifecycleRunInBackground(const LifecycleAsyncActionFunction function, void* nullable const parameter, const int delayMillis) {
+    assert(gInitialized && delayMillis >= 0);
+
+    if (!delayMillis) executorSubmit(gBackgroundExecutor, function, parameter);
+    else lifecycleScheduleTimer(function, parameter, LIFECYCLE_LOOPER_BACKGROUND, delayMillis, 0);
+}
+
+static void wakeUpMainLoop(void) { // the flag is cleared by the main loop before it looks at the timers and the queue, so whatever comes after that always posts an event
+    if (atomic_exchange(&gWakeUpPosted, true)) return;
+    SDL_PushEvent(&(SDL_Event) {.user = {.type = gWakeUpEvent}}); // if sdl's queue is full, the main loop is awake anyway
 }
 
-static void backgroundActionsLoopBody(void) {
+void lifecycleRunInMainThread(const LifecycleAsyncActionFunction function, void* nullable const parameter) {
+    assert(gInitialized);
+    spillingQueuePush(gMainActionsLooper.queue, newAction(function, parameter, LIFECYCLE_LOOPER_MAIN));
+    wakeUpMainLoop();
+}
+
+unsigned long lifecycleScheduleTimer(const LifecycleAsyncActionFunction function, void* nullable const parameter, const LifecycleLooper looper, const int delayMillis, const int periodMillis) {
+    assert(gInitialized && delayMillis >= 0 && periodMillis >= 0);
+
+    AsyncAction* const action = newAction(function, parameter, looper);
+
+    const unsigned long due = SDL_GetTicks() + (unsigned long) delayMillis;
+
+    rwMutexWriteLock(gTimersRWMutex);
+    const bool earliest = due < timerWheelNextExpiry(gTimerWheel); // than what the main loop might be waiting for
+    const unsigned long timer = timerWheelSchedule(gTimerWheel, due, periodMillis, action);
+    rwMutexWriteUnlock(gTimersRWMutex);
+
+    if (earliest) wakeUpMainLoop();
+    return timer;
+}
+
+bool lifecycleCancelTimer(const unsigned long timer) {
+    assert(gInitialized);
+
+    rwMutexWriteLock(gTimersRWMutex);
+    AsyncAction* const action = timerWheelCancel(gTimerWheel, timer);
+    rwMutexWriteUnlock(gTimersRWMutex);
+
+    if (action) freeAction(action);
+    return action;
+}
+
+static void dispatchTimer(void* const value, const bool periodic) { // a periodic timer keeps its action, each firing gets a copy if it needs one; called by the main loop, which drains its queue right after, thus no waking up
+    AsyncAction* const action = value;
+
+    if (action->looper == LIFECYCLE_LOOPER_BACKGROUND) {
+        executorSubmit(gBackgroundExecutor, action->function, action->parameter);
+        if (!periodic) freeAction(action);
+    } else
+        spillingQueuePush(gMainActionsLooper.queue, periodic ? newAction(action->function, action->parameter, action->looper) : action);
+}
+
+static unsigned long advanceTimers(void) { // returns when to advance them next, in SDL_GetTicks' time
+    rwMutexWriteLock(gTimersRWMutex);
+    timerWheelAdvance(gTimerWheel, SDL_GetTicks(), ^(void* const value, const bool periodic) { dispatchTimer(value, periodic); });
+    const unsigned long expiry = timerWheelNextExpiry(gTimerWheel);
+    rwMutexWriteUnlock(gTimersRWMutex);
+    return expiry;
+}
+
+static bool runMainActions(void) { // returns whether there are actions left due to running out of the budget
+    const unsigned long startMillis = SDL_GetTicks();
     AsyncAction* action;
-    if ((action = nextAsyncAction(LOOPER_BACKGROUND))) {
-        if (action->delayMillis) SDL_Delay(action->delayMillis);
-        if (gRunning) action->function(action->parameter);
-        xfree(action);
+
+    while ((action = spillingQueuePop(gMainActionsLooper.queue))) {
+        action->function(action->parameter);
+        freeAction(action);
+
+        if (SDL_GetTicks() - startMillis >= (unsigned long) ACTIONS_BUDGET) return true;
     }
+
+    return false;
 }
 
-static int backgroundActionsLoop(void* nullable const) {
-    threadLoop(backgroundActionsLoopBody);
-    return 0;
+static int waitTimeout(const unsigned uiMillis, const unsigned long timersExpiry) { // until whichever comes first - the next lvgl timer or the next lifecycle timer
+    const unsigned long now = SDL_GetTicks();
+    const unsigned long timersMillis = timersExpiry > now ? timersExpiry - now : 0;
+    return (int) min(min((unsigned long) uiMillis /* LV_NO_TIMER_READY if there are no timers */, timersMillis), (unsigned long) MAX_WAIT);
 }
 
-static int netActionsLoop(void* nullable const) {
-//    threadLoop(netLoop);
-    return 0;
+static void resumeCoroutine(void* nullable const coroutine) { // a coroutine arranges its own next resumption before yielding
+    if (coroutineResume(coroutine)) return;
+
+    rwMutexWriteLock(gCoroutinesRWMutex);
+    hashtableRemove(gCoroutines, (unsigned long) coroutine, true);
+    rwMutexWriteUnlock(gCoroutinesRWMutex);
 }
 
-bool lifecycleInitialized(void) {
-    return gInitialized;
+void lifecycleRunCoroutine(const LifecycleAsyncActionFunction function, void* nullable const parameter) {
+    assert(gInitialized);
+
+    Coroutine* const coroutine = coroutineCreate(function, parameter, COROUTINE_STACK_SIZE);
+
+    rwMutexWriteLock(gCoroutinesRWMutex);
+    hashtablePut(gCoroutines, (unsigned long) coroutine, coroutine);
+    rwMutexWriteUnlock(gCoroutinesRWMutex);
+
+    lifecycleRunInMainThread(resumeCoroutine, coroutine);
 }
 
-bool lifecycleRunning(void) {
-    return gRunning;
+void lifecycleCoroutineSleep(const int millis) {
+    assert(gInitialized && millis >= 0);
+
+    Coroutine* const coroutine = coroutineCurrent();
+    assert(coroutine);
+
+    if (!millis) lifecycleRunInMainThread(resumeCoroutine, coroutine);
+    else lifecycleScheduleTimer(resumeCoroutine, coroutine, LIFECYCLE_LOOPER_MAIN, millis, 0);
+
+    coroutineYield();
 }
 
-unsigned long lifecycleCurrentTimeMillis(void) {
-    SDL_Time ticks; // TODO: replace with glibc's clock_gettime(CLOCK_REALTIME) and move to defs module
-    assert(SDL_GetCurrentTime(&ticks));
-    return ticks / 1'000'000ul;
+void lifecycleCoroutineYield(void) {
+    lifecycleCoroutineSleep(0);
 }
 
-static void scheduleAction(const LifecycleAsyncActionFunction function, void* nullable const parameter, const int delayMillis, const Looper looper) {
+void lifecycleWatchFileDescriptor(const int fileDescriptor, const int events, const ReactorCallback callback, void* nullable const parameter) {
     assert(gInitialized);
+    reactorWatch(gNetReactor, fileDescriptor, events, callback, parameter);
+}
 
-    AsyncAction* const action = xmalloc(sizeof *action);
-    assignToStructWithConsts(action, function, parameter, delayMillis)
+bool lifecycleUnwatchFileDescriptor(const int fileDescriptor) {
+    assert(gInitialized);
+    return reactorUnwatch(gNetReactor, fileDescriptor);
+}
 
-    listAddFront(looper == LOOPER_BACKGROUND ? gBackgroundActionsLooper.queue : gMainActionsLooper.queue, action);
+typedef struct {
+    Coroutine* const coroutine;
+    int events;
+} FileDescriptorWait;
+
+static void resumeWaiting(const int, const int events, void* nullable const parameter) { // on the net looper
+    FileDescriptorWait* const wait = parameter;
+    wait->events = events;
+    lifecycleRunInMainThread(resumeCoroutine, wait->coroutine);
 }
 
-void lifecycleRunInBackground(const LifecycleAsyncActionFunction function, void* nullable const parameter, const int delayMillis) {
-    scheduleAction(function, parameter, delayMillis, LOOPER_BACKGROUND);
+int lifecycleCoroutineWaitFileDescriptor(const int fileDescriptor, const int events) {
+    assert(gInitialized);
+
+    Coroutine* const coroutine = coroutineCurrent();
+    assert(coroutine);
+
+    FileDescriptorWait wait = {coroutine, 0}; // stays on the coroutine's stack while it's suspended
+    reactorWatch(gNetReactor, fileDescriptor, events | REACTOR_EVENT_ONE_SHOT, resumeWaiting, &wait);
+    coroutineYield(); // can't be resumed before this as it's resumed on the main thread, which is running it
+
+    return wait.events;
 }
 
-void lifecycleRunInMainThread(const LifecycleAsyncActionFunction function, void* nullable const parameter) {
-    scheduleAction(function, parameter, 0, LOOPER_MAIN);
+static void reapFileIo(const int, const int, void* nullable const) {
+    asyncIoComplete(gFileIo, false);
+}
+
+void lifecycleFileIo(const bool readOrWrite, const int fileDescriptor, void* const buffer, const int size, const long offset, const bool submit, const AsyncIoCallback callback, void* nullable const parameter) {
+    assert(gInitialized);
+    asyncIoQueue(gFileIo, readOrWrite, fileDescriptor, buffer, size, offset, callback, parameter);
+    if (submit) asyncIoSubmit(gFileIo);
+}
+
+void* nullable lifecycleFileIoAcquireBuffer(void) {
+    assert(gInitialized);
+    return asyncIoAcquireBuffer(gFileIo);
+}
+
+void lifecycleFileIoReleaseBuffer(void* const buffer) {
+    assert(gInitialized);
+    asyncIoReleaseBuffer(gFileIo, buffer);
+}
+
+int lifecycleFileIoBufferSize(void) {
+    assert(gInitialized);
+    return asyncIoBufferSize(gFileIo);
 }
 
 void lifecycleUIMutexCommand(const RWMutexCommand command) {
@@ -153,33 +323,35 @@ void lifecycleLoop(void) {
     assert(gInitialized);
     gRunning = true;
 
-    unsigned startMillis;
-    AsyncAction* action;
+    int timeoutMillis = 0;
 
     while (true) {
-        assert(startMillis = (unsigned) SDL_GetTicks());
+        SDL_Event event; // sleeps until there's an event, a main thread action or a timer to handle
+        bool pending = SDL_WaitEventTimeout(&event, timeoutMillis);
 
         rwMutexWriteLock(gUIRWMutex);
-        lv_timer_periodic_handler();
-
-        SDL_Event event;
-        while (SDL_PollEvent(&event) == 1) {
+        for (; pending; pending = SDL_PollEvent(&event)) {
             if (event.type == SDL_EVENT_QUIT) {
                 rwMutexWriteUnlock(gUIRWMutex);
                 goto end;
             }
+            if (event.type == gWakeUpEvent) continue;
 
             videoProcessEvent(&event);
             inputProcessEvent(&event);
         }
+        const unsigned uiMillis = lv_timer_handler();
         rwMutexWriteUnlock(gUIRWMutex);
 
-        if ((action = nextAsyncAction(LOOPER_MAIN))) {
-            action->function(action->parameter);
-            xfree(action);
-        }
+        gWakeUpPosted = false; // before the next expiry is taken, otherwise an earlier timer scheduled in between would neither be seen nor wake the loop up
+        const unsigned long timersExpiry = advanceTimers();
+        const bool actionsLeft = runMainActions();
+
+#ifdef DEBUG
+        dumpHeapProfileIfRequested();
+#endif
 
-        delayThread(startMillis);
+        timeoutMillis = actionsLeft ? 0 : waitTimeout(uiMillis, timersExpiry);
     }
     end:
 
@@ -189,8 +361,13 @@ void lifecycleLoop(void) {
 void lifecycleQuit(void) {
     assert(gInitialized);
 
+    reactorStop(gNetReactor);
     SDL_WaitThread(gNetActionsLooper.thread, nullptr);
-    SDL_WaitThread(gBackgroundActionsLooper.thread, nullptr);
+
+    while (asyncIoInFlight(gFileIo)) asyncIoComplete(gFileIo, true); // the fallback's operations are background tasks, they mustn't be dropped
+    asyncIoDestroy(gFileIo);
+
+    executorDestroy(gBackgroundExecutor); // the pending actions are dropped
 
 //    netQuit();
     cryptoQuit();
@@ -201,9 +378,19 @@ void lifecycleQuit(void) {
 
     gInitialized = false;
 
-    listDestroy(gBackgroundActionsLooper.queue);
-    listDestroy(gMainActionsLooper.queue);
-
+    timerWheelDestroy(gTimerWheel); // the pending timers are dropped
+    rwMutexDestroy(gTimersRWMutex);
+    reactorDestroy(gNetReactor);
+    hashtableDestroy(gCoroutines); // as are the suspended coroutines
+    rwMutexDestroy(gCoroutinesRWMutex);
+    spillingQueueDestroy(gMainActionsLooper.queue);
+    poolAllocatorDestroy(gActionsPool);
+
+#ifdef DEBUG
+    const RWMutexStatistics statistics = rwMutexStatistics(gUIRWMutex);
+    putsf("ui lock: %lu reads, %lu writes, %lu contended reads, %lu contended writes, %lu ms waited",
+        statistics.readAcquisitions, statistics.writeAcquisitions, statistics.contendedReads, statistics.contendedWrites, statistics.waitNanos / 1'000'000ul);
+#endif
     rwMutexDestroy(gUIRWMutex);
 
     lv_deinit();
@@ -3,15 +3,34 @@
 
 #include "../defs.h"
 #include "../utils/rwMutex.h"
+#include "../utils/reactor.h"
+#include "../utils/asyncIo.h"
 
 typedef void (* LifecycleAsyncActionFunction)(void* nullable const);
 
+typedef enum : int {
+    LIFECYCLE_LOOPER_MAIN,
+    LIFECYCLE_LOOPER_BACKGROUND
+} LifecycleLooper;
+
 void lifecycleInit(void);
 bool lifecycleInitialized(void);
 bool lifecycleRunning(void);
 unsigned long lifecycleCurrentTimeMillis(void);
-void lifecycleRunInBackground(const LifecycleAsyncActionFunction function, void* nullable const parameter, const int delayMillis);
-void lifecycleRunInMainThread(const LifecycleAsyncActionFunction function, void* nullable const parameter);
+void lifecycleRunInBackground(const LifecycleAsyncActionFunction function, void* nullable const parameter, const int delayMillis); // runs on a pool of workers (one per cpu core), in parallel with other background actions and in no particular order; the delay goes through a timer
+void lifecycleRunInMainThread(const LifecycleAsyncActionFunction function, void* nullable const parameter); // wakes the main loop up, which runs the queued actions in order for up to half a frame per iteration
+unsigned long lifecycleScheduleTimer(const LifecycleAsyncActionFunction function, void* nullable const parameter, const LifecycleLooper looper, const int delayMillis, const int periodMillis); // thread-safe, the action is dispatched to the looper once the delay elapses and then every period (zero means one-shot) without drifting, the main loop wakes up for it; returns the timer's id
+bool lifecycleCancelTimer(const unsigned long timer); // thread-safe, returns false if the timer has already fired (one-shot) or been cancelled, an action that has already been dispatched still runs
+void lifecycleRunCoroutine(const LifecycleAsyncActionFunction function, void* nullable const parameter); // thread-safe, runs the function as a coroutine on the main thread, so it can wait without blocking the thread, e.g. a peer session written as sequential code
+void lifecycleCoroutineYield(void); // from within a lifecycle coroutine, lets the rest of the main thread's work run, continues after the actions queued so far
+void lifecycleCoroutineSleep(const int millis); // from within a lifecycle coroutine, continues once the delay elapses, the main thread keeps running meanwhile
+void lifecycleWatchFileDescriptor(const int fileDescriptor, const int events, const ReactorCallback callback, void* nullable const parameter); // thread-safe, the callback runs on the net looper as soon as the descriptor is ready (see reactor.h)
+bool lifecycleUnwatchFileDescriptor(const int fileDescriptor); // thread-safe
+int lifecycleCoroutineWaitFileDescriptor(const int fileDescriptor, const int events); // from within a lifecycle coroutine, suspends it until the descriptor is ready (must not be watched otherwise meanwhile), returns the ready events
+void lifecycleFileIo(const bool readOrWrite, const int fileDescriptor, void* const buffer, const int size, const long offset, const bool submit, const AsyncIoCallback callback, void* nullable const parameter); // thread-safe, reads or writes through io_uring (a thread pool's pread/pwrite if unavailable), the callback runs on the net looper (on a background worker in the fallback mode, or on a submitter that has found the queue full); submit - whether to hand the queued operations over to the kernel, pass false for all but the last one of a batch to make it a single syscall (see asyncIo.h)
+void* nullable lifecycleFileIoAcquireBuffer(void); // thread-safe, a registered buffer of lifecycleFileIoBufferSize bytes, operations on it are cheaper, null if all are taken
+void lifecycleFileIoReleaseBuffer(void* const buffer); // thread-safe
+int lifecycleFileIoBufferSize(void);
 void lifecycleUIMutexCommand(const RWMutexCommand command);
-void lifecycleLoop(void);
+void lifecycleLoop(void); // sleeps between the events, the main thread actions, the lifecycle timers and lvgl's timers
 void lifecycleQuit(void);
@@ -1,4 +1,5 @@
 
+#include <sys/uio.h>
 #include <sodium.h>
 #include "crypto.h"
 
@@ -18,9 +19,16 @@ staticAssert(
     (CRYPTO_SEAL_SIZE == crypto_box_SEALBYTES) &
     (CRYPTO_STREAM_CODER_SIZE == sizeof(crypto_secretstream_xchacha20poly1305_state)) &
     (CRYPTO_STREAM_HEADER_SIZE == crypto_secretstream_xchacha20poly1305_HEADERBYTES) &
-    (CRYPTO_STREAM_MAC_SIZE == crypto_secretstream_xchacha20poly1305_ABYTES - 1) &
+    (CRYPTO_STREAM_MAC_SIZE + (int) sizeof(CryptoStreamEncryptedChunkBundle) == crypto_secretstream_xchacha20poly1305_ABYTES) &
     (CRYPTO_SINGLE_CRYPT_MAC_SIZE == crypto_secretbox_MACBYTES) &
-    (CRYPTO_SINGLE_CRYPT_NONCE_SIZE == crypto_secretbox_NONCEBYTES)
+    (CRYPTO_SINGLE_CRYPT_NONCE_SIZE == crypto_secretbox_NONCEBYTES) &
+        (CRYPTO_SINGLE_CRYPT_NONCE_SIZE == crypto_core_hsalsa20_INPUTBYTES + crypto_stream_salsa20_NONCEBYTES) &
+        (CRYPTO_SINGLE_CRYPT_MAC_SIZE == crypto_onetimeauth_poly1305_BYTES) &
+        (CRYPTO_GENERIC_KEY_SIZE == crypto_core_hsalsa20_OUTPUTBYTES) &
+    (CRYPTO_CHUNKED_CODER_SIZE == crypto_aead_xchacha20poly1305_ietf_KEYBYTES) &
+        (CRYPTO_CHUNKED_CODER_SIZE >= crypto_generichash_BYTES_MIN) &
+    (CRYPTO_CHUNKED_HEADER_SIZE == crypto_aead_xchacha20poly1305_ietf_NPUBBYTES) &
+    (CRYPTO_CHUNKED_MAC_SIZE == crypto_aead_xchacha20poly1305_ietf_ABYTES)
 );
 
 static atomic bool gInitialized = false;
@@ -73,11 +81,8 @@ void cryptoMakeKeypair(CryptoGenericKey* const publicKey, CryptoGenericKey* cons
 void cryptoPublicEncrypt(CryptoPublicEncryptedBundle* const bundle, const int dataSize, const CryptoGenericKey* const publicKey) {
     assert(gInitialized && dataSize > 0);
 
-    byte data[dataSize];
-    xmemcpy(data, bundle->data, dataSize);
-
-    assert(!crypto_box_seal((byte*) bundle, data, dataSize, (byte*) publicKey));
-    sodium_memzero(data, dataSize);
+    // the seal goes right before the data, exactly where the message would've been shifted to, which is the overlap libsodium supports, so no copying is involved
+    assert(!crypto_box_seal((byte*) bundle, bundle->data, dataSize, (byte*) publicKey));
 }
 
 bool cryptoPublicDecrypt(
@@ -87,41 +92,28 @@ bool cryptoPublicDecrypt(
     const CryptoGenericKey* const secretKey
 ) {
     assert(gInitialized && dataSize > 0);
-
-    const int bundleSize = (int) sizeof *bundle + dataSize;
-
-    CryptoPublicEncryptedBundle* const bundleCopy = xalloca2(bundleSize);
-    xmemcpy((byte*) bundleCopy, (byte*) bundle, bundleSize);
-
-    return !crypto_box_seal_open(bundle->data, (byte*) bundleCopy, bundleSize, (byte*) publicKey, (byte*) secretKey);
+    return !crypto_box_seal_open(bundle->data, (byte*) bundle, sizeof *bundle + dataSize, (byte*) publicKey, (byte*) secretKey);
 }
 
 void cryptoSingleEncrypt(CryptoSingleEncryptedBundle* const bundle, const int dataSize, const CryptoGenericKey* const key) {
     assert(gInitialized && dataSize > 0);
 
-    byte data[dataSize];
-    xmemcpy(data, bundle->data, dataSize);
-
-    assert(!crypto_secretbox_detached(
+    assert(!crypto_secretbox_detached( // in place, the message and the ciphertext are allowed to be the same buffer
         bundle->data,
         bundle->mac,
-        data,
+        bundle->data,
         dataSize,
         bundle->nonce,
         (byte*) key
     ));
-    sodium_memzero(data, dataSize);
 }
 
 bool cryptoSingleDecrypt(CryptoSingleEncryptedBundle* const bundle, const int dataSize, const CryptoGenericKey* const key) {
     assert(gInitialized && dataSize > 0);
 
-    byte data[dataSize];
-    xmemcpy(data, bundle->data, dataSize);
-
-    return !crypto_secretbox_open_detached(
+    return !crypto_secretbox_open_detached( // in place, the mac is verified before anything gets decrypted, so the data is left intact on failure
+        bundle->data,
         bundle->data,
-        data,
         bundle->mac,
         dataSize,
         bundle->nonce,
@@ -129,6 +121,97 @@ bool cryptoSingleDecrypt(CryptoSingleEncryptedBundle* const bundle, const int da
     );
 }
 
+// the scattered variants follow the secretbox construction (xsalsa20poly1305) step by step: the first 32 bytes of the keystream are the poly1305 key
+// and the message is xored with the keystream that follows them, so the result is the same as if the segments were contiguous
+
+enum : int {SALSA_BLOCK_SIZE = 64, POLY_KEY_SIZE = 32, SALSA_NONCE_SIZE = 8, HSALSA_NONCE_SIZE = CRYPTO_SINGLE_CRYPT_NONCE_SIZE - SALSA_NONCE_SIZE};
+
+static void xorKeystream(byte* const data, const unsigned long size, unsigned long* const position, const byte* const nonce, const byte* const subkey) { // position - in the keystream
+    for (unsigned long done = 0; done < size;) {
+        const unsigned long block = (*position + done) / SALSA_BLOCK_SIZE, within = (*position + done) % SALSA_BLOCK_SIZE;
+
+        if (!within && size - done >= SALSA_BLOCK_SIZE) { // whole blocks directly
+            const unsigned long whole = (size - done) / SALSA_BLOCK_SIZE * SALSA_BLOCK_SIZE;
+            assert(!crypto_stream_salsa20_xor_ic(data + done, data + done, whole, nonce, block, subkey));
+            done += whole;
+            continue;
+        }
+
+        const unsigned long part = min(SALSA_BLOCK_SIZE - within, size - done); // a partial block at a segment's edge goes through the scratch block
+        byte scratch[SALSA_BLOCK_SIZE] = {};
+        xmemcpy(scratch + within, data + done, part);
+        assert(!crypto_stream_salsa20_xor_ic(scratch, scratch, SALSA_BLOCK_SIZE, nonce, block, subkey));
+        xmemcpy(data + done, scratch + within, part);
+        sodium_memzero(scratch, SALSA_BLOCK_SIZE);
+        done += part;
+    }
+    *position += size;
+}
+
+static void beginScattered(byte* const subkey, crypto_onetimeauth_poly1305_state* const state, const byte* const nonce, const CryptoGenericKey* const key) {
+    assert(!crypto_core_hsalsa20(subkey, nonce, (byte*) key, nullptr));
+
+    byte polyKey[POLY_KEY_SIZE] = {};
+    assert(!crypto_stream_salsa20_xor_ic(polyKey, polyKey, POLY_KEY_SIZE, nonce + HSALSA_NONCE_SIZE, 0, subkey));
+    assert(!crypto_onetimeauth_poly1305_init(state, polyKey));
+    sodium_memzero(polyKey, POLY_KEY_SIZE);
+}
+
+void cryptoSingleEncryptScattered(
+    byte* const mac,
+    const byte* const nonce,
+    const struct iovec* const segments,
+    const int segmentsCount,
+    const CryptoGenericKey* const key
+) {
+    assert(gInitialized && segmentsCount > 0);
+
+    byte subkey[CRYPTO_GENERIC_KEY_SIZE];
+    crypto_onetimeauth_poly1305_state state;
+    beginScattered(subkey, &state, nonce, key);
+
+    unsigned long position = POLY_KEY_SIZE;
+    for (int i = 0; i < segmentsCount; i++) {
+        xorKeystream(segments[i].iov_base, segments[i].iov_len, &position, nonce + HSALSA_NONCE_SIZE, subkey);
+        assert(!crypto_onetimeauth_poly1305_update(&state, segments[i].iov_base, segments[i].iov_len));
+    }
+    assert(position > POLY_KEY_SIZE);
+
+    assert(!crypto_onetimeauth_poly1305_final(&state, mac));
+    sodium_memzero(subkey, sizeof subkey);
+    sodium_memzero(&state, sizeof state);
+}
+
+bool cryptoSingleDecryptScattered(
+    const byte* const mac,
+    const byte* const nonce,
+    const struct iovec* const segments,
+    const int segmentsCount,
+    const CryptoGenericKey* const key
+) {
+    assert(gInitialized && segmentsCount > 0);
+
+    byte subkey[CRYPTO_GENERIC_KEY_SIZE];
+    crypto_onetimeauth_poly1305_state state;
+    beginScattered(subkey, &state, nonce, key);
+
+    for (int i = 0; i < segmentsCount; i++) // the mac is over the ciphertext, so it's verified before anything gets decrypted
+        assert(!crypto_onetimeauth_poly1305_update(&state, segments[i].iov_base, segments[i].iov_len));
+
+    byte expectedMac[CRYPTO_SINGLE_CRYPT_MAC_SIZE];
+    assert(!crypto_onetimeauth_poly1305_final(&state, expectedMac));
+    sodium_memzero(&state, sizeof state);
+
+    const bool successful = !crypto_verify_16(expectedMac, mac);
+
+    unsigned long position = POLY_KEY_SIZE;
+    for (int i = 0; successful && i < segmentsCount; i++)
+        xorKeystream(segments[i].iov_base, segments[i].iov_len, &position, nonce + HSALSA_NONCE_SIZE, subkey);
+
+    sodium_memzero(subkey, sizeof subkey);
+    return successful;
+}
+
 void cryptoStreamCreateEncoder(CryptoStreamCoder* const coder, CryptoStreamHeader* const header, const CryptoGenericKey* const key) {
     assert(gInitialized);
     assert(!crypto_secretstream_xchacha20poly1305_init_push((void*) coder, (void*) header, (void*) key));
@@ -139,56 +222,103 @@ bool cryptoStreamCreateDecoder(CryptoStreamCoder* const coder, const CryptoStrea
     return !crypto_secretstream_xchacha20poly1305_init_pull((void*) coder, (void*) header, (void*) key);
 }
 
-void cryptoStreamEncrypt(CryptoStreamCoder* const coder, CryptoStreamEncryptedChunkBundle* const bundle, const int dataSize) {
+void cryptoStreamEncrypt(CryptoStreamCoder* const coder, CryptoStreamEncryptedChunkBundle* const bundle, const byte* nullable const data, const int dataSize) {
     assert(gInitialized && dataSize > 0);
 
-    const int encryptedSize = (int) sizeof *bundle + dataSize;
-    byte encrypted[encryptedSize];
-
-    assert(!crypto_secretstream_xchacha20poly1305_push(
+    assert(!crypto_secretstream_xchacha20poly1305_push( // the tag is written before the data is read, and the data is only ever xored with the keystream, so the bundle's own data can be the message
         (void*) coder,
-        encrypted,
+        (byte*) bundle,
         nullptr,
-        bundle->data,
+        data ? data : bundle->data,
         dataSize,
         nullptr,
         0,
         crypto_secretstream_xchacha20poly1305_TAG_MESSAGE
     ));
-
-    sodium_memzero(bundle->data, dataSize);
-
-    bundle->tag = encrypted[0];
-    xmemcpy(bundle->mac, encrypted + 1, CRYPTO_STREAM_MAC_SIZE);
-    xmemcpy(bundle->data, encrypted + 1 + CRYPTO_STREAM_MAC_SIZE, dataSize);
 }
 
-bool cryptoStreamDecrypt(CryptoStreamCoder* const coder, CryptoStreamEncryptedChunkBundle* const bundle, const int dataSize) {
+bool cryptoStreamDecrypt(CryptoStreamCoder* const coder, CryptoStreamEncryptedChunkBundle* const bundle, byte* nullable const data, const int dataSize) {
     assert(gInitialized && dataSize > 0);
 
-    const int encryptedSize = (int) sizeof *bundle + dataSize;
-    byte encrypted[encryptedSize];
-
-    encrypted[0] = bundle->tag;
-    xmemcpy(encrypted + 1, bundle->mac, CRYPTO_STREAM_MAC_SIZE);
-    xmemcpy(encrypted + 1 + CRYPTO_STREAM_MAC_SIZE, bundle->data, dataSize);
-
     byte tag;
-    const bool successful = !crypto_secretstream_xchacha20poly1305_pull(
+    const bool successful = !crypto_secretstream_xchacha20poly1305_pull( // the mac is verified before anything is decrypted
         (void*) coder,
-        bundle->data,
+        data ? data : bundle->data,
         nullptr,
         &tag,
-        encrypted,
-        encryptedSize,
+        (byte*) bundle,
+        sizeof *bundle + dataSize + CRYPTO_STREAM_MAC_SIZE,
         nullptr,
         0
     );
 
-    assert(tag == crypto_secretstream_xchacha20poly1305_TAG_MESSAGE);
+    assert(!successful || tag == crypto_secretstream_xchacha20poly1305_TAG_MESSAGE);
     return successful;
 }
 
+void cryptoChunkedCreateEncoder(CryptoChunkedCoder* const coder, CryptoChunkedHeader* const header, const CryptoGenericKey* const key) {
+    assert(gInitialized);
+    randombytes_buf(header, CRYPTO_CHUNKED_HEADER_SIZE);
+    cryptoChunkedCreateDecoder(coder, header, key);
+}
+
+void cryptoChunkedCreateDecoder(CryptoChunkedCoder* const coder, const CryptoChunkedHeader* const header, const CryptoGenericKey* const key) {
+    assert(gInitialized);
+
+    // a per-file key (keyed blake2b of the random header), so the nonces, which only depend on the chunks' positions, never repeat under the same key
+    assert(!crypto_generichash((byte*) coder, CRYPTO_CHUNKED_CODER_SIZE, (const byte*) header, CRYPTO_CHUNKED_HEADER_SIZE, (const byte*) key, CRYPTO_GENERIC_KEY_SIZE));
+}
+
+static void makeChunkNonce(byte* const nonce, const unsigned long index, const bool final) { // the index (little-endian) followed by the final flag, the rest is zeroed
+    xmemset(nonce, 0, CRYPTO_CHUNKED_HEADER_SIZE);
+    xmemcpy(nonce, &index, sizeof index);
+    nonce[sizeof index] = final;
+}
+
+void cryptoChunkedEncrypt(const CryptoChunkedCoder* const coder, CryptoChunkedEncryptedBundle* const bundle, const int dataSize, const unsigned long index, const bool final) {
+    assert(gInitialized && dataSize >= 0);
+
+    byte nonce[CRYPTO_CHUNKED_HEADER_SIZE];
+    makeChunkNonce(nonce, index, final);
+
+    assert(!crypto_aead_xchacha20poly1305_ietf_encrypt_detached( // the cipher is a stream one, so the plaintext and the ciphertext may share the buffer
+        bundle->data,
+        bundle->mac,
+        nullptr,
+        bundle->data,
+        dataSize,
+        nullptr,
+        0,
+        nullptr,
+        nonce,
+        (const byte*) coder
+    ));
+}
+
+bool cryptoChunkedDecrypt(const CryptoChunkedCoder* const coder, CryptoChunkedEncryptedBundle* const bundle, const int dataSize, const unsigned long index, const bool final) {
+    assert(gInitialized && dataSize >= 0);
+
+    byte nonce[CRYPTO_CHUNKED_HEADER_SIZE];
+    makeChunkNonce(nonce, index, final);
+
+    return !crypto_aead_xchacha20poly1305_ietf_decrypt_detached( // the data gets wiped on failure
+        bundle->data,
+        nullptr,
+        bundle->data,
+        dataSize,
+        bundle->mac,
+        nullptr,
+        0,
+        nonce,
+        (const byte*) coder
+    );
+}
+
+void cryptoChunkedDestroyCoder(CryptoChunkedCoder* const coder) {
+    assert(gInitialized);
+    sodium_memzero(coder, CRYPTO_CHUNKED_CODER_SIZE);
+}
+
 void cryptoRandomBytes(byte* const buffer, const int size) {
     assert(gInitialized && size > 0);
     randombytes_buf(buffer, size);
@@ -18,6 +18,10 @@ enum : int {
     CRYPTO_STREAM_CODER_SIZE = 52,
     CRYPTO_STREAM_MAC_SIZE = 16,
 
+    CRYPTO_CHUNKED_HEADER_SIZE = 24,
+    CRYPTO_CHUNKED_CODER_SIZE = 32,
+    CRYPTO_CHUNKED_MAC_SIZE = 16,
+
     CRYPTO_PADDING_BLOCK_SIZE = 16,
 
     CRYPTO_HASH_STATE_SIZE = 384,
@@ -73,7 +77,27 @@ typedef struct packed {
 } CryptoSingleEncryptedBundle;
 
 void cryptoSingleEncrypt(CryptoSingleEncryptedBundle* const bundle, const int dataSize, const CryptoGenericKey* const key);
-bool cryptoSingleDecrypt(CryptoSingleEncryptedBundle* const bundle, const int dataSize, const CryptoGenericKey* const key);
+bool cryptoSingleDecrypt(CryptoSingleEncryptedBundle* const bundle, const int dataSize, const CryptoGenericKey* const key); // leaves the data intact on failure
+
+// the same, but for a message scattered across segments (e.g. a header and a payload where they already are in a send buffer), encrypted and decrypted
+// in place with a single mac; interchangeable with the above ones - the result equals the one of the contiguous message
+
+struct iovec;
+
+void cryptoSingleEncryptScattered(
+    byte* const mac, // CRYPTO_SINGLE_CRYPT_MAC_SIZE
+    const byte* const nonce, // CRYPTO_SINGLE_CRYPT_NONCE_SIZE
+    const struct iovec* const segments,
+    const int segmentsCount,
+    const CryptoGenericKey* const key
+);
+bool cryptoSingleDecryptScattered(
+    const byte* const mac,
+    const byte* const nonce,
+    const struct iovec* const segments,
+    const int segmentsCount,
+    const CryptoGenericKey* const key
+); // leaves the data intact on failure
 
 // stream encryption
 
@@ -82,14 +106,35 @@ typedef struct packed {byte _[CRYPTO_STREAM_HEADER_SIZE];} CryptoStreamHeader;
 
 typedef struct packed {
     byte tag;
-    byte mac[CRYPTO_STREAM_MAC_SIZE];
-    byte data[];
+    byte data[]; // followed by the mac (CRYPTO_STREAM_MAC_SIZE), the same layout libsodium produces, so the bundle is sizeof *bundle + dataSize + CRYPTO_STREAM_MAC_SIZE
 } CryptoStreamEncryptedChunkBundle;
 
 void cryptoStreamCreateEncoder(CryptoStreamCoder* const coder, CryptoStreamHeader* const header, const CryptoGenericKey* const key);
 bool cryptoStreamCreateDecoder(CryptoStreamCoder* const coder, const CryptoStreamHeader* const header, const CryptoGenericKey* const key);
-void cryptoStreamEncrypt(CryptoStreamCoder* const coder, CryptoStreamEncryptedChunkBundle* const bundle, const int dataSize);
-bool cryptoStreamDecrypt(CryptoStreamCoder* const coder, CryptoStreamEncryptedChunkBundle* const bundle, const int dataSize);
+void cryptoStreamEncrypt(CryptoStreamCoder* const coder, CryptoStreamEncryptedChunkBundle* const bundle, const byte* nullable const data, const int dataSize); // the data gets encrypted straight into the bundle, or the bundle's own data in place if null
+bool cryptoStreamDecrypt(CryptoStreamCoder* const coder, CryptoStreamEncryptedChunkBundle* const bundle, byte* nullable const data, const int dataSize); // the bundle gets decrypted straight into the data, or into its own data in place if null; nothing is written on failure
+
+// chunked (random access) encryption
+
+// each chunk is sealed on its own with a key derived from the file key and the random header, and a nonce made of the chunk's index and
+// whether it's the final one, so the chunks can be encrypted and decrypted in any order and in parallel (the coder is read-only after its creation
+// and can be shared between threads), yet a chunk moved to another position, taken from another file or a stream truncated at a chunk boundary
+// won't decrypt; all but the final chunk are expected to be of the same size so the encrypted chunk i lives at
+// header size + i * (mac size + chunk size), the final one may be empty
+
+typedef struct packed {byte _[CRYPTO_CHUNKED_CODER_SIZE];} CryptoChunkedCoder;
+typedef struct packed {byte _[CRYPTO_CHUNKED_HEADER_SIZE];} CryptoChunkedHeader;
+
+typedef struct packed {
+    byte mac[CRYPTO_CHUNKED_MAC_SIZE];
+    byte data[];
+} CryptoChunkedEncryptedBundle;
+
+void cryptoChunkedCreateEncoder(CryptoChunkedCoder* const coder, CryptoChunkedHeader* const header, const CryptoGenericKey* const key);
+void cryptoChunkedCreateDecoder(CryptoChunkedCoder* const coder, const CryptoChunkedHeader* const header, const CryptoGenericKey* const key);
+void cryptoChunkedEncrypt(const CryptoChunkedCoder* const coder, CryptoChunkedEncryptedBundle* const bundle, const int dataSize, const unsigned long index, const bool final); // in place
+bool cryptoChunkedDecrypt(const CryptoChunkedCoder* const coder, CryptoChunkedEncryptedBundle* const bundle, const int dataSize, const unsigned long index, const bool final); // in place, wipes the data on failure
+void cryptoChunkedDestroyCoder(CryptoChunkedCoder* const coder); // wipes the derived key
 
 // utils
 
@@ -6,8 +6,13 @@
 #include <sys/mman.h>
 #include <sys/syslog.h>
 #include <link.h>
+#include <dlfcn.h>
+#include <signal.h>
+#include <time.h>
 #include <pthread.h>
-#include "collections/treeMap.h"
+#include <stdatomic.h>
+#include <immintrin.h>
+#include "collections/hashtable.h"
 #include "defs.h"
 
 #undef DEFAULT_ALLOCATOR
@@ -17,13 +22,45 @@ typedef struct {
     unsigned long caller, memory, size;
 } Allocation;
 
-static TreeMap* gAllocationsTreeMap = nullptr; // <Allocation*>
-static pthread_rwlock_t gAllocationsMapRwLock = PTHREAD_RWLOCK_INITIALIZER; // not our own RwMutex (SDL_ReadWriteLock under the hood) cuz it uses the tracked allocator
-static const Allocator NON_TRACKED_ALLOCATOR = {malloc, calloc, realloc, free};
+enum : int {
+    ALLOCATIONS_SHARDS = 64, // power of two
+    CACHE_LINE_SIZE = 64,
+    CALL_SITES = 4096 // power of two, call sites beyond that are accounted together
+};
+
+typedef struct {
+    atomic unsigned long caller; // zero for unused
+    atomic long currentBytes, peakBytes, allocations, frees;
+} CallSite;
+
+typedef struct {
+    pthread_mutex_t mutex; // not our own RwMutex (SDL_ReadWriteLock under the hood) cuz it uses the tracked allocator
+    Hashtable* nullable allocations; // <Allocation*>, keyed by the exact address
+    byte padding[CACHE_LINE_SIZE - sizeof(pthread_mutex_t) - sizeof(void*)];
+} AllocationsShard; // threads allocating different addresses rarely contend on the same shard
+
+staticAssert(sizeof(AllocationsShard) == CACHE_LINE_SIZE);
+
+static AllocationsShard gAllocationsShards[ALLOCATIONS_SHARDS] = {};
+static thread_local unsigned gAllocationsSamplingCounter = 0;
+static CallSite gCallSites[CALL_SITES] = {}, gOtherCallSites = {}; // open addressing, slots are claimed once and never released
+static long gProfilingStartNanos = 0;
+static atomic bool gHeapProfileRequested = false;
+static const Allocator NON_TRACKED_ALLOCATOR = {
+    ^ void* (const unsigned long size) { return malloc(size); },
+    ^ void* (const unsigned long elements, const unsigned long size) { return calloc(elements, size); },
+    ^ void* (void* nullable const pointer, const unsigned long size) { return realloc(pointer, size); },
+    ^ (void* nullable const memory) { free(memory); }
+};
 #endif // DEBUG
 
 static atomic unsigned long gAllocations = 0;
-const Allocator DEFAULT_ALLOCATOR = {xmalloc, xcalloc, xrealloc, xfree};
+const Allocator DEFAULT_ALLOCATOR = {
+    ^ void* (const unsigned long size) { return xmalloc(size); },
+    ^ void* (const unsigned long elements, const unsigned long size) { return xcalloc(elements, size); },
+    ^ void* (void* nullable const pointer, const unsigned long size) { return xrealloc(pointer, size); },
+    ^ (void* nullable const memory) { xfree(memory); }
+};
 
 #ifdef __clang__
 [[maybe_unused]] void _deferHandler(void (^ const* const block)(void)) {
@@ -58,12 +95,31 @@ export void assert(const bool condition) {
 }
 
 #ifdef DEBUG
+static long nanoTime(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1'000'000'000l + time.tv_nsec;
+}
+
+static void heapProfileSignalHandler(const int) {
+    gHeapProfileRequested = true;
+}
+
 [[gnu::constructor(1)]] used static void init(void) {
-    gAllocationsTreeMap = treeMapCreate(&NON_TRACKED_ALLOCATOR, false, free);
+    for (int i = 0; i < ALLOCATIONS_SHARDS; i++) {
+        assert(!pthread_mutex_init(&gAllocationsShards[i].mutex, nullptr));
+        gAllocationsShards[i].allocations = hashtableCreate(&NON_TRACKED_ALLOCATOR, free);
+    }
+
+    gProfilingStartNanos = nanoTime();
+    signal(SIGUSR1, heapProfileSignalHandler);
 }
 
 [[gnu::destructor(1)]] used static void quit(void) {
-    treeMapDestroy(gAllocationsTreeMap);
+    for (int i = 0; i < ALLOCATIONS_SHARDS; i++) {
+        hashtableDestroy(gAllocationsShards[i].allocations);
+        pthread_mutex_destroy(&gAllocationsShards[i].mutex);
+    }
 }
 
 static int dlIteratePhdrCallback(struct dl_phdr_info* const info, const size_t, void* const data) {
@@ -78,58 +134,166 @@ void checkUnfreedAllocations(void) {
     unsigned long executableStartAddress = 0;
     dl_iterate_phdr(dlIteratePhdrCallback, &executableStartAddress);
 
-    const char message[] = "Unfreed allocations found: %lu\n";
-    fprintf(stderr, message, gAllocations);
-    syslog(LOG_ERR, message, gAllocations);
-
-    pthread_rwlock_rdlock(&gAllocationsMapRwLock);
-    TreeMapIterator* iterator;
-    treeMapIterateBegin(gAllocationsTreeMap, iterator);
+    const char message[] = "Unfreed allocations found: %lu (1 in %d is tracked)\n";
+    fprintf(stderr, message, gAllocations, DEBUG_ALLOCATIONS_SAMPLING);
+    syslog(LOG_ERR, message, gAllocations, DEBUG_ALLOCATIONS_SAMPLING);
 
 //    used extern const byte __executable_start; // void* ... = &__executable_start; // linker trick, works on PIE too
 
     const byte bufSize = 0xff;
     char buf[bufSize];
 
-    Allocation* allocation;
-    while ((allocation = treeMapIterate(iterator))) {
-        snprintf(
-            buf, bufSize,
-            "\tunfreed allocation caller=0x%lx (<elf>+0x%lx) memory=0x%lx size=%lu\n",
-            allocation->caller,
-            (byte) (allocation->caller >> 44ul) == 5 ? allocation->caller - executableStartAddress : -1ul, // if true - it's inside this executable, otherwise it's inside one of its shared libraries
-            allocation->memory, allocation->size
-        );
-
-        fputs(buf, stderr);
-        syslog(LOG_ERR, "%s", buf);
-    }
+    for (int i = 0; i < ALLOCATIONS_SHARDS; i++) {
+        AllocationsShard* const shard = gAllocationsShards + i;
+        pthread_mutex_lock(&shard->mutex);
+
+        HashtableIterator* iterator;
+        hashtableIterateBegin(shard->allocations, iterator);
+
+        Allocation* allocation;
+        while ((allocation = hashtableIterate(iterator))) {
+            snprintf(
+                buf, bufSize,
+                "\tunfreed allocation caller=0x%lx (<elf>+0x%lx) memory=0x%lx size=%lu\n",
+                allocation->caller,
+                (byte) (allocation->caller >> 44ul) == 5 ? allocation->caller - executableStartAddress : -1ul, // if true - it's inside this executable, otherwise it's inside one of its shared libraries
+                allocation->memory, allocation->size
+            );
+
+            fputs(buf, stderr);
+            syslog(LOG_ERR, "%s", buf);
+        }
 
-    treeMapIterateEnd(iterator);
-    pthread_rwlock_unlock(&gAllocationsMapRwLock);
+        hashtableIterateEnd(iterator);
+        pthread_mutex_unlock(&shard->mutex);
+    }
 
     abort();
 }
 
-static void addAllocation(const unsigned long caller, const unsigned long memory, const unsigned long size) {
+wrapping static AllocationsShard* allocationsShard(const unsigned long memory) {
+    return gAllocationsShards + ((memory >> 4) * 0x9e37'79b9'7f4a'7c15ul >> 58); // fibonacci hashing, the lowest bits are always zero due to the alignment; 58 = 64 - log2(ALLOCATIONS_SHARDS)
+}
+
+wrapping static CallSite* callSite(const unsigned long caller) {
+    unsigned long index = caller * 0x9e37'79b9'7f4a'7c15ul >> 52; // 52 = 64 - log2(CALL_SITES)
+
+    for (int probes = 0; probes < CALL_SITES; probes++, index = (index + 1) & (CALL_SITES - 1)) {
+        CallSite* const site = gCallSites + index;
+
+        unsigned long expected = atomic_load_explicit(&site->caller, memory_order_relaxed);
+        if (expected == caller) return site;
+        if (!expected && (atomic_compare_exchange_strong(&site->caller, &expected, caller) || expected == caller)) return site;
+    }
+
+    return &gOtherCallSites;
+}
+
+static void accountBytes(CallSite* const site, const long bytes) {
+    const long current = atomic_fetch_add_explicit(&site->currentBytes, bytes, memory_order_relaxed) + bytes;
+
+    long peak = atomic_load_explicit(&site->peakBytes, memory_order_relaxed);
+    while (current > peak && !atomic_compare_exchange_weak_explicit(&site->peakBytes, &peak, current, memory_order_relaxed, memory_order_relaxed));
+}
+
+static void describeCallSite(const unsigned long caller, char* const buffer, const int size) { // no spaces and semicolons so it's a valid frame for the folded format
+    Dl_info info;
+    if (!caller)
+        snprintf(buffer, size, "[other]");
+    else if (!dladdr((void*) caller, &info) || !info.dli_fname)
+        snprintf(buffer, size, "0x%lx", caller);
+    else if (info.dli_sname) // only exported symbols are visible to dladdr
+        snprintf(buffer, size, "%s+0x%lx", info.dli_sname, caller - (unsigned long) info.dli_saddr);
+    else {
+        const char* const slash = __builtin_strrchr(info.dli_fname, '/');
+        snprintf(buffer, size, "%s+0x%lx", slash ? slash + 1 : info.dli_fname, caller - (unsigned long) info.dli_fbase); // resolvable with addr2line
+    }
+}
+
+void dumpHeapProfile(const int fileDescriptor, const bool foldedOrTable) {
+    const double seconds = (double) (nanoTime() - gProfilingStartNanos) / 1e9;
+    const long scale = DEBUG_ALLOCATIONS_SAMPLING;
+    char site[0xff];
+
+    if (!foldedOrTable)
+        dprintf(fileDescriptor, "%-48s %14s %14s %12s %12s %12s\n", "site", "current", "peak", "allocations", "frees", "churn/s");
+
+    for (int i = 0; i <= CALL_SITES; i++) {
+        CallSite* const entry = i < CALL_SITES ? gCallSites + i : &gOtherCallSites;
+        const long allocations = entry->allocations;
+        if (!allocations) continue;
+
+        const long current = entry->currentBytes * scale, frees = entry->frees;
+        describeCallSite(i < CALL_SITES ? entry->caller : 0, site, sizeof site);
+
+        if (foldedOrTable) {
+            if (current > 0) dprintf(fileDescriptor, "%s %ld\n", site, current);
+        } else
+            dprintf(
+                fileDescriptor, "%-48s %14ld %14ld %12ld %12ld %12.1f\n",
+                site, current, entry->peakBytes * scale, allocations * scale, frees * scale,
+                seconds > 0 ? (double) ((allocations + frees) * scale) / seconds : 0.0
+            );
+    }
+}
+
+void dumpHeapProfileIfRequested(void) {
+    bool expected = true;
+    if (atomic_compare_exchange_strong(&gHeapProfileRequested, &expected, false))
+        dumpHeapProfile(STDERR_FILENO, false);
+}
+
+static void insertAllocation(Allocation* const allocation) {
+    AllocationsShard* const shard = allocationsShard(allocation->memory);
+    pthread_mutex_lock(&shard->mutex);
+    hashtablePut(shard->allocations, allocation->memory, allocation);
+    pthread_mutex_unlock(&shard->mutex);
+}
+
+static Allocation* nullable extractAllocation(const unsigned long memory) {
+    AllocationsShard* const shard = allocationsShard(memory);
+    pthread_mutex_lock(&shard->mutex);
+    Allocation* const allocation = hashtableRemove(shard->allocations, memory, false);
+    pthread_mutex_unlock(&shard->mutex);
+    return allocation; // null if it hasn't been sampled
+}
+
+wrapping static void addAllocation(const unsigned long caller, const unsigned long memory, const unsigned long size) {
+    if (gAllocationsSamplingCounter++ % DEBUG_ALLOCATIONS_SAMPLING) return;
+
     Allocation* const allocation = malloc(sizeof *allocation);
     assert(allocation);
     allocation->caller = caller;
     allocation->memory = memory;
     allocation->size = size;
+    insertAllocation(allocation);
 
-    pthread_rwlock_wrlock(&gAllocationsMapRwLock);
-    treeMapInsert(gAllocationsTreeMap, hashPrimitive(memory), allocation);
-    pthread_rwlock_unlock(&gAllocationsMapRwLock);
+    CallSite* const site = callSite(caller);
+    site->allocations++;
+    accountBytes(site, (long) size);
 }
 #define addAllocation(x, y) addAllocation((unsigned long) returnAddr, (unsigned long) x, y)
 
-static void removeAllocation(const unsigned long memory) {
-    pthread_rwlock_wrlock(&gAllocationsMapRwLock);
-    treeMapDelete(gAllocationsTreeMap, hashPrimitive(memory));
-    pthread_rwlock_unlock(&gAllocationsMapRwLock);
+// the allocations get extracted before their memory is handed back to libc, otherwise another thread could be given the same address in between and find it still tracked
+
+static void moveAllocation(Allocation* nullable const allocation, const unsigned long newMemory, const unsigned long newSize) { // the sampling decision made for the original allocation is kept
+    if (!allocation) return;
+
+    accountBytes(callSite(allocation->caller), (long) newSize - (long) allocation->size);
+    allocation->memory = newMemory;
+    allocation->size = newSize;
+    insertAllocation(allocation);
+}
+#define moveAllocation(x, y, z) moveAllocation(x, (unsigned long) y, z)
+
+static void removeAllocation(Allocation* nullable const allocation) {
+    if (!allocation) return;
+
+    CallSite* const site = callSite(allocation->caller);
+    site->frees++;
+    accountBytes(site, -(long) allocation->size);
+    free(allocation);
 }
-#define removeAllocation(x) removeAllocation((unsigned long) x)
 #else // DEBUG
 void checkUnfreedAllocations(void) {
     assert(!gAllocations);
@@ -152,6 +316,9 @@ void* xcalloc(const unsigned long elements, const unsigned long size) {
 }
 
 void* nullable xrealloc(void* nullable const pointer, const unsigned long size) {
+#ifdef DEBUG
+    Allocation* nullable const allocation = pointer ? extractAllocation((unsigned long) pointer) : nullptr;
+#endif
     void* const memory = realloc(pointer, size);
 
     if (!pointer) { // !pointer && size
@@ -162,18 +329,20 @@ void* nullable xrealloc(void* nullable const pointer, const unsigned long size)
         addAllocation(memory, size);
 #endif
     } else if (size) { // pointer && size
+#ifdef DEBUG
+        if (!memory && allocation) insertAllocation(allocation); // the original memory is left intact on failure
+#endif
         assert(memory);
 
 #ifdef DEBUG
-        removeAllocation(pointer);
-        addAllocation(memory, size);
+        moveAllocation(allocation, memory, size);
 #endif
     } else { // pointer && !size
         assert(!memory);
         gAllocations--;
 
 #ifdef DEBUG
-        removeAllocation(pointer);
+        removeAllocation(allocation);
 #endif
     }
 
@@ -181,13 +350,14 @@ void* nullable xrealloc(void* nullable const pointer, const unsigned long size)
 }
 
 void xfree(void* nullable const memory) {
-    free(memory);
     if (!memory) return;
-    gAllocations--;
 
 #ifdef DEBUG
-    removeAllocation(memory);
+    removeAllocation(extractAllocation((unsigned long) memory));
 #endif
+
+    free(memory);
+    gAllocations--;
 }
 
 int xrand(const int min, const int max) {
@@ -279,3 +449,331 @@ int hashValue(const void* const value, const int size) {
     return out;
 #endif
 }
+
+// XXH3 (64-bit variant), produces the same hashes as the reference implementation;
+// inputs up to 240 bytes are mixed directly with the secret, longer ones get accumulated in 64 byte stripes by 8 lanes, scrambling them after each 1 KiB block
+
+enum : int {
+    HASH_STRIPE_SIZE = 64,
+    HASH_SECRET_SIZE = 192,
+    HASH_SECRET_CONSUME_RATE = 8, // secret bytes consumed per stripe
+    HASH_STRIPES_PER_BLOCK = (HASH_SECRET_SIZE - HASH_STRIPE_SIZE) / HASH_SECRET_CONSUME_RATE,
+    HASH_BUFFER_SIZE = 256,
+    HASH_MIDSIZE_MAX = 240
+};
+
+static const unsigned long
+    HASH_PRIME32_1 = 0x9e37'79b1ul, HASH_PRIME32_2 = 0x85eb'ca77ul, HASH_PRIME32_3 = 0xc2b2'ae3dul,
+    HASH_PRIME64_1 = 0x9e37'79b1'85eb'ca87ul, HASH_PRIME64_2 = 0xc2b2'ae3d'27d4'eb4ful, HASH_PRIME64_3 = 0x1656'67b1'9e37'79f9ul,
+    HASH_PRIME64_4 = 0x85eb'ca77'c2b2'ae63ul, HASH_PRIME64_5 = 0x27d4'eb2f'1656'67c5ul,
+    HASH_PRIME_MX1 = 0x1656'6791'9e37'79f9ul, HASH_PRIME_MX2 = 0x9fb2'1c65'1e98'df25ul;
+
+static const byte HASH_DEFAULT_SECRET[HASH_SECRET_SIZE] = { // pseudorandom, taken from the reference implementation
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e
+};
+
+staticAssert(sizeof(((HashState*) nullptr)->secret) == HASH_SECRET_SIZE && sizeof(((HashState*) nullptr)->buffer) == HASH_BUFFER_SIZE);
+
+typedef void (* HashAccumulate)(unsigned long* const accumulators, const byte* const input, const byte* const secret, const int stripes);
+typedef void (* HashScramble)(unsigned long* const accumulators, const byte* const secret);
+
+xinline unsigned long readLong(const byte* const bytes) {
+    unsigned long value;
+    xmemcpy(&value, bytes, sizeof value);
+    return value;
+}
+
+xinline unsigned readInt(const byte* const bytes) {
+    unsigned value;
+    xmemcpy(&value, bytes, sizeof value);
+    return value;
+}
+
+xinline unsigned long rotateLeft(const unsigned long value, const int bits) {
+    return value << bits | value >> (64 - bits);
+}
+
+wrapping xinline unsigned long multiplyFold(const unsigned long a, const unsigned long b) { // 64x64 -> 128 bit multiplication, halves of the product are xored together
+    const unsigned __int128 product = (unsigned __int128) a * b;
+    return (unsigned long) product ^ (unsigned long) (product >> 64);
+}
+
+wrapping static unsigned long avalanche(unsigned long hash) {
+    hash ^= hash >> 37;
+    hash *= HASH_PRIME_MX1;
+    return hash ^ hash >> 32;
+}
+
+wrapping static unsigned long avalancheXXH64(unsigned long hash) {
+    hash ^= hash >> 33;
+    hash *= HASH_PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= HASH_PRIME64_3;
+    return hash ^ hash >> 32;
+}
+
+wrapping static unsigned long rrmxmx(unsigned long hash, const unsigned long size) {
+    hash ^= rotateLeft(hash, 49) ^ rotateLeft(hash, 24);
+    hash *= HASH_PRIME_MX2;
+    hash ^= (hash >> 35) + size;
+    hash *= HASH_PRIME_MX2;
+    return hash ^ hash >> 28;
+}
+
+wrapping xinline unsigned long mix16(const byte* const input, const byte* const secret, const unsigned long seed) {
+    return multiplyFold(readLong(input) ^ (readLong(secret) + seed), readLong(input + 8) ^ (readLong(secret + 8) - seed));
+}
+
+wrapping static unsigned long hashShort(const byte* const input, const unsigned long size, unsigned long seed) { // size <= HASH_MIDSIZE_MAX, always uses the default secret
+    const byte* const secret = HASH_DEFAULT_SECRET;
+
+    if (size > 128) {
+        unsigned long accumulator = size * HASH_PRIME64_1;
+        for (int i = 0; i < 8; i++) accumulator += mix16(input + 16 * i, secret + 16 * i, seed);
+
+        unsigned long accumulatorEnd = mix16(input + size - 16, secret + 136 - 17, seed);
+        accumulator = avalanche(accumulator);
+
+        for (int i = 8; i < (int) size / 16; i++) accumulatorEnd += mix16(input + 16 * i, secret + 16 * (i - 8) + 3, seed);
+        return avalanche(accumulator + accumulatorEnd);
+    }
+
+    if (size > 16) {
+        unsigned long accumulator = size * HASH_PRIME64_1;
+        for (int i = (int) (size - 1) / 32; i >= 0; i--) {
+            accumulator += mix16(input + 16 * i, secret + 32 * i, seed);
+            accumulator += mix16(input + size - 16 * (i + 1), secret + 32 * i + 16, seed);
+        }
+        return avalanche(accumulator);
+    }
+
+    if (size > 8) {
+        const unsigned long
+            low = readLong(input) ^ ((readLong(secret + 24) ^ readLong(secret + 32)) + seed),
+            high = readLong(input + size - 8) ^ ((readLong(secret + 40) ^ readLong(secret + 48)) - seed);
+        return avalanche(size + __builtin_bswap64(low) + high + multiplyFold(low, high));
+    }
+
+    if (size >= 4) {
+        seed ^= (unsigned long) __builtin_bswap32((unsigned) seed) << 32;
+        const unsigned long combined = readInt(input + size - 4) + ((unsigned long) readInt(input) << 32);
+        return rrmxmx(combined ^ ((readLong(secret + 8) ^ readLong(secret + 16)) - seed), size);
+    }
+
+    if (size) {
+        const unsigned combined = (unsigned) input[0] << 16 | (unsigned) input[size >> 1] << 24 | input[size - 1] | (unsigned) size << 8;
+        return avalancheXXH64(combined ^ ((unsigned long) (readInt(secret) ^ readInt(secret + 4)) + seed));
+    }
+
+    return avalancheXXH64(seed ^ readLong(secret + 56) ^ readLong(secret + 64));
+}
+
+// per lane: accumulator[lane ^ 1] += data, accumulator[lane] += low32(data ^ secret) * high32(data ^ secret)
+
+static void accumulateSSE2(unsigned long* const accumulators, const byte* const input, const byte* const secret, const int stripes) {
+    __m128i vectors[4];
+    for (int i = 0; i < 4; i++) vectors[i] = _mm_loadu_si128((const __m128i*) accumulators + i);
+
+    for (int stripe = 0; stripe < stripes; stripe++) {
+        const __m128i* const data = (const __m128i*) (input + stripe * HASH_STRIPE_SIZE), * const key = (const __m128i*) (secret + stripe * HASH_SECRET_CONSUME_RATE);
+        for (int i = 0; i < 4; i++) {
+            const __m128i value = _mm_loadu_si128(data + i), keyed = _mm_xor_si128(value, _mm_loadu_si128(key + i));
+            const __m128i product = _mm_mul_epu32(keyed, _mm_shuffle_epi32(keyed, _MM_SHUFFLE(0, 3, 0, 1)));
+            vectors[i] = _mm_add_epi64(vectors[i], _mm_add_epi64(product, _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2))));
+        }
+    }
+
+    for (int i = 0; i < 4; i++) _mm_storeu_si128((__m128i*) accumulators + i, vectors[i]);
+}
+
+static void scrambleSSE2(unsigned long* const accumulators, const byte* const secret) { // accumulator = (accumulator ^ accumulator >> 47 ^ secret) * HASH_PRIME32_1
+    const __m128i prime = _mm_set1_epi32((int) HASH_PRIME32_1);
+
+    for (int i = 0; i < 4; i++) {
+        const __m128i value = _mm_loadu_si128((const __m128i*) accumulators + i);
+        const __m128i keyed = _mm_xor_si128(_mm_xor_si128(value, _mm_srli_epi64(value, 47)), _mm_loadu_si128((const __m128i*) secret + i));
+        const __m128i high = _mm_mul_epu32(_mm_shuffle_epi32(keyed, _MM_SHUFFLE(0, 3, 0, 1)), prime);
+        _mm_storeu_si128((__m128i*) accumulators + i, _mm_add_epi64(_mm_mul_epu32(keyed, prime), _mm_slli_epi64(high, 32)));
+    }
+}
+
+[[gnu::target("avx2")]] static void accumulateAVX2(unsigned long* const accumulators, const byte* const input, const byte* const secret, const int stripes) {
+    __m256i vectors[2];
+    for (int i = 0; i < 2; i++) vectors[i] = _mm256_loadu_si256((const __m256i*) accumulators + i);
+
+    for (int stripe = 0; stripe < stripes; stripe++) {
+        const __m256i* const data = (const __m256i*) (input + stripe * HASH_STRIPE_SIZE), * const key = (const __m256i*) (secret + stripe * HASH_SECRET_CONSUME_RATE);
+        for (int i = 0; i < 2; i++) {
+            const __m256i value = _mm256_loadu_si256(data + i), keyed = _mm256_xor_si256(value, _mm256_loadu_si256(key + i));
+            const __m256i product = _mm256_mul_epu32(keyed, _mm256_srli_epi64(keyed, 32));
+            vectors[i] = _mm256_add_epi64(vectors[i], _mm256_add_epi64(product, _mm256_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2))));
+        }
+    }
+
+    for (int i = 0; i < 2; i++) _mm256_storeu_si256((__m256i*) accumulators + i, vectors[i]);
+}
+
+[[gnu::target("avx2")]] static void scrambleAVX2(unsigned long* const accumulators, const byte* const secret) {
+    const __m256i prime = _mm256_set1_epi32((int) HASH_PRIME32_1);
+
+    for (int i = 0; i < 2; i++) {
+        const __m256i value = _mm256_loadu_si256((const __m256i*) accumulators + i);
+        const __m256i keyed = _mm256_xor_si256(_mm256_xor_si256(value, _mm256_srli_epi64(value, 47)), _mm256_loadu_si256((const __m256i*) secret + i));
+        const __m256i high = _mm256_mul_epu32(_mm256_srli_epi64(keyed, 32), prime);
+        _mm256_storeu_si256((__m256i*) accumulators + i, _mm256_add_epi64(_mm256_mul_epu32(keyed, prime), _mm256_slli_epi64(high, 32)));
+    }
+}
+
+static void hashRoutines(HashAccumulate* const accumulate, HashScramble* const scramble) {
+    const bool avx2 = __builtin_cpu_supports("avx2");
+    *accumulate = avx2 ? accumulateAVX2 : accumulateSSE2;
+    *scramble = avx2 ? scrambleAVX2 : scrambleSSE2;
+}
+
+static void initAccumulators(unsigned long* const accumulators) {
+    const unsigned long initial[8] = {HASH_PRIME32_3, HASH_PRIME64_1, HASH_PRIME64_2, HASH_PRIME64_3, HASH_PRIME64_4, HASH_PRIME32_2, HASH_PRIME64_5, HASH_PRIME32_1};
+    xmemcpy(accumulators, initial, sizeof initial);
+}
+
+wrapping static void deriveSecret(byte* const secret, const unsigned long seed) {
+    for (int i = 0; i < HASH_SECRET_SIZE; i += 16) {
+        const unsigned long low = readLong(HASH_DEFAULT_SECRET + i) + seed, high = readLong(HASH_DEFAULT_SECRET + i + 8) - seed;
+        xmemcpy(secret + i, &low, 8);
+        xmemcpy(secret + i + 8, &high, 8);
+    }
+}
+
+wrapping static unsigned long mergeAccumulators(const unsigned long* const accumulators, const byte* const secret, const unsigned long totalSize) {
+    unsigned long result = totalSize * HASH_PRIME64_1;
+    for (int i = 0; i < 4; i++)
+        result += multiplyFold(accumulators[2 * i] ^ readLong(secret + 11 + 16 * i), accumulators[2 * i + 1] ^ readLong(secret + 11 + 16 * i + 8));
+    return avalanche(result);
+}
+
+static unsigned long hashLong(const byte* const input, const unsigned long size, const byte* const secret) { // size > HASH_MIDSIZE_MAX
+    HashAccumulate accumulate;
+    HashScramble scramble;
+    hashRoutines(&accumulate, &scramble);
+
+    unsigned long accumulators[8];
+    initAccumulators(accumulators);
+
+    const unsigned long blockSize = HASH_STRIPE_SIZE * HASH_STRIPES_PER_BLOCK, blocks = (size - 1) / blockSize;
+    for (unsigned long block = 0; block < blocks; block++) {
+        accumulate(accumulators, input + block * blockSize, secret, HASH_STRIPES_PER_BLOCK);
+        scramble(accumulators, secret + HASH_SECRET_SIZE - HASH_STRIPE_SIZE);
+    }
+
+    accumulate(accumulators, input + blocks * blockSize, secret, (int) ((size - 1 - blocks * blockSize) / HASH_STRIPE_SIZE));
+    accumulate(accumulators, input + size - HASH_STRIPE_SIZE, secret + HASH_SECRET_SIZE - HASH_STRIPE_SIZE - 7, 1); // the last stripe, possibly overlapping with the previous one
+
+    return mergeAccumulators(accumulators, secret, size);
+}
+
+unsigned long hashValueLongSeeded(const void* const value, const unsigned long size, const unsigned long seed) {
+    if (size <= HASH_MIDSIZE_MAX) return hashShort(value, size, seed);
+    if (!seed) return hashLong(value, size, HASH_DEFAULT_SECRET);
+
+    byte secret[HASH_SECRET_SIZE];
+    deriveSecret(secret, seed);
+    return hashLong(value, size, secret);
+}
+
+unsigned long hashValueLong(const void* const value, const unsigned long size) {
+    return hashValueLongSeeded(value, size, 0);
+}
+
+void hashStateInit(HashState* const state, const unsigned long seed) {
+    initAccumulators(state->accumulators);
+    state->seed = seed;
+    state->totalSize = 0;
+    deriveSecret(state->secret, seed);
+    state->bufferedSize = 0;
+    state->stripesSoFar = 0;
+}
+
+static void consumeStripes(HashState* const state, unsigned long* const accumulators, const byte* input, int stripes) { // scrambles at the block boundaries the same way the one-shot variant does
+    HashAccumulate accumulate;
+    HashScramble scramble;
+    hashRoutines(&accumulate, &scramble);
+
+    int* const stripesSoFar = &state->stripesSoFar;
+    while (stripes) {
+        const int count = min(stripes, HASH_STRIPES_PER_BLOCK - *stripesSoFar);
+        accumulate(accumulators, input, state->secret + *stripesSoFar * HASH_SECRET_CONSUME_RATE, count);
+
+        input += count * HASH_STRIPE_SIZE;
+        stripes -= count;
+        *stripesSoFar += count;
+
+        if (*stripesSoFar == HASH_STRIPES_PER_BLOCK) {
+            scramble(accumulators, state->secret + HASH_SECRET_SIZE - HASH_STRIPE_SIZE);
+            *stripesSoFar = 0;
+        }
+    }
+}
+
+void hashStateUpdate(HashState* const state, const void* const data, const unsigned long size) {
+    const byte* input = data, * const end = input + size;
+    state->totalSize += size;
+
+    if (size <= (unsigned long) (HASH_BUFFER_SIZE - state->bufferedSize)) { // the buffer is only consumed once there's more data after it, so the last stripe is always left for the digest
+        xmemcpy(state->buffer + state->bufferedSize, input, size);
+        state->bufferedSize += (int) size;
+        return;
+    }
+
+    if (state->bufferedSize) {
+        const int loadSize = HASH_BUFFER_SIZE - state->bufferedSize;
+        xmemcpy(state->buffer + state->bufferedSize, input, loadSize);
+        input += loadSize;
+        consumeStripes(state, state->accumulators, state->buffer, HASH_BUFFER_SIZE / HASH_STRIPE_SIZE);
+        state->bufferedSize = 0;
+    }
+
+    if (end - input > HASH_BUFFER_SIZE) { // consumes directly from the input, leaving at least one byte
+        const int stripes = (int) ((end - 1 - input) / HASH_STRIPE_SIZE);
+        consumeStripes(state, state->accumulators, input, stripes);
+        input += stripes * HASH_STRIPE_SIZE;
+        xmemcpy(state->buffer + HASH_BUFFER_SIZE - HASH_STRIPE_SIZE, input - HASH_STRIPE_SIZE, HASH_STRIPE_SIZE); // the last consumed stripe, the digest may need a part of it
+    }
+
+    xmemcpy(state->buffer, input, end - input);
+    state->bufferedSize = (int) (end - input);
+}
+
+unsigned long hashStateDigest(const HashState* const state) {
+    if (state->totalSize <= HASH_MIDSIZE_MAX) return hashShort(state->buffer, state->totalSize, state->seed);
+
+    HashState copy = *state; // digesting doesn't modify the state so it can be updated further
+    byte lastStripe[HASH_STRIPE_SIZE];
+    const byte* lastStripePointer;
+
+    if (copy.bufferedSize >= HASH_STRIPE_SIZE) {
+        consumeStripes(&copy, copy.accumulators, copy.buffer, (copy.bufferedSize - 1) / HASH_STRIPE_SIZE);
+        lastStripePointer = copy.buffer + copy.bufferedSize - HASH_STRIPE_SIZE;
+    } else { // stitched from the tail of the previously consumed data and the buffered bytes
+        const int catchUpSize = HASH_STRIPE_SIZE - copy.bufferedSize;
+        xmemcpy(lastStripe, copy.buffer + HASH_BUFFER_SIZE - catchUpSize, catchUpSize);
+        xmemcpy(lastStripe + catchUpSize, copy.buffer, copy.bufferedSize);
+        lastStripePointer = lastStripe;
+    }
+
+    HashAccumulate accumulate;
+    HashScramble scramble;
+    hashRoutines(&accumulate, &scramble);
+    accumulate(copy.accumulators, lastStripePointer, copy.secret + HASH_SECRET_SIZE - HASH_STRIPE_SIZE - 7, 1);
+
+    return mergeAccumulators(copy.accumulators, copy.secret, copy.totalSize);
+}
@@ -2,8 +2,10 @@
 #pragma once
 
 #define DEBUG
+#define DEBUG_ALLOCATIONS_SAMPLING 1 // track 1 in N allocations (their callers and sizes) to keep leak checking affordable under load, the amount of unfreed ones is always exact
 //#define TESTING
 #define USE_CRYPTOGRAPHIC_HASH_FOR_GENERIC_HASH_VALUE false
+#define COLLECTIONS_OPTIMISTIC_READS true // synchronized collections answer size, count and peek queries through a seqlock instead of read locking, so frequent readers on different cores don't contend on the lock's cache line; writers pay a couple of extra stores
 
 #if __STDC_VERSION__ < 202400L /*C2Y*/ || !defined(__clang__) /*extensions*/ || !defined(__GNUC__) /*glibc*/ || \
     !defined(__linux__) /*api*/ || !defined(_GNU_SOURCE) /*api*/ || !defined(__x86_64__) || !__LITTLE_ENDIAN__ || \
@@ -49,6 +51,7 @@ typedef unsigned char byte;
 #define export [[gnu::visibility("default")]]
 #define noinline [[clang::noinline]]
 #define xinline [[clang::always_inline]] inline
+#define wrapping [[clang::no_sanitize("unsigned-integer-overflow")]] // allows unsigned integer overflow (wrap around) in the marked function as it's trapped otherwise
 
 #if defined(__CLION_IDE__)
 #define used __attribute__((unused))
@@ -96,16 +99,23 @@ inline unsigned long swapLong(const long value) { return __builtin_bswap64(value
 #endif
 
 void checkUnfreedAllocations(void); // should only be called once and at the end of main()
+#ifdef DEBUG
+void dumpHeapProfile(const int fileDescriptor, const bool foldedOrTable); // live heap profile of the tracked allocations aggregated per call site (scaled by the sampling rate); folded - 'site bytes' lines of currently held bytes for flamegraph tools, table - current and peak bytes, allocations, frees and churn per second
+void dumpHeapProfileIfRequested(void); // dumps the table to stderr if SIGUSR1 has been received since the last call, meant to be polled from a loop as the dump isn't async-signal-safe
+#endif
 void* xmalloc(const unsigned long size);
 void* xcalloc(const unsigned long elements, const unsigned long size);
 void* nullable xrealloc(void* nullable const pointer, const unsigned long size); // returns null only when size is zero, thus acting as xfree
 void xfree(void* nullable const memory);
 
+// blocks rather than function pointers so an allocator can carry its own state (see the pool allocator), invoked the same way;
+// an allocator needn't serve every size - the pool one serves only requests that fit its fixed object size and asserts on the rest,
+// so whoever hands such an allocator to a container must make sure it covers everything the container allocates, the container itself included
 typedef struct {
-    void* (* malloc)(const unsigned long size);
-    void* (* calloc)(const unsigned long elements, const unsigned long size);
-    void* (* realloc)(void* nullable const pointer, const unsigned long size);
-    void (* free)(void* nullable const);
+    void* (^ malloc)(const unsigned long size);
+    void* (^ calloc)(const unsigned long elements, const unsigned long size);
+    void* (^ realloc)(void* nullable const pointer, const unsigned long size);
+    void (^ free)(void* nullable const);
 } Allocator;
 
 extern const Allocator DEFAULT_ALLOCATOR;
@@ -170,6 +180,19 @@ void patchFunction(void* const original, void* const replacement); // overrides
 
 int hashValue(const void* const value, const int size); // fast non-cryptographic collision-resistant general purpose hash function (xxhash)
 #define hashPrimitive(x) hashValue(&(typeof(x)) {x}, sizeof x) // _Generic((x), byte: 1, char: 1, unsigned short: 2, short: 2, unsigned int: 4, int: 4, unsigned long: 8, long: 8)
+unsigned long hashValueLong(const void* const value, const unsigned long size); // 64-bit xxh3 - keeps the full entropy for 64-bit keys, vectorized (avx2 if the cpu supports it, sse2 otherwise) so large buffers are hashed at about memory bandwidth
+unsigned long hashValueLongSeeded(const void* const value, const unsigned long size, const unsigned long seed);
+#define hashPrimitiveLong(x) hashValueLong(&(typeof(x)) {x}, sizeof x)
+
+typedef struct {
+    unsigned long accumulators[8], seed, totalSize;
+    byte secret[192], buffer[256];
+    int bufferedSize, stripesSoFar;
+} HashState; // for hashing data that arrives in pieces (streams, files), the fields are internal
+
+void hashStateInit(HashState* const state, const unsigned long seed);
+void hashStateUpdate(HashState* const state, const void* const data, const unsigned long size);
+unsigned long hashStateDigest(const HashState* const state); // equals hashValueLongSeeded over all the data supplied so far, the state can be updated further afterwards
 
 // TODO: add logger with various logging modes; add dynamic memory allocation tracker - store allocated memory addresses and corresponding addresses of *alloc callers; render lvgl via opengl optimized textures via embedded support via lvgl's generic opengl driver
 // TODO: make stack and queue use (double) linked list instead of growable array, and make a 'fast' list - also utilizing (double) linked list - create a deque
@@ -177,19 +200,11 @@ int hashValue(const void* const value, const int size); // fast non-cryptographi
 // TODO: separate crypto routines into a standalone library
 // TODO: separate networking module into a standalone library
 
-// TODO: add arena allocator and fixed-size object allocator
-// TODO: replace existing with recursive rw mutex
-
 // TODO: read /proc/mappings for tracking allocations; check whether sdl truly replaces its own *alloc funcs with supplied once - leak sanitizer reports there are leaks caused by sdl and our mechanism reports the opposite
 
-// TODO: select 'n poll - linux io multiplexing
-
 // TODO: create a shared/standard comparator object and an enum for the results and use this one common object in all collections
 // TODO: create a shared/standard deallocator object for the use with collections
 
-// TODO: linux kernel's epoll & select system - use for io multiplexing
-// TODO: create a coroutines implementation
-
 // TODO: interact with trusted platform module to store the keys
 
 // TODO: add/use opengl for drawing
@@ -0,0 +1,152 @@
+
+#include "arenaAllocator.h"
+
+// chunks form a list in the order of use, the ones past the current are the spares left after a reset/restore and get reused before allocating new ones;
+// each allocation is preceded by a header holding its size so realloc knows how much to copy
+
+enum : int {
+    ALIGNMENT = 16 // the same as malloc's
+};
+
+typedef struct _Chunk {
+    struct _Chunk* nullable next;
+    const int capacity;
+    int filled;
+    byte data[];
+} Chunk;
+
+typedef struct {
+    unsigned long size;
+    byte padding[ALIGNMENT - sizeof(unsigned long)];
+} Header;
+
+struct _ArenaAllocator {
+    Allocator allocator;
+    const int chunkSize;
+    Chunk* nullable first, * nullable current;
+};
+
+staticAssert(sizeof(Header) == ALIGNMENT && offsetof(Chunk, data) % ALIGNMENT == 0);
+
+static void* arenaMalloc(ArenaAllocator* const arena, const unsigned long size);
+static void* nullable arenaRealloc(ArenaAllocator* const arena, void* nullable const pointer, const unsigned long size);
+
+ArenaAllocator* arenaCreate(const int chunkSize) {
+    assert(chunkSize > 0);
+
+    ArenaAllocator* const arena = xmalloc(sizeof *arena);
+    unconst(arena->chunkSize) = (chunkSize + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    arena->first = arena->current = nullptr;
+
+    arena->allocator = (Allocator) {
+        Block_copy(^ void* (const unsigned long size) {
+            return arenaMalloc(arena, size);
+        }),
+        Block_copy(^ void* (const unsigned long elements, const unsigned long size) {
+            return xmemset(arenaMalloc(arena, elements * size), 0, elements * size);
+        }),
+        Block_copy(^ void* nullable (void* nullable const pointer, const unsigned long size) {
+            return arenaRealloc(arena, pointer, size);
+        }),
+        Block_copy(^ (void* nullable const) {}) // released in bulk
+    };
+
+    return arena;
+}
+
+const Allocator* arenaAllocator(ArenaAllocator* const arena) {
+    return &arena->allocator;
+}
+
+static inline int roundUp(const unsigned long size) {
+    assert(size <= (unsigned long) (1 << 30));
+    return (int) (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+static Chunk* chunkCreate(const int capacity) {
+    Chunk* const chunk = xmalloc(sizeof *chunk + (unsigned long) capacity);
+    chunk->next = nullptr;
+    unconst(chunk->capacity) = capacity;
+    chunk->filled = 0;
+    return chunk;
+}
+
+static Chunk* chunkWithRoom(ArenaAllocator* const arena, const int required) {
+    if (arena->current && arena->current->capacity - arena->current->filled >= required)
+        return arena->current;
+
+    Chunk* const spare = arena->current ? arena->current->next : arena->first;
+    if (spare && spare->capacity >= required) {
+        spare->filled = 0;
+        return arena->current = spare;
+    }
+
+    Chunk* const chunk = chunkCreate(max(arena->chunkSize, required)); // inserted before the spares, which are too small for this allocation
+    chunk->next = spare;
+    if (arena->current) arena->current->next = chunk;
+    else arena->first = chunk;
+
+    return arena->current = chunk;
+}
+
+static void* arenaMalloc(ArenaAllocator* const arena, const unsigned long size) {
+    const int required = (int) sizeof(Header) + roundUp(size);
+    Chunk* const chunk = chunkWithRoom(arena, required);
+
+    Header* const header = (Header*) (chunk->data + chunk->filled);
+    header->size = size;
+    chunk->filled += required;
+    return header + 1;
+}
+
+static void* nullable arenaRealloc(ArenaAllocator* const arena, void* nullable const pointer, const unsigned long size) {
+    if (!pointer) return arenaMalloc(arena, size);
+    if (!size) return nullptr;
+
+    Header* const header = (Header*) pointer - 1;
+    Chunk* const chunk = arena->current;
+    const bool latest = chunk && (byte*) pointer + roundUp(header->size) == chunk->data + chunk->filled;
+
+    if (latest && chunk->filled - roundUp(header->size) + roundUp(size) <= chunk->capacity) { // resize in place
+        chunk->filled += roundUp(size) - roundUp(header->size);
+        header->size = size;
+        return pointer;
+    }
+
+    if (size <= header->size) {
+        header->size = size;
+        return pointer;
+    }
+
+    void* const reallocated = arenaMalloc(arena, size);
+    xmemcpy(reallocated, pointer, header->size);
+    return reallocated;
+}
+
+ArenaMark arenaMark(ArenaAllocator* const arena) {
+    return (ArenaMark) {arena, arena->current, arena->current ? arena->current->filled : 0};
+}
+
+void arenaRestore(const ArenaMark* const mark) {
+    ArenaAllocator* const arena = mark->arena;
+    arena->current = mark->chunk;
+    if (arena->current) arena->current->filled = mark->filled;
+}
+
+void arenaReset(ArenaAllocator* const arena) {
+    arena->current = nullptr;
+}
+
+void arenaDestroy(ArenaAllocator* const arena) {
+    for (Chunk* chunk = arena->first, * next; chunk; chunk = next) {
+        next = chunk->next;
+        xfree(chunk);
+    }
+
+    Block_release(arena->allocator.malloc);
+    Block_release(arena->allocator.calloc);
+    Block_release(arena->allocator.realloc);
+    Block_release(arena->allocator.free);
+
+    xfree(arena);
+}
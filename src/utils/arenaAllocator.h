@@ -0,0 +1,25 @@
+
+#pragma once
+
+#include "../defs.h"
+
+// Region (bump) allocator - allocations are carved sequentially out of chunks, freeing a single allocation is a no-op,
+// everything allocated gets released at once via reset, restoring a mark or destroying the arena; not thread-safe;
+// for short-lived scratch data (per frame, per packet, per transfer) that would otherwise require lots of individual frees
+
+typedef struct _ArenaAllocator ArenaAllocator;
+
+typedef struct {
+    ArenaAllocator* const arena;
+    void* nullable const chunk;
+    const int filled;
+} ArenaMark; // position in the arena to roll back to
+
+ArenaAllocator* arenaCreate(const int chunkSize); // bigger allocations get dedicated chunks
+const Allocator* arenaAllocator(ArenaAllocator* const arena); // interface for containers (as their internalAllocator), valid until the arena is destroyed, free is a no-op, realloc grows the latest allocation in place
+ArenaMark arenaMark(ArenaAllocator* const arena);
+void arenaRestore(const ArenaMark* const mark); // releases everything allocated after the mark was taken, marks taken after this one become invalid
+void arenaReset(ArenaAllocator* const arena); // releases everything, chunks are kept for reuse
+void arenaDestroy(ArenaAllocator* const arena);
+
+#define arenaScope(x) [[maybe_unused]] cleanup(arenaRestore) const ArenaMark concat(_arenaMark_, __LINE__) = arenaMark(x) // nested scope, everything allocated in the arena till the end of the enclosing block gets released on leaving it
@@ -0,0 +1,349 @@
+
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include "poolAllocator.h"
+#include "rwMutex.h"
+#include "asyncIo.h"
+
+// the submission ring's tail and the completion ring's head are ours, the other ends are the kernel's; the amount of operations in flight
+// never exceeds the depth, which doesn't exceed the submission ring's size (the completion ring is twice as large), so neither ring overflows;
+// a submitter that finds the engine full reaps completions itself unless another thread is at it, the completion head is advanced before
+// each callback, so a callback can do that as well
+
+enum : int {
+    REQUESTS_PER_POOL_PAGE = 256
+};
+
+typedef struct {
+    AsyncIo* const io;
+    const AsyncIoCallback callback;
+    void* nullable const parameter;
+    void* const buffer; // the rest is for the fallback
+    const int fileDescriptor, size;
+    const long offset;
+    const bool readOrWrite;
+} Request;
+
+struct _AsyncIo {
+    const int depth, buffersCount, bufferSize;
+    Executor* const fallback;
+    PoolAllocator* const requestsPool; // requests are created and freed by different threads
+    RWMutex* const rwMutex; // for the submission side and the buffers
+    byte* nullable const buffers; // all of them in one mapping
+    int* const freeBuffers; // stack of indexes
+    bool* const checkedOut; // by index, to catch double releases
+    int freeBuffersCount;
+    atomic int inFlight; // till their callbacks return
+    atomic int inRing; // reserved till reaped, bounded by the depth
+    atomic bool reaping; // held by the thread invoking the callbacks
+
+    const int ring, eventFileDescriptor; // -1 in the fallback mode
+    const bool buffersRegistered;
+    void* nullable const sqMapping, * nullable const cqMapping; // the same one if the kernel supports that
+    const unsigned long sqMappingSize, cqMappingSize;
+    struct io_uring_sqe* nullable const sqes;
+    atomic unsigned* nullable const sqHead, * nullable const sqTail, * nullable const cqHead, * nullable const cqTail;
+    unsigned* nullable const sqArray;
+    struct io_uring_cqe* nullable const cqes;
+    const unsigned sqMask, cqMask, sqEntries;
+    unsigned queued; // not yet submitted
+};
+
+static thread_local AsyncIo* nullable gReaping = nullptr; // the engine whose completions this thread is invoking the callbacks of
+
+static long enter(const int ring, const unsigned toSubmit, const unsigned minComplete, const unsigned flags) {
+    return syscall(__NR_io_uring_enter, ring, toSubmit, minComplete, flags, nullptr, 0);
+}
+
+static bool probeOperations(const int ring) { // plain reads and writes came in 5.6 along with the probing itself, so a ring that can't be probed can't do them either
+    const int count = IORING_OP_WRITE + 1;
+    struct io_uring_probe* const probe = xcalloc(1, sizeof *probe + count * sizeof(struct io_uring_probe_op));
+
+    const bool supported = !syscall(__NR_io_uring_register, ring, IORING_REGISTER_PROBE, probe, count) && probe->ops_len >= count
+        && probe->ops[IORING_OP_READ].flags & probe->ops[IORING_OP_WRITE].flags
+            & probe->ops[IORING_OP_READ_FIXED].flags & probe->ops[IORING_OP_WRITE_FIXED].flags & IO_URING_OP_SUPPORTED;
+
+    xfree(probe);
+    return supported;
+}
+
+static bool setUpRing(AsyncIo* const io) { // returns false if io_uring isn't available (old kernel, seccomp, sysctl) or can't do the operations needed
+    struct io_uring_params params = {};
+    const int ring = (int) syscall(__NR_io_uring_setup, io->depth, &params);
+    if (ring < 0) return false;
+
+    if (!probeOperations(ring)) {
+        close(ring);
+        return false;
+    }
+
+    unsigned long sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    unsigned long cqSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    const bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single) sqSize = cqSize = max(sqSize, cqSize);
+
+    void* const sqMapping = mmap(nullptr, sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQ_RING);
+    assert(sqMapping != MAP_FAILED);
+    void* const cqMapping = single ? sqMapping : mmap(nullptr, cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_CQ_RING);
+    assert(cqMapping != MAP_FAILED);
+    void* const sqes = mmap(nullptr, params.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQES);
+    assert(sqes != MAP_FAILED);
+
+    unconst(io->ring) = ring;
+    unconst(io->sqMapping) = sqMapping;
+    unconst(io->cqMapping) = cqMapping;
+    unconst(io->sqMappingSize) = sqSize;
+    unconst(io->cqMappingSize) = cqSize;
+    unconst(io->sqes) = sqes;
+    unconst(io->sqHead) = sqMapping + params.sq_off.head;
+    unconst(io->sqTail) = sqMapping + params.sq_off.tail;
+    unconst(io->sqArray) = sqMapping + params.sq_off.array;
+    unconst(io->sqMask) = *(unsigned*) (sqMapping + params.sq_off.ring_mask);
+    unconst(io->sqEntries) = params.sq_entries;
+    unconst(io->cqHead) = cqMapping + params.cq_off.head;
+    unconst(io->cqTail) = cqMapping + params.cq_off.tail;
+    unconst(io->cqes) = cqMapping + params.cq_off.cqes;
+    unconst(io->cqMask) = *(unsigned*) (cqMapping + params.cq_off.ring_mask);
+
+    if (io->buffersCount) {
+        struct iovec* const vectors = xmalloc(io->buffersCount * sizeof(struct iovec));
+        for (int i = 0; i < io->buffersCount; i++)
+            vectors[i] = (struct iovec) {io->buffers + (unsigned long) i * io->bufferSize, (unsigned long) io->bufferSize};
+
+        unconst(io->buffersRegistered) = !syscall(__NR_io_uring_register, ring, IORING_REGISTER_BUFFERS, vectors, io->buffersCount); // can exceed the memlock limit on older kernels, plain operations work on them anyway
+        xfree(vectors);
+    }
+
+    assert((unconst(io->eventFileDescriptor) = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) >= 0);
+    assert(!syscall(__NR_io_uring_register, ring, IORING_REGISTER_EVENTFD, &io->eventFileDescriptor, 1));
+
+    return true;
+}
+
+AsyncIo* asyncIoCreate(const int depth, const int buffers, const int bufferSize, Executor* const fallback, const int flags) {
+    assert(depth > 0 && buffers >= 0 && bufferSize >= 0 && (!buffers || bufferSize));
+
+    AsyncIo* const io = xcalloc(1, sizeof *io);
+    unconst(io->depth) = depth;
+    unconst(io->buffersCount) = buffers;
+    unconst(io->bufferSize) = (int) (((unsigned long) bufferSize + sysconf(_SC_PAGESIZE) - 1) & ~(sysconf(_SC_PAGESIZE) - 1));
+    unconst(io->fallback) = fallback;
+    unconst(io->requestsPool) = poolAllocatorCreate(sizeof(Request), REQUESTS_PER_POOL_PAGE, true, true);
+    unconst(io->rwMutex) = rwMutexCreate(RW_MUTEX_FLAG_NONE);
+    unconst(io->freeBuffers) = xmalloc(max(1, buffers) * sizeof(int));
+    unconst(io->checkedOut) = xcalloc(max(1, buffers), sizeof(bool));
+    unconst(io->ring) = unconst(io->eventFileDescriptor) = -1;
+
+    if (buffers) {
+        unconst(io->buffers) = mmap(nullptr, (unsigned long) buffers * io->bufferSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        assert(io->buffers != MAP_FAILED);
+    }
+    for (int i = 0; i < buffers; i++)
+        io->freeBuffers[io->freeBuffersCount++] = buffers - 1 - i;
+
+    if (!(flags & ASYNC_IO_FLAG_NO_RING)) setUpRing(io);
+    return io;
+}
+
+bool asyncIoRing(AsyncIo* const io) {
+    return io->ring >= 0;
+}
+
+void* nullable asyncIoAcquireBuffer(AsyncIo* const io) {
+    rwMutexWriteLock(io->rwMutex);
+
+    void* nullable buffer = nullptr;
+    if (io->freeBuffersCount) {
+        const int index = io->freeBuffers[--io->freeBuffersCount];
+        io->checkedOut[index] = true;
+        buffer = io->buffers + (unsigned long) index * io->bufferSize;
+    }
+
+    rwMutexWriteUnlock(io->rwMutex);
+    return buffer;
+}
+
+void asyncIoReleaseBuffer(AsyncIo* const io, void* const buffer) {
+    const long index = (byte*) buffer - io->buffers;
+    assert(io->buffers && index >= 0 && index % io->bufferSize == 0 && index / io->bufferSize < io->buffersCount);
+
+    rwMutexWriteLock(io->rwMutex);
+    assert(io->checkedOut[index / io->bufferSize]); // a double release would hand it out twice
+    io->checkedOut[index / io->bufferSize] = false;
+    io->freeBuffers[io->freeBuffersCount++] = (int) (index / io->bufferSize);
+    rwMutexWriteUnlock(io->rwMutex);
+}
+
+int asyncIoBufferSize(AsyncIo* const io) {
+    return io->bufferSize;
+}
+
+static void finish(Request* const request, const long result) {
+    AsyncIo* const io = request->io;
+    const AsyncIoCallback callback = request->callback;
+    void* nullable const parameter = request->parameter;
+
+    poolAllocatorAllocator(io->requestsPool)->free(request);
+    callback(result, parameter);
+    io->inFlight--; // after the callback, so the operations it queues are never missed by those waiting for none to be left
+}
+
+static void fallbackTask(void* nullable const parameter) {
+    Request* const request = parameter;
+    const long result = request->readOrWrite
+        ? pread(request->fileDescriptor, request->buffer, (unsigned long) request->size, request->offset)
+        : pwrite(request->fileDescriptor, request->buffer, (unsigned long) request->size, request->offset);
+    finish(request, result < 0 ? -errno : result);
+}
+
+static int reap(AsyncIo* const io) {
+    int reaped = 0;
+
+    while (true) {
+        const unsigned head = atomic_load_explicit(io->cqHead, memory_order_relaxed);
+        if (head == atomic_load_explicit(io->cqTail, memory_order_acquire)) break;
+
+        const struct io_uring_cqe* const cqe = io->cqes + (head & io->cqMask);
+        Request* const request = (Request*) cqe->user_data;
+        const long result = cqe->res;
+
+        atomic_store_explicit(io->cqHead, head + 1, memory_order_release);
+        io->inRing--;
+        finish(request, result);
+        reaped++;
+    }
+
+    return reaped;
+}
+
+static void reserve(AsyncIo* const io) { // waits till there's room among the operations in flight
+    for (int inRing = io->inRing;;) {
+        if (inRing < io->depth) {
+            if (atomic_compare_exchange_weak(&io->inRing, &inRing, inRing + 1)) return;
+            continue;
+        }
+
+        asyncIoSubmit(io); // the queued ones might be what's being waited for
+        if (!asyncIoComplete(io, true)) xyield(); // reaps unless another thread is already at it, nested if it's called from a callback
+        inRing = io->inRing;
+    }
+}
+
+void asyncIoQueue(AsyncIo* const io, const bool readOrWrite, const int fileDescriptor, void* const buffer, const int size, const long offset, const AsyncIoCallback callback, void* nullable const parameter) {
+    assert(fileDescriptor >= 0 && size >= 0 && offset >= 0);
+
+    Request* const request = poolAllocatorAllocator(io->requestsPool)->malloc(sizeof *request);
+    assignToStructWithConsts(request, io, callback, parameter, buffer, fileDescriptor, size, offset, readOrWrite)
+
+    io->inFlight++;
+
+    if (!asyncIoRing(io)) {
+        executorSubmit(io->fallback, fallbackTask, request);
+        return;
+    }
+
+    reserve(io);
+
+    const long bufferIndex = io->buffersRegistered && (byte*) buffer >= io->buffers ? ((byte*) buffer - io->buffers) / io->bufferSize : -1;
+    const bool fixed = bufferIndex >= 0 && bufferIndex < io->buffersCount && (byte*) buffer + size <= io->buffers + (bufferIndex + 1) * io->bufferSize;
+
+    rwMutexWriteLock(io->rwMutex);
+
+    const unsigned tail = atomic_load_explicit(io->sqTail, memory_order_relaxed), index = tail & io->sqMask;
+    io->sqes[index] = (struct io_uring_sqe) {
+        .opcode = fixed ? (readOrWrite ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED) : (readOrWrite ? IORING_OP_READ : IORING_OP_WRITE),
+        .fd = fileDescriptor,
+        .off = (unsigned long) offset,
+        .addr = (unsigned long) buffer,
+        .len = (unsigned) size,
+        .buf_index = fixed ? (unsigned short) bufferIndex : 0,
+        .user_data = (unsigned long) request
+    };
+    io->sqArray[index] = index;
+    atomic_store_explicit(io->sqTail, tail + 1, memory_order_release);
+    io->queued++;
+
+    rwMutexWriteUnlock(io->rwMutex);
+}
+
+void asyncIoSubmit(AsyncIo* const io) {
+    if (!asyncIoRing(io)) return;
+    rwMutexWriteLock(io->rwMutex);
+
+    while (io->queued) {
+        const long submitted = enter(io->ring, io->queued, 0, 0);
+        if (submitted >= 0) io->queued -= (unsigned) submitted;
+        else {
+            assert(errno == EINTR || errno == EAGAIN || errno == EBUSY); // interrupted or short of resources for a moment
+            xyield();
+        }
+    }
+
+    rwMutexWriteUnlock(io->rwMutex);
+}
+
+int asyncIoEventFileDescriptor(AsyncIo* const io) {
+    return io->eventFileDescriptor;
+}
+
+int asyncIoComplete(AsyncIo* const io, const bool wait) {
+    if (!asyncIoRing(io)) {
+        if (wait && io->inFlight) xyield();
+        return 0;
+    }
+
+    // resets its counter even if another thread is reaping, otherwise a reactor watching it level-triggered would keep reporting it;
+    // the completions are counted on the ring, and the reaping thread checks it again after letting go, so none signalled meanwhile is missed
+    USED(read(io->eventFileDescriptor, &(unsigned long) {0}, sizeof(unsigned long)));
+
+    AsyncIo* nullable const previous = gReaping;
+    int reaped = 0;
+
+    do {
+        if (previous != io && atomic_exchange(&io->reaping, true)) break;
+        gReaping = io;
+
+        reaped += reap(io);
+        if (!reaped && wait && io->inRing) { // those whose callbacks are running up the stack (nested reaping) aren't waited for
+            asyncIoSubmit(io);
+            while (enter(io->ring, 0, 1, IORING_ENTER_GETEVENTS) < 0) assert(errno == EINTR);
+            reaped += reap(io);
+        }
+
+        gReaping = previous;
+        if (previous == io) break; // the outer reaping goes on
+
+        atomic_exchange(&io->reaping, false); // an exchange so that it's ordered after those of the threads that found it held
+    } while (atomic_load_explicit(io->cqHead, memory_order_relaxed) != atomic_load_explicit(io->cqTail, memory_order_acquire));
+
+    return reaped;
+}
+
+int asyncIoInFlight(AsyncIo* const io) {
+    return io->inFlight;
+}
+
+void asyncIoDestroy(AsyncIo* const io) {
+    assert(!io->inFlight);
+
+    if (asyncIoRing(io)) {
+        munmap(io->sqes, io->sqEntries * sizeof(struct io_uring_sqe));
+        if (io->cqMapping != io->sqMapping) munmap(io->cqMapping, io->cqMappingSize);
+        munmap(io->sqMapping, io->sqMappingSize);
+        close(io->eventFileDescriptor);
+        close(io->ring); // unregisters the buffers and the eventfd
+    }
+
+    if (io->buffers) munmap(io->buffers, (unsigned long) io->buffersCount * io->bufferSize);
+    xfree(io->freeBuffers);
+    xfree(io->checkedOut);
+    rwMutexDestroy(io->rwMutex);
+    poolAllocatorDestroy(io->requestsPool);
+    xfree(io);
+}
@@ -0,0 +1,31 @@
+
+#pragma once
+
+#include "../defs.h"
+#include "executor.h"
+
+// Asynchronous file reads and writes - through io_uring where the kernel allows it: operations are queued into the shared submission ring
+// and handed to the kernel in batches by a single syscall, completions are reaped from the completion ring without any syscall,
+// a set of preallocated buffers is registered with the kernel so operations on them skip the per-call page pinning;
+// falls back to pread/pwrite on a thread pool otherwise; results are what the syscalls return, short reads/writes included
+
+typedef struct _AsyncIo AsyncIo;
+
+typedef void (* AsyncIoCallback)(const long result, void* nullable const parameter); // result - transferred bytes or a negated errno
+
+typedef enum : int {
+    ASYNC_IO_FLAG_NONE = 0,
+    ASYNC_IO_FLAG_NO_RING = 1 << 0 // use the thread pool even if io_uring is available
+} AsyncIoFlag;
+
+AsyncIo* asyncIoCreate(const int depth, const int buffers, const int bufferSize, Executor* const fallback, const int flags); // depth - operations in flight at most (a submitter that reaches it reaps completions itself or waits for whoever reaps them); buffers of bufferSize each are page aligned
+bool asyncIoRing(AsyncIo* const io); // whether it's io_uring-backed
+void* nullable asyncIoAcquireBuffer(AsyncIo* const io); // thread-safe, one of the registered buffers, null if all are taken
+void asyncIoReleaseBuffer(AsyncIo* const io, void* const buffer); // thread-safe, the buffer must be an acquired one that hasn't been released yet
+int asyncIoBufferSize(AsyncIo* const io);
+void asyncIoQueue(AsyncIo* const io, const bool readOrWrite, const int fileDescriptor, void* const buffer, const int size, const long offset, const AsyncIoCallback callback, void* nullable const parameter); // thread-safe, queues the operation, the buffer must stay valid till the callback; in the fallback mode it starts right away
+void asyncIoSubmit(AsyncIo* const io); // thread-safe, hands the queued operations to the kernel at once
+int asyncIoEventFileDescriptor(AsyncIo* const io); // becomes readable when there are completions to reap, -1 in the fallback mode
+int asyncIoComplete(AsyncIo* const io, const bool wait); // thread-safe, invokes the callbacks of the completed operations (io_uring only, the fallback invokes them on the pool's threads right away), optionally waits for at least one if there are operations in flight; returns the amount of invoked callbacks, zero if another thread is invoking them at the moment
+int asyncIoInFlight(AsyncIo* const io); // queued or submitted and not completed yet, including those whose callbacks are still running
+void asyncIoDestroy(AsyncIo* const io); // all the operations must have completed
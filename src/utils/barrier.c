@@ -1,17 +1,43 @@
 
+#include <stdatomic.h>
 #include "barrier.h"
 
+enum : unsigned {
+    OPEN = 0,
+    TAKEN = 1,
+    TAKEN_WITH_SLEEPERS = 2
+};
+
+static const int SPINS = 100; // the scopes are usually short, so spinning a bit often saves a sleep and a wake up syscall
+
+static inline bool take(Barrier* const barrier) {
+    unsigned expected = OPEN;
+    return atomic_compare_exchange_strong_explicit(barrier, &expected, TAKEN, memory_order_acquire, memory_order_relaxed);
+}
+
 bool barrierScopeBegin(Barrier* const barrier) {
-    if (*barrier) return true;
-    *barrier = true;
-    return false;
+    return !take(barrier);
 }
 
 void barrierScopeEnd(Barrier* const barrier) {
-    *barrier = false;
+    if (atomic_exchange_explicit(barrier, OPEN, memory_order_release) == TAKEN_WITH_SLEEPERS)
+        futexWake(barrier, 1); // the woken one marks it as having sleepers again when taking it, so the rest get woken by the next scope end
 }
 
 void barrierWait(Barrier* const barrier) {
-    while (*barrier) xyield();
-    *barrier = true;
+    assert(barrierWaitTimeout(barrier, FUTEX_WAIT_FOREVER));
+}
+
+bool barrierWaitTimeout(Barrier* const barrier, const int timeoutMillis) {
+    for (int i = 0; i < SPINS; i++) {
+        if (take(barrier)) return true;
+        if (atomic_load_explicit(barrier, memory_order_relaxed) == TAKEN_WITH_SLEEPERS) break; // others already sleep, it's going to take long
+        __builtin_ia32_pause();
+    }
+
+    const long deadline = futexDeadline(timeoutMillis);
+    while (atomic_exchange_explicit(barrier, TAKEN_WITH_SLEEPERS, memory_order_acquire) != OPEN) // may be taken with sleepers while there are none left, which only costs a spare wake up
+        if (!futexWaitUntil(barrier, TAKEN_WITH_SLEEPERS, deadline)) return false;
+
+    return true;
 }
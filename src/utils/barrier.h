@@ -1,12 +1,13 @@
 
 #pragma once
 
-#include "../defs.h"
+#include "futex.h"
 
-typedef atomic bool Barrier; // multiple threads can wait while one another thread is running or looping or running a next iteration of the loop - basically wait for the thread to finish when SDL_WaitThread or similar cannot be used
-#define BARRIER(x) Barrier x = false
+typedef atomic unsigned Barrier; // multiple threads can wait while one another thread is running or looping or running a next iteration of the loop - basically wait for the thread to finish when SDL_WaitThread or similar cannot be used; 0 - open, 1 - taken, 2 - taken and somebody sleeps waiting for it
+#define BARRIER(x) Barrier x = 0
 
-bool barrierScopeBegin(Barrier* const barrier); // returns true if current thread loop iteration must be skipped (or even the whole loop must be stopped - depends on the case)
-void barrierScopeEnd(Barrier* const barrier);
+bool barrierScopeBegin(Barrier* const barrier); // atomically takes it if open, returns true if current thread loop iteration must be skipped (or even the whole loop must be stopped - depends on the case)
+void barrierScopeEnd(Barrier* const barrier); // opens it, waking a waiter if there is one
 inline void barrierReset(Barrier* const barrier) { barrierScopeEnd(barrier); }
-void barrierWait(Barrier* const barrier);
+void barrierWait(Barrier* const barrier); // waits until it's open and takes it; spins briefly first, then sleeps in the kernel
+bool barrierWaitTimeout(Barrier* const barrier, const int timeoutMillis); // the same, returns false (without taking it) if it hasn't opened in time
@@ -1,59 +1,102 @@
 
-#include <SDL3/SDL_mutex.h>
+#include <stdatomic.h>
 #include "conditionObserver.h"
 
+// the variable is read and written atomically as a whole, each write bumps the version which the waiters sleep on,
+// so a waiter that has seen a stale value can't miss the write that comes after - its futex wait fails as the version has changed
+
+static const int MAX_SPINS = 1000, ADAPTATION_RATE = 8; // the spin estimate moves by 1/ADAPTATION_RATE of the difference after each wait
+
 struct _ConditionObserver {
     void* const variablePointer; // allocated elsewhere
     const ConditionObserverVariableType variableType;
-    SDL_Mutex* const mutex;
-    SDL_Condition* const condition;
-    bool locked;
+    atomic unsigned version;
+    atomic int waiters;
+    atomic int spins; // how long the recent waits, which succeeded while spinning, took
 };
 
 ConditionObserver* conditionObserverCreate(void* const variablePointer, const ConditionObserverVariableType variableType) {
+    assert(!((unsigned long) variablePointer % variableType));
+
     ConditionObserver* const observer = xmalloc(sizeof *observer);
     unconst(observer->variablePointer) = variablePointer;
     unconst(observer->variableType) = variableType;
-    assert(unconst(observer->mutex) = SDL_CreateMutex());
-    assert(unconst(observer->condition) = SDL_CreateCondition());
-    observer->locked = false;
+    observer->version = 0;
+    observer->waiters = 0;
+    observer->spins = 0;
     return observer;
 }
 
 void conditionObserverGetVariableValue(ConditionObserver* const observer, void* const buffer) {
-    SDL_LockMutex(observer->mutex);
-    xmemcpy(buffer, observer->variablePointer, observer->variableType);
-    SDL_UnlockMutex(observer->mutex);
+    switch (observer->variableType) {
+        case CONDITION_OBSERVER_VARIABLE_TYPE_BYTE: *(byte*) buffer = __atomic_load_n((byte*) observer->variablePointer, __ATOMIC_ACQUIRE); break;
+        case CONDITION_OBSERVER_VARIABLE_TYPE_SHORT: *(short*) buffer = __atomic_load_n((short*) observer->variablePointer, __ATOMIC_ACQUIRE); break;
+        case CONDITION_OBSERVER_VARIABLE_TYPE_INT: *(int*) buffer = __atomic_load_n((int*) observer->variablePointer, __ATOMIC_ACQUIRE); break;
+        case CONDITION_OBSERVER_VARIABLE_TYPE_LONG: *(long*) buffer = __atomic_load_n((long*) observer->variablePointer, __ATOMIC_ACQUIRE); break;
+    }
 }
 
 void conditionObserverSetVariableValue(ConditionObserver* const observer, const void* const value) {
-    SDL_LockMutex(observer->mutex);
-    observer->locked = true;
+    switch (observer->variableType) {
+        case CONDITION_OBSERVER_VARIABLE_TYPE_BYTE: __atomic_store_n((byte*) observer->variablePointer, *(const byte*) value, __ATOMIC_RELEASE); break;
+        case CONDITION_OBSERVER_VARIABLE_TYPE_SHORT: __atomic_store_n((short*) observer->variablePointer, *(const short*) value, __ATOMIC_RELEASE); break;
+        case CONDITION_OBSERVER_VARIABLE_TYPE_INT: __atomic_store_n((int*) observer->variablePointer, *(const int*) value, __ATOMIC_RELEASE); break;
+        case CONDITION_OBSERVER_VARIABLE_TYPE_LONG: __atomic_store_n((long*) observer->variablePointer, *(const long*) value, __ATOMIC_RELEASE); break;
+    }
+
+    atomic_fetch_add(&observer->version, 1); // both are sequentially consistent - either the waiter sees the new version or the setter sees the waiter
+    if (observer->waiters) futexWake(&observer->version, FUTEX_WAKE_ALL);
+}
 
-    xmemcpy(observer->variablePointer, value, observer->variableType);
-    SDL_BroadcastCondition(observer->condition);
+static bool holds(ConditionObserver* const observer, const ConditionObserverPredicate predicate) {
+    long value; // big enough for any of the types
+    conditionObserverGetVariableValue(observer, &value);
+    return predicate(&value);
+}
 
-    observer->locked = false;
-    SDL_UnlockMutex(observer->mutex);
+static void adaptSpins(ConditionObserver* const observer, const int spent) {
+    const int spins = observer->spins;
+    observer->spins = spins + (spent - spins) / ADAPTATION_RATE; // racy, but it's just an estimate
 }
 
-void conditionObserverWaitForVariableValue(ConditionObserver* const observer, const void* const value) {
-    SDL_LockMutex(observer->mutex);
-    observer->locked = true;
+bool conditionObserverWaitFor(ConditionObserver* const observer, const ConditionObserverPredicate predicate, const int timeoutMillis) {
+    if (holds(observer, predicate)) return true;
+
+    const int spinLimit = min(MAX_SPINS, observer->spins * 2 + 10);
+    for (int i = 0; i < spinLimit; i++) {
+        __builtin_ia32_pause();
+        if (!holds(observer, predicate)) continue;
 
-    while (xmemcmp(observer->variablePointer, value, observer->variableType) != 0)
-        SDL_WaitCondition(observer->condition, observer->mutex);
+        adaptSpins(observer, i);
+        return true;
+    }
+    adaptSpins(observer, 0); // spinning didn't pay off, spin less next time
 
-    observer->locked = false;
-    SDL_UnlockMutex(observer->mutex);
+    const long deadline = futexDeadline(timeoutMillis);
+    bool satisfied = false;
+    observer->waiters++;
+
+    while (true) {
+        const unsigned version = observer->version;
+        if ((satisfied = holds(observer, predicate))) break;
+        if (!futexWaitUntil(&observer->version, version, deadline)) break;
+    }
+
+    observer->waiters--;
+    return satisfied || holds(observer, predicate); // could have been set right at the timeout
 }
 
-void conditionObserverDestroy(ConditionObserver* const observer) {
-    SDL_LockMutex(observer->mutex);
-    assert(!observer->locked);
-    SDL_UnlockMutex(observer->mutex);
+bool conditionObserverWaitForVariableValueTimeout(ConditionObserver* const observer, const void* const value, const int timeoutMillis) {
+    return conditionObserverWaitFor(observer, ^ bool (const void* const current) {
+        return !xmemcmp(current, value, observer->variableType);
+    }, timeoutMillis);
+}
 
-    SDL_DestroyCondition(observer->condition);
-    SDL_DestroyMutex(observer->mutex);
+void conditionObserverWaitForVariableValue(ConditionObserver* const observer, const void* const value) {
+    assert(conditionObserverWaitForVariableValueTimeout(observer, value, FUTEX_WAIT_FOREVER));
+}
+
+void conditionObserverDestroy(ConditionObserver* const observer) {
+    assert(!observer->waiters);
     xfree(observer);
 }
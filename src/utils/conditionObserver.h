@@ -1,7 +1,7 @@
 
 #pragma once
 
-#include "../defs.h"
+#include "futex.h"
 
 typedef enum : byte {
     CONDITION_OBSERVER_VARIABLE_TYPE_BYTE = sizeof(byte),
@@ -15,8 +15,12 @@ typedef enum : byte {
 
 typedef struct _ConditionObserver ConditionObserver;
 
-ConditionObserver* conditionObserverCreate(void* const variablePointer, const ConditionObserverVariableType variableType);
+typedef bool (^ ConditionObserverPredicate)(const void* const value); // value points to a snapshot of the variable
+
+ConditionObserver* conditionObserverCreate(void* const variablePointer, const ConditionObserverVariableType variableType); // the variable must be aligned to its size and must be accessed through the observer only
 void conditionObserverGetVariableValue(ConditionObserver* const observer, void* const buffer);
-void conditionObserverSetVariableValue(ConditionObserver* const observer, const void* const value);
+void conditionObserverSetVariableValue(ConditionObserver* const observer, const void* const value); // wakes all the waiters (makes a syscall only if there are some)
 void conditionObserverWaitForVariableValue(ConditionObserver* const observer, const void* const value);
-void conditionObserverDestroy(ConditionObserver* const observer);
+bool conditionObserverWaitForVariableValueTimeout(ConditionObserver* const observer, const void* const value, const int timeoutMillis); // returns false if the variable hasn't become equal to the value in time
+bool conditionObserverWaitFor(ConditionObserver* const observer, const ConditionObserverPredicate predicate, const int timeoutMillis); // until the predicate holds (e.g. a counter reaches some amount), FUTEX_WAIT_FOREVER to wait without a timeout; returns false on timeout; spins for a while first, adapting how long to the waits that recently succeeded while spinning
+void conditionObserverDestroy(ConditionObserver* const observer); // fails if somebody still waits
@@ -0,0 +1,140 @@
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include "coroutine.h"
+
+#if __has_feature(address_sanitizer) // asan needs to know which stack is current, otherwise it reports the switches as stack overflows and underflows
+void __sanitizer_start_switch_fiber(void** nullable const fakeStackSave, const void* const bottom, const unsigned long size);
+void __sanitizer_finish_switch_fiber(void* nullable const fakeStackSave, const void* nullable* nullable const bottomOld, unsigned long* nullable const sizeOld);
+#define startSwitch(x, y, z) __sanitizer_start_switch_fiber(x, y, z)
+#define finishSwitch(x, y, z) __sanitizer_finish_switch_fiber(x, y, z)
+#else
+#define startSwitch(x, y, z) USED(0)
+#define finishSwitch(x, y, z) USED(0)
+#endif
+
+struct _Coroutine {
+    void* stackPointer, * resumerStackPointer; // saved stack pointers of the coroutine while it's suspended and of its resumer while it's running
+    void* const stack; // the guard page lies right below it
+    const unsigned long stackSize, guardSize;
+    const CoroutineFunction function;
+    void* nullable const parameter;
+    Coroutine* nullable resumer; // the coroutine that was current before this one has been resumed (if any)
+    bool running, finished;
+    void* nullable fakeStack; // asan's stuff
+    const void* nullable resumerStackBottom;
+    unsigned long resumerStackSize;
+};
+
+static const int DEFAULT_STACK_SIZE = 64 * 1024;
+
+static thread_local Coroutine* nullable gCurrent = nullptr;
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wundefined-internal"
+static void switchContext(void** const save, void* const load); // saves the callee-saved registers on the current stack and the stack pointer into save, then restores them from the load stack
+static void trampoline(void);
+#pragma clang diagnostic pop
+
+asm(
+    "switchContext:\n"
+    "pushq %rbp\n"
+    "pushq %rbx\n"
+    "pushq %r12\n"
+    "pushq %r13\n"
+    "pushq %r14\n"
+    "pushq %r15\n"
+    "movq %rsp, (%rdi)\n"
+    "movq %rsi, %rsp\n"
+    "popq %r15\n"
+    "popq %r14\n"
+    "popq %r13\n"
+    "popq %r12\n"
+    "popq %rbx\n"
+    "popq %rbp\n"
+    "ret\n"
+
+    "trampoline:\n" // the first switch to a coroutine returns here, with the coroutine in r12 and the stack pointer aligned to 16 bytes
+    "movq %r12, %rdi\n"
+    "call entry\n"
+    "ud2" // entry never returns
+);
+
+used static void entry(Coroutine* const coroutine) {
+    finishSwitch(nullptr, &coroutine->resumerStackBottom, &coroutine->resumerStackSize);
+
+    coroutine->function(coroutine->parameter);
+    coroutine->finished = true;
+
+    startSwitch(nullptr, coroutine->resumerStackBottom, coroutine->resumerStackSize); // null - this stack is done with
+    switchContext(&coroutine->stackPointer, coroutine->resumerStackPointer);
+    assert(false);
+}
+
+Coroutine* coroutineCreate(const CoroutineFunction function, void* nullable const parameter, const int stackSize) {
+    assert(stackSize >= 0);
+
+    const unsigned long pageSize = sysconf(_SC_PAGESIZE);
+    const unsigned long size = ((stackSize ? (unsigned long) stackSize : (unsigned long) DEFAULT_STACK_SIZE) + pageSize - 1) & ~(pageSize - 1);
+
+    void* const mapping = mmap(nullptr, pageSize + size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK | MAP_NORESERVE, -1, 0);
+    assert(mapping != MAP_FAILED);
+    assert(!mprotect(mapping, pageSize, PROT_NONE)); // the stack grows down towards it
+
+    Coroutine* const coroutine = xmalloc(sizeof *coroutine);
+    assignToStructWithConsts(coroutine, nullptr, nullptr, mapping + pageSize, size, pageSize, function, parameter, nullptr, false, false, nullptr, nullptr, 0)
+
+    void** stack = coroutine->stack + size; // what switchContext pops: r15, r14, r13, r12, rbx, rbp and the return address, plus the padding that aligns the trampoline's call
+    *--stack = nullptr;
+    *--stack = nullptr;
+    *--stack = (void*) trampoline;
+    *--stack = nullptr; // rbp, terminates the frame pointer chain for backtraces
+    *--stack = nullptr;
+    *--stack = coroutine; // r12
+    *--stack = nullptr;
+    *--stack = nullptr;
+    *--stack = nullptr;
+    coroutine->stackPointer = stack;
+
+    return coroutine;
+}
+
+bool coroutineResume(Coroutine* const coroutine) {
+    assert(!coroutine->running && !coroutine->finished);
+
+    coroutine->running = true;
+    coroutine->resumer = gCurrent;
+    gCurrent = coroutine;
+
+    [[maybe_unused]] void* nullable fakeStack = nullptr;
+    startSwitch(&fakeStack, coroutine->stack, coroutine->stackSize);
+    switchContext(&coroutine->resumerStackPointer, coroutine->stackPointer);
+    finishSwitch(fakeStack, nullptr, nullptr);
+
+    gCurrent = coroutine->resumer;
+    coroutine->running = false;
+    return !coroutine->finished;
+}
+
+void coroutineYield(void) {
+    Coroutine* const coroutine = gCurrent;
+    assert(coroutine);
+
+    startSwitch(&coroutine->fakeStack, coroutine->resumerStackBottom, coroutine->resumerStackSize);
+    switchContext(&coroutine->stackPointer, coroutine->resumerStackPointer);
+    finishSwitch(coroutine->fakeStack, &coroutine->resumerStackBottom, &coroutine->resumerStackSize);
+}
+
+Coroutine* nullable coroutineCurrent(void) {
+    return gCurrent;
+}
+
+bool coroutineFinished(Coroutine* const coroutine) {
+    return coroutine->finished;
+}
+
+void coroutineDestroy(Coroutine* const coroutine) {
+    assert(!coroutine->running);
+    assert(!munmap(coroutine->stack - coroutine->guardSize, coroutine->guardSize + coroutine->stackSize));
+    xfree(coroutine);
+}
@@ -0,0 +1,19 @@
+
+#pragma once
+
+#include "../defs.h"
+
+// Stackful coroutines - each one runs on its own small mmap'd stack with a guard page below it (an overflow faults instead of corrupting
+// the neighbouring memory), switching is a handful of register saves and a stack pointer swap, so thousands of suspended coroutines cost
+// only their stacks; a coroutine runs on the thread that resumes it, it can resume other coroutines itself
+
+typedef struct _Coroutine Coroutine;
+
+typedef void (* CoroutineFunction)(void* nullable const parameter);
+
+Coroutine* coroutineCreate(const CoroutineFunction function, void* nullable const parameter, const int stackSize); // zero stack size means the default one (64 KiB), rounded up to whole pages; doesn't start it
+bool coroutineResume(Coroutine* const coroutine); // runs the coroutine until it yields or returns, returns whether it can be resumed again (it has yielded)
+void coroutineYield(void); // suspends the current coroutine, switching back to whoever resumed it, must be called from within a coroutine
+Coroutine* nullable coroutineCurrent(void); // the coroutine running on this thread, null if it's not running one
+bool coroutineFinished(Coroutine* const coroutine);
+void coroutineDestroy(Coroutine* const coroutine); // mustn't be running, a suspended one is destroyed without unwinding it, so it must not hold anything that needs releasing
@@ -0,0 +1,184 @@
+
+#include <pthread.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "../collections/workStealingDeque.h"
+#include "../collections/mpmcQueue.h"
+#include "poolAllocator.h"
+#include "futex.h"
+#include "executor.h"
+
+// idle workers announce themselves in the sleepers counter before rechecking the queues, submitters bump the signal after publishing
+// a task and wake a sleeper only if there are any (a fence on both sides, so one of them always sees the other), a worker that missed
+// the task sleeps on the signal value it read beforehand, so its futex wait fails right away
+
+enum : int {
+    DEQUE_CAPACITY = 1024, // a worker's own tasks beyond that go to the injection queue
+    INJECTION_CAPACITY = 4096,
+    TASKS_PER_POOL_PAGE = 256,
+    MAX_NAME_LENGTH = 15 // without the terminator, pthread's limit
+};
+
+typedef struct {
+    const ExecutorTaskFunction function;
+    void* nullable const parameter;
+} Task;
+
+typedef struct {
+    Executor* const executor;
+    WorkStealingDeque* const deque;
+    pthread_t thread;
+    unsigned random; // for picking victims
+} Worker;
+
+struct _Executor {
+    const int threads;
+    Worker* const workers;
+    MPMCQueue* const injection; // <Task*>
+    PoolAllocator* const tasksPool; // tasks are created and freed by different threads
+    atomic bool running;
+    atomic unsigned signal; // bumped on each submission, idle workers sleep on it
+    atomic int sleepers;
+};
+
+static thread_local Worker* nullable gCurrentWorker = nullptr;
+
+static void* nullable workerLoop(void* const parameter);
+
+static void freeTask(void* const task, Executor* const executor) {
+    poolAllocatorAllocator(executor->tasksPool)->free(task);
+}
+
+Executor* executorCreate(const int threads, const char* nullable const name) {
+    assert(threads >= 0);
+
+    Executor* const executor = xmalloc(sizeof *executor);
+    unconst(executor->threads) = threads ? threads : max(1, (int) sysconf(_SC_NPROCESSORS_ONLN));
+    unconst(executor->workers) = xmalloc(executor->threads * sizeof(Worker));
+    unconst(executor->injection) = mpmcQueueCreate(DEFAULT_ALLOCATOR, INJECTION_CAPACITY, nullptr);
+    unconst(executor->tasksPool) = poolAllocatorCreate(sizeof(Task), TASKS_PER_POOL_PAGE, true, true);
+    executor->running = true;
+    executor->signal = 0;
+    executor->sleepers = 0;
+
+    char threadName[MAX_NAME_LENGTH + 1] = {};
+    if (name) strncpy(threadName, name, MAX_NAME_LENGTH);
+
+    for (int i = 0; i < executor->threads; i++) { // all of them first, as the workers steal from each other right away
+        Worker* const worker = executor->workers + i;
+        unconst(worker->executor) = executor;
+        unconst(worker->deque) = workStealingDequeCreate(DEFAULT_ALLOCATOR, DEQUE_CAPACITY, nullptr);
+        worker->random = (unsigned) i + 1; // xorshift's state must be nonzero
+    }
+
+    for (int i = 0; i < executor->threads; i++) {
+        assert(!pthread_create(&executor->workers[i].thread, nullptr, workerLoop, executor->workers + i));
+        if (name) pthread_setname_np(executor->workers[i].thread, threadName);
+    }
+
+    return executor;
+}
+
+static void signalSubmission(Executor* const executor) {
+    atomic_thread_fence(memory_order_seq_cst); // the task is published before the sleepers are checked
+    atomic_fetch_add(&executor->signal, 1);
+    if (atomic_load_explicit(&executor->sleepers, memory_order_relaxed)) futexWake(&executor->signal, 1);
+}
+
+void executorSubmit(Executor* const executor, const ExecutorTaskFunction function, void* nullable const parameter) {
+    Task* const task = poolAllocatorAllocator(executor->tasksPool)->malloc(sizeof *task);
+    assignToStructWithConsts(task, function, parameter)
+
+    Worker* const worker = gCurrentWorker;
+    if (!worker || worker->executor != executor || !workStealingDequePush(worker->deque, task))
+        mpmcQueuePush(executor->injection, task);
+
+    signalSubmission(executor);
+}
+
+int executorThreads(Executor* const executor) {
+    return executor->threads;
+}
+
+wrapping static unsigned nextRandom(Worker* const worker) { // xorshift
+    unsigned random = worker->random;
+    random ^= random << 13;
+    random ^= random >> 17;
+    random ^= random << 5;
+    return worker->random = random;
+}
+
+static Task* nullable findTask(Worker* const worker) {
+    Executor* const executor = worker->executor;
+
+    Task* task;
+    if ((task = workStealingDequePop(worker->deque))) return task;
+    if ((task = mpmcQueuePop(executor->injection))) return task;
+
+    const int start = (int) (nextRandom(worker) % (unsigned) executor->threads);
+    for (int i = 0; i < executor->threads; i++) {
+        Worker* const victim = executor->workers + (start + i) % executor->threads;
+        if (victim != worker && (task = workStealingDequeSteal(victim->deque))) return task;
+    }
+
+    return nullptr;
+}
+
+static void runTask(Executor* const executor, Task* const task) {
+    task->function(task->parameter);
+    freeTask(task, executor);
+}
+
+static void* nullable workerLoop(void* const parameter) {
+    Worker* const worker = parameter;
+    Executor* const executor = worker->executor;
+    gCurrentWorker = worker;
+
+    while (executor->running) {
+        Task* task = findTask(worker);
+        if (task) {
+            runTask(executor, task);
+            continue;
+        }
+
+        const unsigned signal = executor->signal;
+        executor->sleepers++;
+        atomic_thread_fence(memory_order_seq_cst); // announced before the recheck
+
+        if ((task = findTask(worker)) || !executor->running) {
+            executor->sleepers--;
+            if (task) runTask(executor, task);
+            continue;
+        }
+
+        futexWait(&executor->signal, signal, FUTEX_WAIT_FOREVER);
+        executor->sleepers--;
+    }
+
+    gCurrentWorker = nullptr;
+    return nullptr;
+}
+
+void executorDestroy(Executor* const executor) {
+    assert(gCurrentWorker == nullptr || gCurrentWorker->executor != executor); // a worker can't wait for itself
+
+    executor->running = false;
+    atomic_fetch_add(&executor->signal, 1);
+    futexWake(&executor->signal, FUTEX_WAKE_ALL);
+
+    for (int i = 0; i < executor->threads; i++)
+        assert(!pthread_join(executor->workers[i].thread, nullptr));
+
+    Task* task;
+    for (int i = 0; i < executor->threads; i++) {
+        while ((task = workStealingDequePop(executor->workers[i].deque))) freeTask(task, executor);
+        workStealingDequeDestroy(executor->workers[i].deque);
+    }
+    while ((task = mpmcQueuePop(executor->injection))) freeTask(task, executor);
+    mpmcQueueDestroy(executor->injection);
+
+    poolAllocatorDestroy(executor->tasksPool);
+    xfree(executor->workers);
+    xfree(executor);
+}
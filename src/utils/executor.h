@@ -0,0 +1,17 @@
+
+#pragma once
+
+#include "../defs.h"
+
+// Work-stealing thread pool - each worker owns a deque of tasks, tasks submitted from a worker go to its own deque, others go to a shared
+// injection queue; idle workers take from their deque first, then from the injection queue, then steal from the other workers,
+// and sleep (on a futex) when there's nothing anywhere; tasks run in no particular order
+
+typedef struct _Executor Executor;
+
+typedef void (* ExecutorTaskFunction)(void* nullable const parameter);
+
+Executor* executorCreate(const int threads, const char* nullable const name); // zero threads means one per online cpu core; the name (truncated to 15 characters) is given to the worker threads
+void executorSubmit(Executor* const executor, const ExecutorTaskFunction function, void* nullable const parameter); // thread-safe, never blocks unless the injection queue is full
+int executorThreads(Executor* const executor);
+void executorDestroy(Executor* const executor); // waits for the running tasks to finish, drops the queued ones without running them
@@ -0,0 +1,38 @@
+
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "futex.h"
+
+bool futexWait(atomic unsigned* const word, const unsigned expected, const int timeoutMillis) {
+    const struct timespec timeout = {timeoutMillis / 1000, timeoutMillis % 1000 * 1'000'000l}; // relative for FUTEX_WAIT
+    if (syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, expected, timeoutMillis == FUTEX_WAIT_FOREVER ? nullptr : &timeout, nullptr, 0) == 0) return true;
+
+    assert(errno == EAGAIN || errno == EINTR || errno == ETIMEDOUT);
+    return errno != ETIMEDOUT;
+}
+
+bool futexWaitUntil(atomic unsigned* const word, const unsigned expected, const long deadline) {
+    const struct timespec timeout = {deadline / 1'000'000'000l, deadline % 1'000'000'000l}; // absolute for FUTEX_WAIT_BITSET, measured by the monotonic clock
+    if (syscall(SYS_futex, word, FUTEX_WAIT_BITSET_PRIVATE, expected, deadline == FUTEX_WAIT_FOREVER ? nullptr : &timeout, nullptr, FUTEX_BITSET_MATCH_ANY) == 0) return true;
+
+    assert(errno == EAGAIN || errno == EINTR || errno == ETIMEDOUT);
+    return errno != ETIMEDOUT;
+}
+
+long futexDeadline(const int timeoutMillis) {
+    if (timeoutMillis == FUTEX_WAIT_FOREVER) return FUTEX_WAIT_FOREVER;
+    assert(timeoutMillis >= 0);
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1'000'000'000l + now.tv_nsec + timeoutMillis * 1'000'000l;
+}
+
+int futexWake(atomic unsigned* const word, const int count) {
+    const long woken = syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+    assert(woken >= 0);
+    return (int) woken;
+}
@@ -0,0 +1,18 @@
+
+#pragma once
+
+#include "../defs.h"
+
+// Thin wrapper over linux's futex - the kernel side of a wait queue keyed by the address of a 32-bit word, the waiter sleeps only
+// if the word still holds the expected value (checked atomically by the kernel), so there's no lost wake up between the check and the sleep;
+// process private - the word must not be shared with other processes
+
+enum : int {
+    FUTEX_WAIT_FOREVER = -1,
+    FUTEX_WAKE_ALL = 0x7fffffff
+};
+
+bool futexWait(atomic unsigned* const word, const unsigned expected, const int timeoutMillis); // returns false on timeout only, true when woken, interrupted or the word differs from the expected - the caller must recheck its condition anyway
+bool futexWaitUntil(atomic unsigned* const word, const unsigned expected, const long deadline); // the same with an absolute deadline (see futexDeadline), so repeated waits (after spurious wake ups) don't stretch the timeout
+long futexDeadline(const int timeoutMillis); // monotonic clock nanoseconds, FUTEX_WAIT_FOREVER stays as is
+int futexWake(atomic unsigned* const word, const int count); // returns amount of woken threads
@@ -0,0 +1,230 @@
+
+#include <stdatomic.h>
+#include "rwMutex.h"
+#include "poolAllocator.h"
+
+// free objects store the pointer to the next free object in their own first bytes, the newest page is carved lazily so creating a pool is cheap;
+// thread caches live in a fixed thread-local table, a pool owns one of its slots exclusively (across all threads) while it's alive,
+// so a thread finding a foreign pool id in the pool's slot can be sure the previous owner is destroyed and just drop the stale list
+
+enum : int {
+    ALIGNMENT = 16, // the same as malloc's
+    CACHE_SLOTS = 16, // amount of thread-cached pools that can exist simultaneously, others run uncached
+    CACHE_BATCH = 32 // objects moved between a thread cache and the pool at once
+};
+
+typedef struct _FreeObject {
+    struct _FreeObject* nullable next;
+} FreeObject;
+
+typedef struct _Page {
+    struct _Page* nullable next;
+} Page; // objects follow the header at the offset of ALIGNMENT
+
+typedef struct {
+    unsigned long poolId;
+    FreeObject* nullable head;
+    int count;
+} ThreadCache;
+
+struct _PoolAllocator {
+    Allocator allocator;
+    const unsigned long id;
+    const int objectSize, objectsPerPage, cacheSlot; // cacheSlot is -1 if the pool is not thread cached
+    RWMutex* nullable const rwMutex;
+    Page* nullable pages;
+    byte* nullable bump, * nullable bumpEnd; // the not yet carved rest of the newest page
+    FreeObject* nullable freeList;
+#ifdef DEBUG
+    atomic int liveObjects;
+#endif
+};
+
+staticAssert(sizeof(Page) <= ALIGNMENT && sizeof(FreeObject) <= ALIGNMENT);
+
+static thread_local ThreadCache gThreadCaches[CACHE_SLOTS] = {};
+static atomic unsigned long gCacheSlotOwners[CACHE_SLOTS] = {}; // pool ids, zero means free
+static atomic unsigned long gPoolIds = 0;
+
+static void* poolMalloc(PoolAllocator* const pool, const unsigned long size);
+static void poolFree(PoolAllocator* const pool, void* nullable const object);
+
+static int acquireCacheSlot(const unsigned long poolId) {
+    for (int i = 0; i < CACHE_SLOTS; i++) {
+        unsigned long expected = 0;
+        if (atomic_compare_exchange_strong(gCacheSlotOwners + i, &expected, poolId)) return i;
+    }
+    return -1;
+}
+
+PoolAllocator* poolAllocatorCreate(const int objectSize, const int objectsPerPage, const bool synchronized, const bool threadCached) {
+    assert(objectSize > 0 && objectsPerPage > 0 && (synchronized || !threadCached));
+
+    PoolAllocator* const pool = xmalloc(sizeof *pool);
+    unconst(pool->id) = ++gPoolIds;
+    unconst(pool->objectSize) = (objectSize + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    unconst(pool->objectsPerPage) = objectsPerPage;
+    unconst(pool->cacheSlot) = threadCached ? acquireCacheSlot(pool->id) : -1;
+    unconst(pool->rwMutex) = synchronized ? rwMutexCreate(RW_MUTEX_FLAG_NONE) : nullptr;
+    pool->pages = nullptr;
+    pool->bump = pool->bumpEnd = nullptr;
+    pool->freeList = nullptr;
+#ifdef DEBUG
+    pool->liveObjects = 0;
+#endif
+
+    pool->allocator = (Allocator) {
+        Block_copy(^ void* (const unsigned long size) {
+            return poolMalloc(pool, size);
+        }),
+        Block_copy(^ void* (const unsigned long elements, const unsigned long size) {
+            assert(!size || elements <= (unsigned long) pool->objectSize / size); // the product could wrap around and pass the check below
+            return xmemset(poolMalloc(pool, elements * size), 0, elements * size);
+        }),
+        Block_copy(^ void* (void* nullable const object, const unsigned long size) {
+            if (!object) return poolMalloc(pool, size);
+            if (!size) {
+                poolFree(pool, object);
+                return nullptr;
+            }
+            assert(size <= (unsigned long) pool->objectSize); // objects are of the same size so they can be resized in place only
+            return object;
+        }),
+        Block_copy(^ (void* nullable const object) {
+            poolFree(pool, object);
+        })
+    };
+
+    return pool;
+}
+
+const Allocator* poolAllocatorAllocator(PoolAllocator* const pool) {
+    return &pool->allocator;
+}
+
+static inline void xRwMutexCommand(PoolAllocator* const pool, const RWMutexCommand command) {
+    if (pool->rwMutex) rwMutexCommand(pool->rwMutex, command);
+}
+
+static void addPage(PoolAllocator* const pool) {
+    Page* const page = xmalloc(ALIGNMENT + (unsigned long) pool->objectSize * (unsigned long) pool->objectsPerPage);
+    page->next = pool->pages;
+    pool->pages = page;
+
+    pool->bump = (byte*) page + ALIGNMENT;
+    pool->bumpEnd = pool->bump + (unsigned long) pool->objectSize * (unsigned long) pool->objectsPerPage;
+}
+
+static void* takeShared(PoolAllocator* const pool) { // mutex must be locked
+    if (pool->freeList) {
+        FreeObject* const object = pool->freeList;
+        pool->freeList = object->next;
+        return object;
+    }
+
+    if (pool->bump == pool->bumpEnd) addPage(pool);
+
+    void* const object = pool->bump;
+    pool->bump += pool->objectSize;
+    return object;
+}
+
+static ThreadCache* nullable threadCache(const PoolAllocator* const pool) {
+    if (pool->cacheSlot < 0) return nullptr;
+
+    ThreadCache* const cache = gThreadCaches + pool->cacheSlot;
+    if (cache->poolId != pool->id) { // leftovers of a destroyed pool, their memory has gone with its pages
+        cache->poolId = pool->id;
+        cache->head = nullptr;
+        cache->count = 0;
+    }
+
+    return cache;
+}
+
+static void* poolMalloc(PoolAllocator* const pool, const unsigned long size) {
+    assert(size <= (unsigned long) pool->objectSize); // serves a single size class only, see the Allocator
+#ifdef DEBUG
+    pool->liveObjects++;
+#endif
+
+    ThreadCache* const cache = threadCache(pool);
+    if (!cache) {
+        xRwMutexCommand(pool, RW_MUTEX_COMMAND_WRITE_LOCK);
+        void* const object = takeShared(pool);
+        xRwMutexCommand(pool, RW_MUTEX_COMMAND_WRITE_UNLOCK);
+        return object;
+    }
+
+    if (!cache->head) { // refill
+        xRwMutexCommand(pool, RW_MUTEX_COMMAND_WRITE_LOCK);
+        for (; cache->count < CACHE_BATCH; cache->count++) {
+            FreeObject* const object = takeShared(pool);
+            object->next = cache->head;
+            cache->head = object;
+        }
+        xRwMutexCommand(pool, RW_MUTEX_COMMAND_WRITE_UNLOCK);
+    }
+
+    FreeObject* const object = cache->head;
+    cache->head = object->next;
+    cache->count--;
+    return object;
+}
+
+static void poolFree(PoolAllocator* const pool, void* nullable const object) {
+    if (!object) return;
+#ifdef DEBUG
+    assert(pool->liveObjects > 0);
+    pool->liveObjects--;
+#endif
+
+    FreeObject* const freeObject = object;
+    ThreadCache* const cache = threadCache(pool);
+
+    if (!cache) {
+        xRwMutexCommand(pool, RW_MUTEX_COMMAND_WRITE_LOCK);
+        freeObject->next = pool->freeList;
+        pool->freeList = freeObject;
+        xRwMutexCommand(pool, RW_MUTEX_COMMAND_WRITE_UNLOCK);
+        return;
+    }
+
+    freeObject->next = cache->head;
+    cache->head = freeObject;
+    if (++cache->count < CACHE_BATCH * 2) return;
+
+    xRwMutexCommand(pool, RW_MUTEX_COMMAND_WRITE_LOCK); // flush a batch back so objects freed by one thread can be reused by others
+    for (; cache->count > CACHE_BATCH; cache->count--) {
+        FreeObject* const next = cache->head->next;
+        cache->head->next = pool->freeList;
+        pool->freeList = cache->head;
+        cache->head = next;
+    }
+    xRwMutexCommand(pool, RW_MUTEX_COMMAND_WRITE_UNLOCK);
+}
+
+void poolAllocatorDestroy(PoolAllocator* const pool) {
+#ifdef DEBUG
+    assert(!pool->liveObjects);
+#endif
+
+    if (pool->cacheSlot >= 0) {
+        ThreadCache* const cache = gThreadCaches + pool->cacheSlot;
+        if (cache->poolId == pool->id) cache->head = nullptr, cache->count = 0;
+        gCacheSlotOwners[pool->cacheSlot] = 0;
+    }
+
+    for (Page* page = pool->pages, * next; page; page = next) {
+        next = page->next;
+        xfree(page);
+    }
+
+    Block_release(pool->allocator.malloc);
+    Block_release(pool->allocator.calloc);
+    Block_release(pool->allocator.realloc);
+    Block_release(pool->allocator.free);
+
+    if (pool->rwMutex) rwMutexDestroy(pool->rwMutex);
+    xfree(pool);
+}
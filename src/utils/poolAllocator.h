@@ -0,0 +1,14 @@
+
+#pragma once
+
+#include "../defs.h"
+
+// Fixed-size object (slab) allocator - objects are carved out of large pages and recycled through an intrusive free list,
+// allocation and deallocation are constant time and never touch malloc once the pages are there, neighbouring objects share cache lines;
+// optionally thread-safe, optionally with per-thread caches of free objects so the threads rarely contend on the pool's mutex
+
+typedef struct _PoolAllocator PoolAllocator;
+
+PoolAllocator* poolAllocatorCreate(const int objectSize, const int objectsPerPage, const bool synchronized, const bool threadCached); // threadCached requires synchronized
+const Allocator* poolAllocatorAllocator(PoolAllocator* const pool); // interface for containers (as their internalAllocator), valid until the pool is destroyed; requests larger than the objectSize assert, so it must cover everything the container allocates, including the container itself
+void poolAllocatorDestroy(PoolAllocator* const pool); // all objects must be freed by then, releases the pages
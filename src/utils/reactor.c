@@ -0,0 +1,163 @@
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include "../collections/hashtable.h"
+#include "rwMutex.h"
+#include "reactor.h"
+
+// epoll's events carry the descriptor along with the generation of its watch, so the events of a watch that has been replaced
+// or removed after epoll_wait returned (e.g. by an earlier callback of the same batch) are recognized and dropped;
+// the watches are looked up under the lock and their callbacks are invoked outside of it, so callbacks can (un)watch freely
+
+enum : int {
+    MAX_EVENTS = 64 // per epoll_wait
+};
+
+typedef struct {
+    const ReactorCallback callback;
+    void* nullable const parameter;
+    const unsigned generation;
+    const bool oneShot;
+} Watch;
+
+struct _Reactor {
+    const int epoll, wakeUp; // the eventfd is watched internally, for stopping
+    RWMutex* const rwMutex;
+    Hashtable* const watches; // <file descriptor, Watch*>
+    unsigned lastGeneration;
+    atomic bool stopped;
+};
+
+static const unsigned long WAKE_UP_DATA = ~0ul; // no watch has such a generation and descriptor
+
+static inline unsigned long packData(const int fileDescriptor, const unsigned generation) {
+    return (unsigned long) generation << 32 | (unsigned) fileDescriptor;
+}
+
+static unsigned toEpoll(const int events) {
+    return (events & REACTOR_EVENT_READABLE ? EPOLLIN | EPOLLRDHUP : 0u) | (events & REACTOR_EVENT_WRITABLE ? EPOLLOUT : 0u);
+}
+
+static int fromEpoll(const unsigned events) {
+    return (events & EPOLLIN ? REACTOR_EVENT_READABLE : 0) | (events & EPOLLOUT ? REACTOR_EVENT_WRITABLE : 0) |
+        (events & (EPOLLHUP | EPOLLRDHUP | EPOLLERR) ? REACTOR_EVENT_CLOSED : 0);
+}
+
+Reactor* reactorCreate(void) {
+    Reactor* const reactor = xmalloc(sizeof *reactor);
+    assert((unconst(reactor->epoll) = epoll_create1(EPOLL_CLOEXEC)) >= 0);
+    assert((unconst(reactor->wakeUp) = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) >= 0);
+    unconst(reactor->rwMutex) = rwMutexCreate(RW_MUTEX_FLAG_NONE);
+    unconst(reactor->watches) = hashtableCreate(DEFAULT_ALLOCATOR, xfree);
+    reactor->lastGeneration = 0;
+    reactor->stopped = false;
+
+    assert(!epoll_ctl(reactor->epoll, EPOLL_CTL_ADD, reactor->wakeUp, &(struct epoll_event) {.events = EPOLLIN, .data.u64 = WAKE_UP_DATA}));
+    return reactor;
+}
+
+void reactorWatch(Reactor* const reactor, const int fileDescriptor, const int events, const ReactorCallback callback, void* nullable const parameter) {
+    assert(fileDescriptor >= 0 && fileDescriptor != reactor->wakeUp);
+
+    Watch* const watch = xmalloc(sizeof *watch);
+
+    rwMutexWriteLock(reactor->rwMutex);
+
+    assignToStructWithConsts(watch, callback, parameter, ++reactor->lastGeneration, events & REACTOR_EVENT_ONE_SHOT)
+    struct epoll_event event = {.events = toEpoll(events) | (watch->oneShot ? EPOLLONESHOT : 0u), .data.u64 = packData(fileDescriptor, watch->generation)};
+
+    const bool replacing = hashtableGet(reactor->watches, (unsigned long) fileDescriptor);
+    if (replacing) hashtableRemove(reactor->watches, (unsigned long) fileDescriptor, true);
+    hashtablePut(reactor->watches, (unsigned long) fileDescriptor, watch);
+
+    if (!replacing || epoll_ctl(reactor->epoll, EPOLL_CTL_MOD, fileDescriptor, &event)) // epoll forgets the descriptors that have been closed without unwatching, the number might have been reused since
+        assert(!epoll_ctl(reactor->epoll, EPOLL_CTL_ADD, fileDescriptor, &event));
+
+    rwMutexWriteUnlock(reactor->rwMutex);
+}
+
+static bool unwatch(Reactor* const reactor, const int fileDescriptor) { // under the lock
+    if (!hashtableGet(reactor->watches, (unsigned long) fileDescriptor)) return false;
+    hashtableRemove(reactor->watches, (unsigned long) fileDescriptor, true);
+    epoll_ctl(reactor->epoll, EPOLL_CTL_DEL, fileDescriptor, nullptr); // fails only if the descriptor has been closed already, epoll has forgotten it then
+    return true;
+}
+
+bool reactorUnwatch(Reactor* const reactor, const int fileDescriptor) {
+    rwMutexWriteLock(reactor->rwMutex);
+    const bool watched = unwatch(reactor, fileDescriptor);
+    rwMutexWriteUnlock(reactor->rwMutex);
+    return watched;
+}
+
+int reactorWatched(Reactor* const reactor) {
+    rwMutexReadLock(reactor->rwMutex);
+    const int count = hashtableCount(reactor->watches);
+    rwMutexReadUnlock(reactor->rwMutex);
+    return count;
+}
+
+static bool takeCallback(Reactor* const reactor, const unsigned long data, ReactorCallback* const callback, void* nullable* const parameter) { // returns false if the event is stale
+    const int fileDescriptor = (int) (unsigned) data;
+    bool valid = false;
+
+    rwMutexWriteLock(reactor->rwMutex); // a write lock as one-shot watches are removed here
+    const Watch* const watch = hashtableGet(reactor->watches, (unsigned long) fileDescriptor);
+
+    if (watch && watch->generation == (unsigned) (data >> 32)) {
+        valid = true;
+        *callback = watch->callback;
+        *parameter = watch->parameter;
+        if (watch->oneShot) unwatch(reactor, fileDescriptor);
+    }
+
+    rwMutexWriteUnlock(reactor->rwMutex);
+    return valid;
+}
+
+int reactorRunOnce(Reactor* const reactor, const int timeoutMillis) {
+    struct epoll_event events[MAX_EVENTS];
+
+    int count;
+    while ((count = epoll_wait(reactor->epoll, events, MAX_EVENTS, timeoutMillis)) < 0)
+        assert(errno == EINTR); // interrupted by a signal, anything else is a bug
+
+    int dispatched = 0;
+    for (int i = 0; i < count; i++) {
+        if (events[i].data.u64 == WAKE_UP_DATA) {
+            unsigned long value;
+            USED(read(reactor->wakeUp, &value, sizeof value)); // resets the counter
+            continue;
+        }
+
+        ReactorCallback callback;
+        void* nullable parameter;
+        if (!takeCallback(reactor, events[i].data.u64, &callback, &parameter)) continue;
+
+        callback((int) (unsigned) events[i].data.u64, fromEpoll(events[i].events), parameter);
+        dispatched++;
+    }
+
+    return dispatched;
+}
+
+void reactorRun(Reactor* const reactor) {
+    while (!reactor->stopped)
+        reactorRunOnce(reactor, -1);
+}
+
+void reactorStop(Reactor* const reactor) {
+    reactor->stopped = true;
+    assert(write(reactor->wakeUp, &(unsigned long) {1}, sizeof(unsigned long)) == sizeof(unsigned long));
+}
+
+void reactorDestroy(Reactor* const reactor) {
+    hashtableDestroy(reactor->watches);
+    rwMutexDestroy(reactor->rwMutex);
+    close(reactor->wakeUp);
+    close(reactor->epoll);
+    xfree(reactor);
+}
@@ -0,0 +1,28 @@
+
+#pragma once
+
+#include "../defs.h"
+
+// Readiness-based i/o event loop (epoll) - file descriptors (sockets, pipes, eventfds, timerfds) are watched for being readable or writable,
+// the loop sleeps in the kernel until any of them is ready and then dispatches their callbacks right away on its own thread,
+// so neither polling periods nor a thread per descriptor are needed; level-triggered - a callback fires again while the descriptor stays ready
+
+typedef struct _Reactor Reactor;
+
+typedef enum : int {
+    REACTOR_EVENT_READABLE = 1 << 0,
+    REACTOR_EVENT_WRITABLE = 1 << 1,
+    REACTOR_EVENT_CLOSED = 1 << 2, // hang up or error, reported regardless of whether it's been asked for
+    REACTOR_EVENT_ONE_SHOT = 1 << 3 // not an event - the watch gets removed before its callback is invoked, the callback can add it again
+} ReactorEvent;
+
+typedef void (* ReactorCallback)(const int fileDescriptor, const int events, void* nullable const parameter);
+
+Reactor* reactorCreate(void);
+void reactorWatch(Reactor* const reactor, const int fileDescriptor, const int events, const ReactorCallback callback, void* nullable const parameter); // thread-safe, replaces the descriptor's previous watch if there's one
+bool reactorUnwatch(Reactor* const reactor, const int fileDescriptor); // thread-safe, returns whether it's been watched; unwatch before closing the descriptor; when called from another thread, a callback that has already been picked up might still run once
+int reactorWatched(Reactor* const reactor); // amount of watched descriptors
+int reactorRunOnce(Reactor* const reactor, const int timeoutMillis); // waits (negative timeout means indefinitely) for ready descriptors and dispatches them, returns the amount of dispatched callbacks
+void reactorRun(Reactor* const reactor); // dispatches until stopped, meant for a thread of its own
+void reactorStop(Reactor* const reactor); // thread-safe, wakes the loop up, makes reactorRun return (or not even start looping)
+void reactorDestroy(Reactor* const reactor); // the loop mustn't be running, the descriptors aren't closed
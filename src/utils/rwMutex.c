@@ -1,46 +1,291 @@
 
-// TODO: rollback to previous implementation for a recursive rw lock
-// TODO: check Java's ReentrantRecursiveReadWriteLock
-
-#include <SDL3/SDL_mutex.h>
+#include <stdatomic.h>
+#include <time.h>
+#include "futex.h"
 #include "rwMutex.h"
 
+// the state word holds the amount of readers in its low 30 bits (or all of them set while write locked) and two flags telling whether there are
+// sleeping readers or writers; readers sleep on the state word itself, writers on a separate notification counter, so unlocking can wake
+// either a single writer or all the readers; new readers don't get in while a writer waits (the scheme of rust's std futex rwlock)
+
+enum : unsigned {
+    READ_LOCKED = 1,
+    MASK = (1u << 30) - 1,
+    WRITE_LOCKED = MASK,
+    MAX_READERS = MASK - 1,
+    READERS_WAITING = 1u << 30,
+    WRITERS_WAITING = 1u << 31
+};
+
+enum : int {
+    SPINS = 100, // before falling asleep, locks are usually held for a short time
+    HELD_READS = 16 // amount of distinct recursive mutexes a thread can hold for reading at once
+};
+
 struct _RWMutex {
-    SDL_RWLock* const lock;
-    atomic int readers;
-    atomic int writers;
+    atomic unsigned state;
+    atomic unsigned writerNotify; // bumped on each writer wake up
+    const int flags;
+    atomic unsigned long owner; // recursive only: the thread holding the write lock, zero if none
+    int ownerDepth; // recursive only: amount of locks (either read or write) held by the owner, touched by the owner only
+    atomic unsigned sequence; // optimistic reads only: odd while write locked
+    struct {
+        atomic unsigned long readAcquisitions, writeAcquisitions, contendedReads, contendedWrites, waitNanos;
+    } statistics;
 };
 
-RWMutex* rwMutexCreate(void) {
+typedef struct {
+    const RWMutex* nullable rwMutex;
+    int depth;
+} HeldRead;
+
+static thread_local HeldRead gHeldReads[HELD_READS] = {};
+static thread_local byte gThreadMarker = 0; // its address identifies the thread
+
+RWMutex* rwMutexCreate(const int flags) {
     RWMutex* const rwMutex = xmalloc(sizeof *rwMutex);
-    assert(unconst(rwMutex->lock) = SDL_CreateRWLock());
-    rwMutex->readers = 0;
-    rwMutex->writers = 0;
+    rwMutex->state = 0;
+    rwMutex->writerNotify = 0;
+    unconst(rwMutex->flags) = flags;
+    rwMutex->owner = 0;
+    rwMutex->ownerDepth = 0;
+    rwMutex->sequence = 0;
+    xmemset(&rwMutex->statistics, 0, sizeof rwMutex->statistics);
     return rwMutex;
 }
 
+static inline bool unlocked(const unsigned state) {
+    return !(state & MASK);
+}
+
+static inline bool writeLocked(const unsigned state) {
+    return (state & MASK) == WRITE_LOCKED;
+}
+
+static inline bool readLockable(const unsigned state) {
+    return (state & MASK) < MAX_READERS && !(state & (READERS_WAITING | WRITERS_WAITING));
+}
+
+static long nanoTime(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1'000'000'000l + time.tv_nsec;
+}
+
+static unsigned spinRead(RWMutex* const rwMutex) { // until it isn't write locked or someone sleeps already (there's no point in spinning then)
+    for (int i = 0; ; i++) {
+        const unsigned state = atomic_load_explicit(&rwMutex->state, memory_order_relaxed);
+        if (!writeLocked(state) || state & (READERS_WAITING | WRITERS_WAITING) || i == SPINS) return state;
+        __builtin_ia32_pause();
+    }
+}
+
+static unsigned spinWrite(RWMutex* const rwMutex) {
+    for (int i = 0; ; i++) {
+        const unsigned state = atomic_load_explicit(&rwMutex->state, memory_order_relaxed);
+        if (unlocked(state) || state & WRITERS_WAITING || i == SPINS) return state;
+        __builtin_ia32_pause();
+    }
+}
+
+static void readContended(RWMutex* const rwMutex) {
+    unsigned state = spinRead(rwMutex);
+
+    while (true) {
+        if (readLockable(state)) {
+            if (atomic_compare_exchange_weak_explicit(&rwMutex->state, &state, state + READ_LOCKED, memory_order_acquire, memory_order_relaxed)) return;
+            continue;
+        }
+
+        assert((state & MASK) != MAX_READERS);
+
+        if (!(state & READERS_WAITING) && !atomic_compare_exchange_strong_explicit(&rwMutex->state, &state, state | READERS_WAITING, memory_order_relaxed, memory_order_relaxed))
+            continue;
+
+        futexWait(&rwMutex->state, state | READERS_WAITING, FUTEX_WAIT_FOREVER);
+        state = spinRead(rwMutex);
+    }
+}
+
+static void writeContended(RWMutex* const rwMutex) {
+    unsigned state = spinWrite(rwMutex), otherWritersWaiting = 0;
+
+    while (true) {
+        if (unlocked(state)) {
+            if (atomic_compare_exchange_weak_explicit(&rwMutex->state, &state, state | WRITE_LOCKED | otherWritersWaiting, memory_order_acquire, memory_order_relaxed)) return;
+            continue;
+        }
+
+        if (!(state & WRITERS_WAITING) && !atomic_compare_exchange_strong_explicit(&rwMutex->state, &state, state | WRITERS_WAITING, memory_order_relaxed, memory_order_relaxed))
+            continue;
+
+        otherWritersWaiting = WRITERS_WAITING; // once slept, it's unknown whether other writers still sleep, so the flag is kept on acquiring
+
+        const unsigned notification = atomic_load_explicit(&rwMutex->writerNotify, memory_order_acquire);
+        state = atomic_load_explicit(&rwMutex->state, memory_order_relaxed);
+        if (unlocked(state) || !(state & WRITERS_WAITING)) continue; // unlocked in between, the notification could have been missed
+
+        futexWait(&rwMutex->writerNotify, notification, FUTEX_WAIT_FOREVER);
+        state = spinWrite(rwMutex);
+    }
+}
+
+static void acquire(RWMutex* const rwMutex, const bool readOrWrite) {
+    unsigned state = readOrWrite ? atomic_load_explicit(&rwMutex->state, memory_order_relaxed) : 0;
+    const bool acquired = (!readOrWrite || readLockable(state)) &&
+        atomic_compare_exchange_strong_explicit(&rwMutex->state, &state, readOrWrite ? state + READ_LOCKED : WRITE_LOCKED, memory_order_acquire, memory_order_relaxed);
+
+    const bool statistics = rwMutex->flags & RW_MUTEX_FLAG_STATISTICS;
+    if (statistics) atomic_fetch_add_explicit(readOrWrite ? &rwMutex->statistics.readAcquisitions : &rwMutex->statistics.writeAcquisitions, 1, memory_order_relaxed);
+    if (acquired) return;
+
+    const long start = statistics ? nanoTime() : 0;
+    readOrWrite ? readContended(rwMutex) : writeContended(rwMutex);
+    if (!statistics) return;
+
+    atomic_fetch_add_explicit(readOrWrite ? &rwMutex->statistics.contendedReads : &rwMutex->statistics.contendedWrites, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&rwMutex->statistics.waitNanos, (unsigned long) (nanoTime() - start), memory_order_relaxed);
+}
+
+wrapping static void bumpSequence(RWMutex* const rwMutex, const bool beginOrEnd) { // called by the write lock holder only, so no read-modify-write is needed
+    if (!(rwMutex->flags & RW_MUTEX_FLAG_OPTIMISTIC_READS)) return;
+
+    const unsigned sequence = atomic_load_explicit(&rwMutex->sequence, memory_order_relaxed) + 1;
+    if (beginOrEnd) {
+        atomic_store_explicit(&rwMutex->sequence, sequence, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release); // the odd version becomes visible before any of the writes
+    } else
+        atomic_store_explicit(&rwMutex->sequence, sequence, memory_order_release);
+}
+
+static bool wakeWriter(RWMutex* const rwMutex) {
+    atomic_fetch_add_explicit(&rwMutex->writerNotify, 1, memory_order_release);
+    return futexWake(&rwMutex->writerNotify, 1) > 0;
+}
+
+static void wakeWriterOrReaders(RWMutex* const rwMutex, unsigned state) { // the state must be unlocked, writers go first
+    if (state == WRITERS_WAITING) {
+        if (atomic_compare_exchange_strong_explicit(&rwMutex->state, &state, 0, memory_order_relaxed, memory_order_relaxed)) {
+            wakeWriter(rwMutex);
+            return;
+        }
+    }
+
+    if (state == (READERS_WAITING | WRITERS_WAITING)) {
+        if (!atomic_compare_exchange_strong_explicit(&rwMutex->state, &state, READERS_WAITING, memory_order_relaxed, memory_order_relaxed)) return;
+        if (wakeWriter(rwMutex)) return;
+        state = READERS_WAITING; // no writer was actually sleeping, so wake the readers instead
+    }
+
+    if (state == READERS_WAITING && atomic_compare_exchange_strong_explicit(&rwMutex->state, &state, 0, memory_order_relaxed, memory_order_relaxed))
+        futexWake(&rwMutex->state, FUTEX_WAKE_ALL);
+}
+
+static void releaseRead(RWMutex* const rwMutex) {
+    const unsigned previous = atomic_fetch_sub_explicit(&rwMutex->state, READ_LOCKED, memory_order_release);
+    assert(!unlocked(previous) && !writeLocked(previous));
+
+    const unsigned state = previous - READ_LOCKED;
+    if (unlocked(state) && state & WRITERS_WAITING) wakeWriterOrReaders(rwMutex, state);
+}
+
+static void releaseWrite(RWMutex* const rwMutex) {
+    bumpSequence(rwMutex, false);
+
+    const unsigned previous = atomic_fetch_sub_explicit(&rwMutex->state, WRITE_LOCKED, memory_order_release);
+    assert(writeLocked(previous));
+
+    const unsigned state = previous - WRITE_LOCKED;
+    if (state & (READERS_WAITING | WRITERS_WAITING)) wakeWriterOrReaders(rwMutex, state);
+}
+
+static inline bool recursive(const RWMutex* const rwMutex) {
+    return rwMutex->flags & RW_MUTEX_FLAG_RECURSIVE;
+}
+
+static inline bool ownedByThisThread(RWMutex* const rwMutex) {
+    return atomic_load_explicit(&rwMutex->owner, memory_order_relaxed) == (unsigned long) &gThreadMarker;
+}
+
+static HeldRead* nullable heldRead(const RWMutex* nullable const rwMutex) { // null finds a free entry
+    for (int i = 0; i < HELD_READS; i++)
+        if (gHeldReads[i].rwMutex == rwMutex) return gHeldReads + i;
+    return nullptr;
+}
+
 void rwMutexReadLock(RWMutex* const rwMutex) {
-    SDL_LockRWLockForReading(rwMutex->lock);
-    rwMutex->readers++;
+    if (!recursive(rwMutex)) {
+        acquire(rwMutex, true);
+        return;
+    }
+
+    if (ownedByThisThread(rwMutex)) { // reading under its own write lock
+        rwMutex->ownerDepth++;
+        return;
+    }
+
+    HeldRead* held = heldRead(rwMutex);
+    if (!held) {
+        acquire(rwMutex, true);
+        assert(held = heldRead(nullptr));
+        held->rwMutex = rwMutex;
+    }
+    held->depth++;
 }
 
 void rwMutexReadUnlock(RWMutex* const rwMutex) {
-    assert(rwMutex->readers-- > 0);
-    SDL_UnlockRWLock(rwMutex->lock);
+    if (!recursive(rwMutex)) {
+        releaseRead(rwMutex);
+        return;
+    }
+
+    if (ownedByThisThread(rwMutex)) {
+        rwMutexWriteUnlock(rwMutex);
+        return;
+    }
+
+    HeldRead* const held = heldRead(rwMutex);
+    assert(held);
+    if (--held->depth) return;
+
+    held->rwMutex = nullptr;
+    releaseRead(rwMutex);
 }
 
 void rwMutexWriteLock(RWMutex* const rwMutex) {
-    SDL_LockRWLockForWriting(rwMutex->lock);
-    rwMutex->writers++;
+    if (!recursive(rwMutex)) {
+        acquire(rwMutex, false);
+        bumpSequence(rwMutex, true);
+        return;
+    }
+
+    if (ownedByThisThread(rwMutex)) {
+        rwMutex->ownerDepth++;
+        return;
+    }
+
+    assert(!heldRead(rwMutex)); // upgrading would wait for itself
+    acquire(rwMutex, false);
+    bumpSequence(rwMutex, true);
+    atomic_store_explicit(&rwMutex->owner, (unsigned long) &gThreadMarker, memory_order_relaxed);
+    rwMutex->ownerDepth = 1;
 }
 
 void rwMutexWriteUnlock(RWMutex* const rwMutex) {
-    assert(rwMutex->writers-- > 0);
-    SDL_UnlockRWLock(rwMutex->lock);
+    if (!recursive(rwMutex)) {
+        releaseWrite(rwMutex);
+        return;
+    }
+
+    assert(ownedByThisThread(rwMutex) && rwMutex->ownerDepth > 0);
+    if (--rwMutex->ownerDepth) return;
+
+    atomic_store_explicit(&rwMutex->owner, 0, memory_order_relaxed);
+    releaseWrite(rwMutex);
 }
 
 bool rwMutexLocked(RWMutex* const rwMutex) {
-    return rwMutex->readers > 0 || rwMutex->writers > 0;
+    return !unlocked(atomic_load_explicit(&rwMutex->state, memory_order_relaxed));
 }
 
 void rwMutexCommand(RWMutex* const rwMutex, const RWMutexCommand command) {
@@ -52,11 +297,33 @@ void rwMutexCommand(RWMutex* const rwMutex, const RWMutexCommand command) {
     }
 }
 
+unsigned rwMutexOptimisticReadBegin(RWMutex* const rwMutex) {
+    assert(rwMutex->flags & RW_MUTEX_FLAG_OPTIMISTIC_READS);
+
+    for (int spins = 0; ; spins < SPINS ? spins++, __builtin_ia32_pause() : xyield()) {
+        const unsigned version = atomic_load_explicit(&rwMutex->sequence, memory_order_acquire);
+        if (!(version & 1) || (recursive(rwMutex) && ownedByThisThread(rwMutex))) return version; // the owner reads its own writes
+    }
+}
+
+bool rwMutexOptimisticReadValidate(RWMutex* const rwMutex, const unsigned version) {
+    atomic_thread_fence(memory_order_acquire); // the reads in between can't be reordered after the version check
+    return atomic_load_explicit(&rwMutex->sequence, memory_order_relaxed) == version;
+}
+
+RWMutexStatistics rwMutexStatistics(RWMutex* const rwMutex) {
+    assert(rwMutex->flags & RW_MUTEX_FLAG_STATISTICS);
+    return (RWMutexStatistics) {
+        rwMutex->statistics.readAcquisitions,
+        rwMutex->statistics.writeAcquisitions,
+        rwMutex->statistics.contendedReads,
+        rwMutex->statistics.contendedWrites,
+        rwMutex->statistics.waitNanos
+    };
+}
+
 void rwMutexDestroy(RWMutex* const rwMutex) {
-//    while (rwMutexLocked(rwMutex)) xyield();
-    assert(!rwMutexLocked(rwMutex)); // TODO: replace with waiting until every lock-holder has unlocked the mutex
-    SDL_DestroyRWLock(rwMutex->lock);
-    // rwMutex->lock = nullptr;
+    assert(!rwMutexLocked(rwMutex));
     // TODO: add 'isValid/isntDestroyed' flag to all objects to assert they're still alive inside their methods (in case of accidental access after destroying)
     // maybe make a proxy object/methods to wrap an origin object and access its methods through mutex'ed 'n destroying-tracking mechanisms
     xfree(rwMutex);
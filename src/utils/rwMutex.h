@@ -3,6 +3,9 @@
 
 #include "../defs.h"
 
+// Futex based reader-writer lock, writer preferring - once a writer waits no new readers get in, so a steady stream of readers can't starve it;
+// uncontended locking and unlocking are a single atomic operation each, contended threads spin briefly and then sleep in the kernel
+
 typedef struct _RWMutex RWMutex;
 
 typedef enum {
@@ -12,11 +15,36 @@ typedef enum {
     RW_MUTEX_COMMAND_WRITE_UNLOCK
 } RWMutexCommand;
 
-RWMutex* rwMutexCreate(void);
-void rwMutexReadLock(RWMutex* const rwMutex); // (1) can be locked twice or 2n times by the same thread as the implementation uses recursive mutex
-void rwMutexReadUnlock(RWMutex* const rwMutex); // (2) must be unlocked 2n times if was locked by the same thread
-void rwMutexWriteLock(RWMutex* const rwMutex); // same (1)
-void rwMutexWriteUnlock(RWMutex* const rwMutex); // same (2)
+typedef enum : int {
+    RW_MUTEX_FLAG_NONE = 0,
+    RW_MUTEX_FLAG_RECURSIVE = 1 << 0, // (1) the same thread can lock it again (either read or write while holding the write lock, or read while holding the read lock), must be unlocked the same amount of times; tracked per thread, costs a thread-local lookup per operation
+    RW_MUTEX_FLAG_STATISTICS = 1 << 1, // count acquisitions and contended waits, see rwMutexStatistics
+    RW_MUTEX_FLAG_OPTIMISTIC_READS = 1 << 2 // (2) seqlock - writers bump a version, readers read without locking and retry if it has changed meanwhile; readers don't write to the lock's memory, so its cache line isn't bounced between their cores
+} RWMutexFlag;
+
+typedef struct {
+    unsigned long readAcquisitions, writeAcquisitions; // recursive relocks are not counted
+    unsigned long contendedReads, contendedWrites; // acquisitions that had to wait (spin or sleep)
+    unsigned long waitNanos; // total time spent waiting by all the contended acquisitions
+} RWMutexStatistics;
+
+RWMutex* rwMutexCreate(const int flags); // RWMutexFlag-s or-ed together
+void rwMutexReadLock(RWMutex* const rwMutex); // without (1) locking it again from the same thread deadlocks if a writer is waiting in between
+void rwMutexReadUnlock(RWMutex* const rwMutex);
+void rwMutexWriteLock(RWMutex* const rwMutex); // without (1) locking it again from the same thread deadlocks; read lock cannot be upgraded to write one in either mode
+void rwMutexWriteUnlock(RWMutex* const rwMutex);
 bool rwMutexLocked(RWMutex* const rwMutex);
 void rwMutexCommand(RWMutex* const rwMutex, const RWMutexCommand command);
+unsigned rwMutexOptimisticReadBegin(RWMutex* const rwMutex); // requires (2), waits while another thread holds the write lock, returns the version to validate against
+bool rwMutexOptimisticReadValidate(RWMutex* const rwMutex, const unsigned version); // true if nothing was written since the begin, otherwise the values read in between may be torn and must be reread; only fields can be read in between - pointers to the guarded memory may dangle until validated
+RWMutexStatistics rwMutexStatistics(RWMutex* const rwMutex); // requires RW_MUTEX_FLAG_STATISTICS, a snapshot, counters are updated concurrently
 void rwMutexDestroy(RWMutex* const rwMutex); // fails if the rwMutex is locked (either write or read)
+
+#define rwMutexOptimisticRead(x, y) ({ \
+    typeof(y) _value; \
+    for (unsigned _version = rwMutexOptimisticReadBegin(x);; _version = rwMutexOptimisticReadBegin(x)) { \
+        _value = __atomic_load_n(&(y), __ATOMIC_RELAXED); \
+        if (rwMutexOptimisticReadValidate(x, _version)) break; \
+    } \
+    _value; \
+}) // reads the field y of an object guarded by the rwMutex x with (2), the field must be written under the write lock only
@@ -0,0 +1,171 @@
+
+#include "../collections/hashtable.h"
+#include "timerWheel.h"
+
+// a timer is placed at the lowest level whose window (relative to the current tick) covers its due time, into the slot the due time maps onto;
+// whenever the current tick crosses a slot boundary of a level, the timers of the level's slot that has just become current get redistributed
+// among the lower levels, and the timers of the lowest level's current slot are due; timers beyond the top level's window wait in its
+// furthest slot and get redistributed from there
+
+enum : int {
+    LEVELS = 4, // 64^4 ticks (~194 days in milliseconds) before a timer has to go round the top level again
+    SLOT_BITS = 6,
+    SLOTS = 1 << SLOT_BITS
+};
+
+typedef struct _Timer {
+    struct _Timer* nullable next, * nullable previous; // intrusive doubly linked list of the slot
+    struct _Timer* nullable* nullable slot; // the head of the list the timer is in, null while it's detached
+    const unsigned long id;
+    unsigned long due;
+    const int period;
+    void* const value;
+} Timer;
+
+struct _TimerWheel {
+    Timer* nullable slots[LEVELS][SLOTS];
+    Hashtable* const timers; // <id, Timer*>
+    const Deallocator nullable deallocator;
+    unsigned long now, lastId; // now - the last tick processed
+};
+
+TimerWheel* timerWheelCreate(const unsigned long now, const Deallocator nullable deallocator) {
+    TimerWheel* const wheel = xcalloc(1, sizeof *wheel);
+    unconst(wheel->timers) = hashtableCreate(DEFAULT_ALLOCATOR, nullptr);
+    unconst(wheel->deallocator) = deallocator;
+    wheel->now = now;
+    wheel->lastId = 0;
+    return wheel;
+}
+
+static void attach(TimerWheel* const wheel, Timer* const timer) { // the due time is not earlier than the current tick
+    const unsigned long due = timer->due;
+
+    int level = 0;
+    while (level < LEVELS - 1 && (due >> level * SLOT_BITS) - (wheel->now >> level * SLOT_BITS) >= SLOTS) level++;
+
+    const unsigned long furthest = (wheel->now >> level * SLOT_BITS) + SLOTS - 1; // in the level's units, the current slot won't be visited till the next round
+    Timer** const slot = wheel->slots[level] + (min(due >> level * SLOT_BITS, furthest) & (SLOTS - 1));
+
+    timer->previous = nullptr;
+    timer->next = *slot;
+    if (*slot) (*slot)->previous = timer;
+    *slot = timer;
+    timer->slot = slot;
+}
+
+static void detach(Timer* const timer) {
+    if (timer->next) timer->next->previous = timer->previous;
+    if (timer->previous) timer->previous->next = timer->next;
+    else *timer->slot = timer->next;
+    timer->slot = nullptr;
+}
+
+unsigned long timerWheelSchedule(TimerWheel* const wheel, const unsigned long due, const int period, void* const value) {
+    assert(period >= 0);
+
+    Timer* const timer = xmalloc(sizeof *timer);
+    assignToStructWithConsts(timer, nullptr, nullptr, nullptr, ++wheel->lastId, max(due, wheel->now + 1) /* the current tick's slot has been visited already */, period, value)
+
+    hashtablePut(wheel->timers, timer->id, timer);
+    attach(wheel, timer);
+    return timer->id;
+}
+
+void* nullable timerWheelCancel(TimerWheel* const wheel, const unsigned long id) {
+    Timer* const timer = hashtableRemove(wheel->timers, id, false);
+    if (!timer) return nullptr;
+
+    detach(timer); // periodic timers are rescheduled before their callbacks, so they're attached even when cancelled from there
+    void* const value = timer->value;
+    xfree(timer);
+    return value;
+}
+
+static void cascade(TimerWheel* const wheel, const int level) {
+    Timer** const slot = wheel->slots[level] + ((wheel->now >> level * SLOT_BITS) & (SLOTS - 1));
+
+    Timer* timer = *slot;
+    *slot = nullptr;
+
+    while (timer) {
+        Timer* const next = timer->next;
+        attach(wheel, timer);
+        timer = next;
+    }
+}
+
+static void expire(TimerWheel* const wheel, const TimerWheelExpired expired) {
+    Timer** const slot = wheel->slots[0] + (wheel->now & (SLOTS - 1));
+
+    Timer* timer;
+    while ((timer = *slot)) { // the callee may cancel any of the others, so the head is taken anew each time
+        detach(timer);
+
+        if (timer->period) {
+            timer->due += (unsigned long) timer->period;
+            attach(wheel, timer); // lands in a later tick's slot, so it won't fire twice during this one
+            expired(timer->value, true);
+        } else {
+            assert(hashtableRemove(wheel->timers, timer->id, false) == timer);
+            void* const value = timer->value;
+            xfree(timer);
+            expired(value, false);
+        }
+    }
+}
+
+void timerWheelAdvance(TimerWheel* const wheel, const unsigned long now, const TimerWheelExpired expired) {
+    while (wheel->now < now) {
+        const unsigned long next = timerWheelNextExpiry(wheel); // the ticks in between have neither timers to fire nor ones to move down
+        if (next > now) {
+            wheel->now = now;
+            break;
+        }
+
+        wheel->now = next;
+
+        for (int level = LEVELS - 1; level > 0; level--) // the higher levels first as they pour into the lower ones' current slots
+            if (!(wheel->now & ((1ul << level * SLOT_BITS) - 1)))
+                cascade(wheel, level);
+
+        expire(wheel, expired);
+    }
+}
+
+unsigned long timerWheelNextExpiry(TimerWheel* const wheel) { // the first occupied slot ahead on each level, the lower levels' slots hold exact due times, the higher ones' - their cascading times
+    unsigned long expiry = ~0ul;
+    if (!hashtableCount(wheel->timers)) return expiry;
+
+    for (int level = 0; level < LEVELS; level++) {
+        const unsigned long current = wheel->now >> level * SLOT_BITS;
+        if ((current + 1) << level * SLOT_BITS >= expiry) break; // the higher levels can't have anything earlier
+
+        for (unsigned long slot = current + 1; slot < current + SLOTS; slot++) { // the current slot has been visited already
+            if (!wheel->slots[level][slot & (SLOTS - 1)]) continue;
+            expiry = min(expiry, slot << level * SLOT_BITS);
+            break;
+        }
+    }
+
+    return expiry;
+}
+
+int timerWheelCount(TimerWheel* const wheel) {
+    return hashtableCount(wheel->timers);
+}
+
+void timerWheelDestroy(TimerWheel* const wheel) {
+    HashtableIterator* iterator;
+    hashtableIterateBegin(wheel->timers, iterator);
+
+    Timer* timer;
+    while ((timer = hashtableIterate(iterator))) {
+        if (wheel->deallocator) wheel->deallocator(timer->value);
+        xfree(timer);
+    }
+
+    hashtableIterateEnd(iterator);
+    hashtableDestroy(wheel->timers);
+    xfree(wheel);
+}
@@ -0,0 +1,20 @@
+
+#pragma once
+
+#include "../defs.h"
+
+// Hierarchical timing wheel - timers are kept in per-tick slots of several wheels of growing granularity (a tick, 64 ticks, 64^2 ticks, ...),
+// scheduling and cancelling are constant time, advancing jumps over the empty ticks and moves each timer down at most once per level;
+// the ticks are whatever the owner measures time in (milliseconds for the lifecycle), not thread-safe
+
+typedef struct _TimerWheel TimerWheel;
+
+typedef void (^ TimerWheelExpired)(void* const value, const bool periodic); // the value of a one-shot timer is handed over to the callee, a periodic one is rescheduled beforehand and stays owned by the wheel
+
+TimerWheel* timerWheelCreate(const unsigned long now, const Deallocator nullable deallocator); // deallocator is for the values of timers left at destruction
+unsigned long timerWheelSchedule(TimerWheel* const wheel, const unsigned long due, const int period, void* const value); // due is absolute (fires on the next advance if it's already passed), zero period means one-shot, periodic timers fire at due + n * period without drifting; returns a nonzero id
+void* nullable timerWheelCancel(TimerWheel* const wheel, const unsigned long id); // returns the value if the timer was still pending, null if it has already fired or been cancelled
+void timerWheelAdvance(TimerWheel* const wheel, const unsigned long now, const TimerWheelExpired expired); // fires every timer that's due by now in the order of their due times, the callee can schedule and cancel timers
+unsigned long timerWheelNextExpiry(TimerWheel* const wheel); // the tick by which the wheel needs to be advanced next - the earliest due time, or earlier when timers have to move between levels before that; ~0 if there aren't any timers
+int timerWheelCount(TimerWheel* const wheel);
+void timerWheelDestroy(TimerWheel* const wheel);
@@ -0,0 +1,185 @@
+
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "../src/collections/bPlusTreeMap.h"
+
+static const int ITEMS_AMOUNT = 10000, STEP = 10; // keys are 0, 10, 20, ..., enough for a few levels
+static BPlusTreeMap* gMap = nullptr;
+static bool gNdm; // no dynamic memory
+
+static void init(void) {
+    gMap = bPlusTreeMapCreate(DEFAULT_ALLOCATOR, false, gNdm ? nullptr : xfree);
+}
+
+inline static void* newValue(const int value) {
+    if (gNdm) return (void*) (long) (value + 1); // values must be non-null
+    void* const buffer = xmalloc(sizeof(int));
+    *(int*) buffer = value;
+    return buffer;
+}
+
+inline static int valueToInt(const void* const value) {
+    return gNdm ? (int) (long) value - 1 : *(int*) value;
+}
+
+inline static int shuffled(const int i) { // a permutation of [0, ITEMS_AMOUNT) as 7919 is coprime with it
+    return (int) ((long) i * 7919 % ITEMS_AMOUNT);
+}
+
+static void insert(void) {
+    for (int i = 0; i < ITEMS_AMOUNT; i++)
+        bPlusTreeMapInsert(gMap, shuffled(i) * STEP, newValue(shuffled(i) * STEP));
+
+    assert(bPlusTreeMapCount(gMap) == ITEMS_AMOUNT);
+    for (int i = 0; i < ITEMS_AMOUNT; i++)
+        assert(valueToInt(bPlusTreeMapSearchKey(gMap, i * STEP)) == i * STEP);
+    assert(!bPlusTreeMapSearchKey(gMap, 1));
+    assert(!bPlusTreeMapSearchKey(gMap, INT_MAX));
+
+    int key;
+    assert(!valueToInt(bPlusTreeMapSearchMinOrMax(gMap, true, &key)) && !key);
+    assert(valueToInt(bPlusTreeMapSearchMinOrMax(gMap, false, &key)) == (ITEMS_AMOUNT - 1) * STEP && key == (ITEMS_AMOUNT - 1) * STEP);
+}
+
+static void floorAndCeiling(void) {
+    int key;
+
+    for (int i = 1; i < ITEMS_AMOUNT; i++) {
+        assert(valueToInt(bPlusTreeMapFloor(gMap, i * STEP - 1, &key)) == (i - 1) * STEP && key == (i - 1) * STEP);
+        assert(valueToInt(bPlusTreeMapCeiling(gMap, i * STEP - 1, &key)) == i * STEP && key == i * STEP);
+        assert(valueToInt(bPlusTreeMapFloor(gMap, i * STEP, nullptr)) == i * STEP);
+    }
+
+    assert(!bPlusTreeMapFloor(gMap, -1, &key) && !key);
+    assert(!bPlusTreeMapCeiling(gMap, (ITEMS_AMOUNT - 1) * STEP + 1, nullptr));
+}
+
+static void iterate(void) {
+    BPlusTreeMapIterator* iterator;
+    bPlusTreeMapIterateBegin(gMap, iterator);
+
+    void* value;
+    int key, expected = 0;
+    while ((value = bPlusTreeMapIterate(iterator, &key))) {
+        assert(key == expected && valueToInt(value) == expected);
+        expected += STEP;
+    }
+
+    bPlusTreeMapIterateEnd(iterator);
+    assert(expected == ITEMS_AMOUNT * STEP);
+
+    bPlusTreeMapIterateReverseBegin(gMap, iterator);
+
+    while ((value = bPlusTreeMapIterate(iterator, &key))) {
+        expected -= STEP;
+        assert(key == expected && valueToInt(value) == expected);
+    }
+
+    bPlusTreeMapIterateEnd(iterator);
+    assert(!expected);
+}
+
+static void iterateRange(void) {
+    BPlusTreeMapIterator* iterator;
+    bPlusTreeMapIterateRangeBegin(gMap, iterator, 2505, 7000);
+
+    int key, expected = 2510;
+    while (bPlusTreeMapIterate(iterator, &key)) {
+        assert(key == expected);
+        expected += STEP;
+    }
+
+    bPlusTreeMapIterateEnd(iterator);
+    assert(expected == 7010);
+
+    bPlusTreeMapIterateRangeBegin(gMap, iterator, 7000, 2505); // reversed
+    while (bPlusTreeMapIterate(iterator, &key)) {
+        expected -= STEP;
+        assert(key == expected);
+    }
+
+    bPlusTreeMapIterateEnd(iterator);
+    assert(expected == 2510);
+
+    bPlusTreeMapIterateRangeBegin(gMap, iterator, 31, 39); // empty
+    assert(!bPlusTreeMapIterate(iterator, nullptr));
+    bPlusTreeMapIterateEnd(iterator);
+}
+
+static void delete(void) {
+    for (int i = 0; i < ITEMS_AMOUNT; i++)
+        if (shuffled(i) % 2) bPlusTreeMapDelete(gMap, shuffled(i) * STEP);
+    bPlusTreeMapDelete(gMap, 1); // absent
+    assert(bPlusTreeMapCount(gMap) == ITEMS_AMOUNT / 2);
+
+    BPlusTreeMapIterator* iterator;
+    bPlusTreeMapIterateBegin(gMap, iterator);
+
+    int key, count = 0;
+    while (bPlusTreeMapIterate(iterator, &key))
+        assert(key == count++ * 2 * STEP);
+
+    bPlusTreeMapIterateEnd(iterator);
+    assert(count == ITEMS_AMOUNT / 2);
+
+    for (int i = 0; i < ITEMS_AMOUNT; i += 2)
+        bPlusTreeMapDelete(gMap, i * STEP);
+
+    assert(!bPlusTreeMapCount(gMap));
+    assert(!bPlusTreeMapSearchMinOrMax(gMap, true, nullptr));
+
+    for (int i = 0; i < ITEMS_AMOUNT; i++) // leaves something for the destructor
+        bPlusTreeMapInsert(gMap, i, newValue(i));
+}
+
+static void* nullable insertConcurrently(void* const map) { // queues up behind the iteration's read lock
+    bPlusTreeMapInsert(map, -1, (void*) 1l);
+    return nullptr;
+}
+
+static void lookupWhileIterating(void) { // the lookups relock the lock the iteration holds, a waiting writer doesn't get in between as the lock is recursive
+    BPlusTreeMap* const map = bPlusTreeMapCreate(DEFAULT_ALLOCATOR, true, nullptr);
+    for (int i = 0; i < 100; i++) bPlusTreeMapInsert(map, i, (void*) (long) (i + 1));
+
+    BPlusTreeMapIterator* iterator;
+    bPlusTreeMapIterateBegin(map, iterator);
+
+    pthread_t writer;
+    assert(!pthread_create(&writer, nullptr, insertConcurrently, map));
+    usleep(50'000); // let the writer fall asleep
+
+    void* value;
+    int key, count = 0;
+    while ((value = bPlusTreeMapIterate(iterator, &key))) {
+        assert(bPlusTreeMapSearchKey(map, key) == value && bPlusTreeMapFloor(map, key, nullptr) == value);
+        count++;
+    }
+    bPlusTreeMapIterateEnd(iterator);
+    assert(count == 100);
+
+    assert(!pthread_join(writer, nullptr));
+    assert(bPlusTreeMapCount(map) == 101);
+    bPlusTreeMapDestroy(map);
+}
+
+static void quit(void) {
+    bPlusTreeMapDestroy(gMap);
+}
+
+void testCollectionsBPlusTreeMap(void) {
+    gNdm = 1;
+
+    round:
+    init();
+    insert();
+    floorAndCeiling();
+    iterate();
+    iterateRange();
+    delete();
+    quit();
+
+    if (gNdm--) goto round;
+
+    lookupWhileIterating();
+}
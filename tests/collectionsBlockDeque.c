@@ -0,0 +1,287 @@
+
+#include <pthread.h>
+#include <unistd.h>
+#include "../src/collections/blockDeque.h"
+
+static const int ITEMS_AMOUNT = 10, MANY_ITEMS_AMOUNT = 1000; // many items span multiple blocks
+static BlockDeque* gDeque = nullptr;
+static bool gNdm; // no dynamic memory
+
+static void init(void) {
+    gDeque = blockDequeCreate(DEFAULT_ALLOCATOR, false, gNdm ? nullptr : xfree);
+}
+
+inline static void* newValue(const int value) {
+    if (gNdm) return (void*) (long) value;
+    void* const buffer = xmalloc(sizeof(int));
+    *(int*) buffer = value;
+    return buffer;
+}
+
+inline static int valueToInt(const void* const value) {
+    return gNdm ? (int) (long) value : *(int*) value;
+}
+
+static void pushBack(void) {
+    for (int i = 1; i <= ITEMS_AMOUNT; i++)
+        blockDequePushBack(gDeque, newValue(i));
+    for (int i = 0; i < ITEMS_AMOUNT; i++)
+        assert(valueToInt(blockDequeGet(gDeque, i, true)) == i + 1);
+
+    blockDequeClear(gDeque);
+    assert(!blockDequeSize(gDeque));
+}
+
+static void pushFront(void) {
+    for (int i = 1; i <= ITEMS_AMOUNT; i++)
+        blockDequePushFront(gDeque, newValue(i));
+    for (int i = 0, j = ITEMS_AMOUNT; i < ITEMS_AMOUNT; i++, j--)
+        assert(valueToInt(blockDequeGet(gDeque, i, true)) == j);
+}
+
+inline static void removeIfDM(void* const value) {
+    if (!gNdm) xfree(value);
+}
+
+static void popOutermost(void) {
+    // after pushFront the order is reversed
+
+    void* value = blockDequePopFirst(gDeque);
+    assert(valueToInt(value) == ITEMS_AMOUNT);
+    removeIfDM(value);
+
+    value = blockDequePopLast(gDeque);
+    assert(valueToInt(value) == 1);
+    removeIfDM(value);
+
+    assert(valueToInt(blockDequeGet(gDeque, 3, true)) == 6);
+    assert(valueToInt(blockDequeGet(gDeque, 4, true)) == ITEMS_AMOUNT / 2);
+
+    value = blockDequePopLast(gDeque);
+    assert(valueToInt(value) == 2);
+    removeIfDM(value);
+
+    value = blockDequePopFirst(gDeque);
+    assert(valueToInt(value) == ITEMS_AMOUNT - 1);
+    removeIfDM(value);
+}
+
+static void popFirst(void) {
+    blockDequeClear(gDeque);
+
+    for (int i = 1; i <= ITEMS_AMOUNT; i++)
+        blockDequePushBack(gDeque, newValue(i));
+
+    int value = 1;
+    void* temp;
+    while ((temp = blockDequePopFirst(gDeque))) {
+        assert(valueToInt(temp) == value++);
+        removeIfDM(temp);
+    }
+
+    assert(!blockDequeSize(gDeque));
+}
+
+static void popLast(void) {
+    blockDequeClear(gDeque);
+
+    for (int i = 1; i <= ITEMS_AMOUNT; i++)
+        blockDequePushBack(gDeque, newValue(i));
+
+    int value = ITEMS_AMOUNT;
+    void* temp;
+    while ((temp = blockDequePopLast(gDeque))) {
+        assert(valueToInt(temp) == value--);
+        removeIfDM(temp);
+    }
+
+    assert(!blockDequeSize(gDeque));
+}
+
+static void remove(void) {
+    blockDequeClear(gDeque);
+    for (int i = 1; i <= ITEMS_AMOUNT; i++)
+        blockDequePushBack(gDeque, newValue(i));
+
+    blockDequeRemove(gDeque, 0);
+    assert(blockDequeSize(gDeque) == ITEMS_AMOUNT - 1);
+    for (int i = 0; i < ITEMS_AMOUNT - 1; i++)
+        assert(valueToInt(blockDequeGet(gDeque, i, false)) == i + 2);
+
+    blockDequeRemove(gDeque, ITEMS_AMOUNT - 2);
+    assert(blockDequeSize(gDeque) == ITEMS_AMOUNT - 2);
+    for (int i = 0; i < ITEMS_AMOUNT - 2; i++)
+        assert(valueToInt(blockDequeGet(gDeque, i, false)) == i + 2);
+}
+
+static void removeInTheMiddle(void) {
+    blockDequeClear(gDeque);
+
+    for (int i = 1; i <= ITEMS_AMOUNT; i++)
+        blockDequePushBack(gDeque, newValue(i));
+
+    blockDequeRemove(gDeque, 4);
+    blockDequeRemove(gDeque, 4);
+
+    assert(valueToInt(blockDequeGet(gDeque, 0, true)) == 1);
+    assert(valueToInt(blockDequeGet(gDeque, 1, true)) == 2);
+    assert(valueToInt(blockDequeGet(gDeque, 2, true)) == 3);
+    assert(valueToInt(blockDequeGet(gDeque, 3, true)) == 4);
+    assert(valueToInt(blockDequeGet(gDeque, 4, true)) == 7);
+    assert(valueToInt(blockDequeGet(gDeque, 5, true)) == 8);
+    assert(valueToInt(blockDequeGet(gDeque, 6, true)) == 9);
+    assert(valueToInt(blockDequeGet(gDeque, 7, true)) == 10);
+
+    assert(blockDequeSize(gDeque) == ITEMS_AMOUNT - 2);
+}
+
+static void removeOutermostAndPush(void) {
+    blockDequeClear(gDeque);
+
+    for (int i = 1; i <= ITEMS_AMOUNT; i++)
+        blockDequePushBack(gDeque, newValue(i));
+
+    blockDequeRemove(gDeque, 0);
+
+    for (int i = 0; i < ITEMS_AMOUNT - 1; i++)
+        assert(valueToInt(blockDequeGet(gDeque, i, true)) == i + 2);
+
+    blockDequeRemove(gDeque, ITEMS_AMOUNT - 2);
+
+    for (int i = 0; i < ITEMS_AMOUNT - 2; i++)
+        assert(valueToInt(blockDequeGet(gDeque, i, false)) == i + 2);
+
+    const int n1 = 100;
+    blockDequePushBack(gDeque, newValue(n1));
+
+    for (int i = 0; i < ITEMS_AMOUNT - 2; i++)
+        assert(valueToInt(blockDequeGet(gDeque, i, true)) == i + 2);
+
+    assert(valueToInt(blockDequeGet(gDeque, ITEMS_AMOUNT - 2, false)) == n1);
+
+    const int n2 = 200;
+    blockDequePushFront(gDeque, newValue(n2));
+
+    for (int i = 1; i < ITEMS_AMOUNT - 1; i++)
+        assert(valueToInt(blockDequeGet(gDeque, i, true)) == i + 1);
+
+    assert(valueToInt(blockDequeGet(gDeque, ITEMS_AMOUNT - 1, false)) == n1);
+    assert(valueToInt(blockDequeGet(gDeque, 0, false)) == n2);
+}
+
+static void peek(void) {
+    blockDequeClear(gDeque);
+
+    for (int i = 1; i <= ITEMS_AMOUNT; i++)
+        blockDequePushBack(gDeque, newValue(i));
+
+    assert(valueToInt(blockDequePeekFirst(gDeque)) == 1);
+    assert(valueToInt(blockDequePeekLast(gDeque)) == ITEMS_AMOUNT);
+}
+
+static void iterate(void) {
+    BlockDequeIterator* iterator;
+    blockDequeIterateBegin(gDeque, iterator);
+
+    void* value;
+    int expected = 1;
+    while ((value = blockDequeIterate(iterator)))
+        assert(valueToInt(value) == expected++);
+
+    blockDequeIterateEnd(iterator);
+    assert(expected == ITEMS_AMOUNT + 1);
+}
+
+static void manyItems(void) {
+    blockDequeClear(gDeque);
+
+    for (int i = MANY_ITEMS_AMOUNT / 2; i < MANY_ITEMS_AMOUNT; i++)
+        blockDequePushBack(gDeque, newValue(i));
+    for (int i = MANY_ITEMS_AMOUNT / 2 - 1; i >= 0; i--)
+        blockDequePushFront(gDeque, newValue(i));
+
+    assert(blockDequeSize(gDeque) == MANY_ITEMS_AMOUNT);
+    for (int i = 0; i < MANY_ITEMS_AMOUNT; i++) {
+        assert(valueToInt(blockDequeGet(gDeque, i, true)) == i);
+        assert(valueToInt(blockDequeGet(gDeque, i, false)) == i);
+    }
+
+    blockDequeRemove(gDeque, 100); // shifts the front part
+    blockDequeRemove(gDeque, MANY_ITEMS_AMOUNT - 101); // shifts the back part
+    assert(blockDequeSize(gDeque) == MANY_ITEMS_AMOUNT - 2);
+    assert(valueToInt(blockDequeGet(gDeque, 100, true)) == 101);
+    assert(valueToInt(blockDequeGet(gDeque, MANY_ITEMS_AMOUNT - 101, true)) == MANY_ITEMS_AMOUNT - 99);
+
+    for (int i = 0; i < MANY_ITEMS_AMOUNT; i++) { // queue usage - the deque slides forward block by block
+        void* const value = blockDequePopFirst(gDeque);
+        blockDequePushBack(gDeque, newValue(valueToInt(value) + MANY_ITEMS_AMOUNT));
+        removeIfDM(value);
+    }
+    assert(blockDequeSize(gDeque) == MANY_ITEMS_AMOUNT - 2);
+
+    void* value;
+    int count = 0;
+    while ((value = blockDequePopLast(gDeque)))
+        count++,
+        removeIfDM(value);
+
+    assert(count == MANY_ITEMS_AMOUNT - 2);
+    assert(!blockDequePeekFirst(gDeque) && !blockDequePeekLast(gDeque));
+}
+
+static void* nullable pushConcurrently(void* const deque) { // queues up behind the iteration's read lock
+    blockDequePushBack(deque, (void*) -1l);
+    return nullptr;
+}
+
+static void getWhileIterating(void) { // the gets relock the lock the iteration holds, a waiting writer doesn't get in between as the lock is recursive
+    BlockDeque* const deque = blockDequeCreate(DEFAULT_ALLOCATOR, true, nullptr);
+    for (long i = 1; i <= MANY_ITEMS_AMOUNT; i++) blockDequePushBack(deque, (void*) i);
+
+    BlockDequeIterator* iterator;
+    blockDequeIterateBegin(deque, iterator);
+
+    pthread_t writer;
+    assert(!pthread_create(&writer, nullptr, pushConcurrently, deque));
+    usleep(50'000); // let the writer fall asleep
+
+    void* value;
+    int index = 0;
+    while ((value = blockDequeIterate(iterator))) {
+        assert(blockDequeGet(deque, index, true) == value && blockDequeSize(deque) == MANY_ITEMS_AMOUNT);
+        index++;
+    }
+    blockDequeIterateEnd(iterator);
+    assert(index == MANY_ITEMS_AMOUNT);
+
+    assert(!pthread_join(writer, nullptr));
+    assert(blockDequeSize(deque) == MANY_ITEMS_AMOUNT + 1);
+    blockDequeDestroy(deque);
+}
+
+static void quit(void) {
+    blockDequeDestroy(gDeque);
+}
+
+void testCollectionsBlockDeque(void) {
+    gNdm = 1;
+
+    round:
+    init();
+    pushBack();
+    pushFront();
+    popOutermost();
+    popFirst();
+    popLast();
+    remove();
+    removeInTheMiddle();
+    removeOutermostAndPush();
+    peek();
+    iterate();
+    manyItems();
+    quit();
+
+    if (gNdm--) goto round;
+
+    getWhileIterating();
+}
@@ -1,12 +1,12 @@
 
 #include "../src/collections/hashtable.h"
 
-static const int ITEMS_AMOUNT = 10;
+static const int ITEMS_AMOUNT = 10, MANY_ITEMS_AMOUNT = 1000;
 static Hashtable* gHashtable = nullptr;
 static bool gNdm; // no dynamic memory
 
 static void init(void) {
-    gHashtable = nullptr; //hashtableCreate(DEFAULT_ALLOCATOR, false, gNdm ? nullptr : xfree);
+    gHashtable = hashtableCreate(DEFAULT_ALLOCATOR, gNdm ? nullptr : xfree);
 }
 
 inline static void* newValue(const int value) {
@@ -20,19 +20,74 @@ inline static int valueToInt(const void* const value) {
     return gNdm ? (int) (long) value : *(int*) value;
 }
 
+inline static void removeIfDM(void* const value) {
+    if (!gNdm) xfree(value);
+}
+
 static void put(void) {
     for (byte i = 1; i <= ITEMS_AMOUNT; i++)
-//        printf("%d %d\n", i, hashValue(&i, 1));
         hashtablePut(gHashtable, hashValue(&i, 1), newValue(i));
+    assert(hashtableCount(gHashtable) == ITEMS_AMOUNT);
+
+    for (byte i = 1; i <= ITEMS_AMOUNT; i++)
+        assert(valueToInt(hashtableGet(gHashtable, hashValue(&i, 1))) == i);
+
+    byte i = ITEMS_AMOUNT + 1;
+    assert(!hashtableGet(gHashtable, hashValue(&i, 1)));
+}
 
+static void iterate(void) {
     HashtableIterator* iterator;
     hashtableIterateBegin(gHashtable, iterator);
+
     void* value;
-    byte i = 1;
+    int count = 0, sum = 0;
     while ((value = hashtableIterate(iterator)))
-        assert(valueToInt(value) == i++);
-//        printf("%d\n", valueToInt(value));
+        count++,
+        sum += valueToInt(value);
+
     hashtableIterateEnd(iterator);
+
+    assert(count == ITEMS_AMOUNT);
+    assert(sum == ITEMS_AMOUNT * (ITEMS_AMOUNT + 1) / 2);
+}
+
+static void remove(void) {
+    for (byte i = 1; i <= ITEMS_AMOUNT; i += 2) {
+        void* const value = hashtableRemove(gHashtable, hashValue(&i, 1), false);
+        assert(valueToInt(value) == i);
+        removeIfDM(value);
+    }
+
+    for (byte i = 1; i <= ITEMS_AMOUNT; i++) {
+        void* const value = hashtableGet(gHashtable, hashValue(&i, 1));
+        assert(i % 2 ? !value : valueToInt(value) == i);
+    }
+
+    byte i = 2;
+    assert(!hashtableRemove(gHashtable, hashValue(&i, 1), true));
+    assert(!hashtableGet(gHashtable, hashValue(&i, 1)));
+    assert(hashtableCount(gHashtable) == ITEMS_AMOUNT / 2 - 1);
+}
+
+static void grow(void) {
+    for (int i = 0; i < MANY_ITEMS_AMOUNT; i++)
+        hashtablePut(gHashtable, (unsigned long) i << 32, newValue(i));
+
+    const int capacity = hashtableCapacity(gHashtable);
+    assert(capacity >= hashtableCount(gHashtable) && !(capacity & (capacity - 1)));
+
+    for (int i = 0; i < MANY_ITEMS_AMOUNT; i++)
+        assert(valueToInt(hashtableGet(gHashtable, (unsigned long) i << 32)) == i);
+
+    for (int i = 0; i < MANY_ITEMS_AMOUNT; i++) // leaves tombstones which must be reused
+        assert(!hashtableRemove(gHashtable, (unsigned long) i << 32, true));
+
+    for (int i = 0; i < MANY_ITEMS_AMOUNT; i++)
+        hashtablePut(gHashtable, (unsigned long) i << 32, newValue(i));
+
+    assert(hashtableCapacity(gHashtable) == capacity);
+    assert(hashtableCount(gHashtable) == MANY_ITEMS_AMOUNT + ITEMS_AMOUNT / 2 - 1);
 }
 
 static void quit(void) {
@@ -43,10 +98,12 @@ void testCollectionsHashtable(void) {
     gNdm = 1;
 
     round:
-//    init();
-//    put();
-//
-//    quit();
+    init();
+    put();
+    iterate();
+    remove();
+    grow();
+    quit();
 
-//    if (gNdm--) goto round;
+    if (gNdm--) goto round;
 }
@@ -4,9 +4,10 @@
 static const int ITEMS_AMOUNT = 10;
 static List* gList = nullptr;
 static bool gNdm; // no dynamic memory
+static bool gSynchronized = false;
 
 static void init(void) {
-    gList = listCreate(DEFAULT_ALLOCATOR, false, gNdm ? nullptr : xfree);
+    gList = listCreate(DEFAULT_ALLOCATOR, gSynchronized, gNdm ? nullptr : xfree);
 }
 
 inline static void* newValue(const int value) {
@@ -162,6 +163,72 @@ static void binarySearch(void) {
     }
 }
 
+static void bulk(void) {
+    listClear(gList);
+    listReserve(gList, ITEMS_AMOUNT * 2);
+
+    void* values[ITEMS_AMOUNT];
+    for (int i = 0; i < ITEMS_AMOUNT; i++)
+        values[i] = newValue(i + 1);
+
+    listAddAll(gList, values, ITEMS_AMOUNT);
+    assert(listSize(gList) == ITEMS_AMOUNT);
+    for (int i = 0; i < ITEMS_AMOUNT; i++)
+        assert(listGet(gList, i) == values[i]);
+
+    listRemoveRange(gList, 2, 3);
+    assert(listSize(gList) == ITEMS_AMOUNT - 3);
+    assert(valueToInt(listGet(gList, 1)) == 2);
+    assert(valueToInt(listGet(gList, 2)) == 6);
+    assert(valueToInt(listPeekLast(gList)) == ITEMS_AMOUNT);
+
+    listRemoveRange(gList, 0, 0);
+    assert(listSize(gList) == ITEMS_AMOUNT - 3);
+
+    listShrinkToFit(gList);
+    listAddBack(gList, newValue(ITEMS_AMOUNT + 1));
+    assert(valueToInt(listPeekLast(gList)) == ITEMS_AMOUNT + 1);
+
+    listRemoveRange(gList, 0, listSize(gList));
+    assert(!listSize(gList));
+
+    listShrinkToFit(gList);
+    assert(!listPeekFirst(gList));
+}
+
+static void wrapAround(void) { // items of the circular buffer span across the end of the allocated array
+    for (int i = 1; i <= ITEMS_AMOUNT; i++)
+        listAddBack(gList, newValue(i));
+    for (int i = 0; i < ITEMS_AMOUNT / 2; i++)
+        removeIfDM(listPopFirst(gList));
+    for (int i = ITEMS_AMOUNT / 2; i > 0; i--)
+        listAddFront(gList, newValue(i));
+    for (int i = ITEMS_AMOUNT + 1; i <= ITEMS_AMOUNT * 2; i++)
+        listAddBack(gList, newValue(i));
+
+    assert(listSize(gList) == ITEMS_AMOUNT * 2);
+    for (int i = 0; i < ITEMS_AMOUNT * 2; i++)
+        assert(valueToInt(listGet(gList, i)) == i + 1);
+
+    listRemove(gList, 1);
+    listRemove(gList, ITEMS_AMOUNT * 2 - 3);
+    assert(valueToInt(listGet(gList, 1)) == 3);
+    assert(valueToInt(listPeekLast(gList)) == ITEMS_AMOUNT * 2);
+    assert(valueToInt(listGet(gList, ITEMS_AMOUNT * 2 - 3)) == ITEMS_AMOUNT * 2);
+
+    listSwap(gList, 0, ITEMS_AMOUNT * 2 - 3);
+    listQSort(gList, comparator);
+    for (int i = 1; i < ITEMS_AMOUNT * 2 - 2; i++)
+        assert(valueToInt(listGet(gList, i - 1)) < valueToInt(listGet(gList, i)));
+
+    void* value;
+    int i = 0;
+    while ((value = listPopLast(gList)))
+        removeIfDM(value),
+        i++;
+    assert(i == ITEMS_AMOUNT * 2 - 2);
+}
+
 static void quit(void) {
     listDestroy(gList);
 }
@@ -181,7 +248,15 @@ void testCollectionsList(void) {
     swap();
     sort();
     binarySearch();
+    bulk();
+    wrapAround();
     quit();
 
     if (gNdm--) goto round;
+
+    if (!gSynchronized) { // once again through the lock and the optimistic reads
+        gSynchronized = true;
+        gNdm = 1;
+        goto round;
+    }
 }
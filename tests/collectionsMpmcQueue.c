@@ -0,0 +1,93 @@
+
+#include <pthread.h>
+#include "../src/collections/mpmcQueue.h"
+
+static const int CAPACITY = 60; // rounded up to 64
+static const int THREADS = 4, ITEMS_PER_PRODUCER = 100'000;
+static MPMCQueue* gQueue = nullptr;
+static atomic long gConsumedSum = 0;
+static atomic int gConsumedCount = 0;
+
+static void fifo(void) {
+    gQueue = mpmcQueueCreate(DEFAULT_ALLOCATOR, CAPACITY, nullptr);
+    assert(mpmcQueueCapacity(gQueue) == 64);
+    assert(!mpmcQueuePop(gQueue) && mpmcQueueDrained(gQueue));
+
+    for (long i = 1; i <= 64; i++)
+        assert(mpmcQueueTryPush(gQueue, (void*) i));
+    assert(!mpmcQueueTryPush(gQueue, (void*) 65l));
+    assert(mpmcQueueSize(gQueue) == 64 && !mpmcQueueDrained(gQueue));
+
+    for (long i = 1; i <= 64; i++)
+        assert((long) mpmcQueuePop(gQueue) == i);
+    assert(!mpmcQueuePop(gQueue) && !mpmcQueueSize(gQueue) && mpmcQueueDrained(gQueue));
+
+    for (long i = 1; i <= 1000; i++) { // wraps around many times
+        assert(mpmcQueueTryPush(gQueue, (void*) i));
+        assert((long) mpmcQueuePop(gQueue) == i);
+    }
+
+    mpmcQueueDestroy(gQueue);
+}
+
+static void destroyNonEmpty(void) {
+    gQueue = mpmcQueueCreate(DEFAULT_ALLOCATOR, CAPACITY, xfree);
+    for (int i = 0; i < 10; i++)
+        mpmcQueuePush(gQueue, xmalloc(sizeof(int)));
+    mpmcQueueDestroy(gQueue);
+}
+
+static void* nullable produce(void* const parameter) {
+    const long producer = (long) parameter;
+    for (long i = 0; i < ITEMS_PER_PRODUCER; i++)
+        mpmcQueuePush(gQueue, (void*) (producer << 32 | (i + 1)));
+    return nullptr;
+}
+
+static void* nullable consume(void* const) {
+    long lastPerProducer[THREADS];
+    for (int i = 0; i < THREADS; lastPerProducer[i++] = 0);
+
+    while (gConsumedCount < THREADS * ITEMS_PER_PRODUCER) {
+        const long value = (long) mpmcQueuePop(gQueue);
+        if (!value) {
+            xyield();
+            continue;
+        }
+
+        const long producer = value >> 32, item = value & 0xffffffffl;
+        assert(item > lastPerProducer[producer]); // values of a single producer come out in the order they went in
+        lastPerProducer[producer] = item;
+
+        gConsumedSum += item;
+        gConsumedCount++;
+    }
+    return nullptr;
+}
+
+static void concurrent(void) {
+    gQueue = mpmcQueueCreate(DEFAULT_ALLOCATOR, CAPACITY, nullptr);
+
+    pthread_t producers[THREADS], consumers[THREADS];
+    for (long i = 0; i < THREADS; i++) {
+        assert(!pthread_create(producers + i, nullptr, produce, (void*) i));
+        assert(!pthread_create(consumers + i, nullptr, consume, nullptr));
+    }
+
+    for (int i = 0; i < THREADS; i++) {
+        assert(!pthread_join(producers[i], nullptr));
+        assert(!pthread_join(consumers[i], nullptr));
+    }
+
+    assert(gConsumedCount == THREADS * ITEMS_PER_PRODUCER);
+    assert(gConsumedSum == (long) THREADS * ITEMS_PER_PRODUCER * (ITEMS_PER_PRODUCER + 1) / 2);
+    assert(!mpmcQueuePop(gQueue));
+
+    mpmcQueueDestroy(gQueue);
+}
+
+void testCollectionsMpmcQueue(void) {
+    fifo();
+    destroyNonEmpty();
+    concurrent();
+}
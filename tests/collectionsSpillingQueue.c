@@ -0,0 +1,80 @@
+
+#include <pthread.h>
+#include "../src/collections/spillingQueue.h"
+
+enum : int {CAPACITY = 64, BURST = 1000, THREADS = 4, ITEMS_PER_PRODUCER = 100'000};
+static SpillingQueue* gQueue = nullptr;
+
+static void burst(void) { // the consumer's own thread pushes far more than the ring holds without anyone popping in between
+    gQueue = spillingQueueCreate(DEFAULT_ALLOCATOR, CAPACITY, nullptr);
+    assert(!spillingQueuePop(gQueue));
+
+    for (long i = 1; i <= BURST; i++)
+        spillingQueuePush(gQueue, (void*) i);
+    assert(spillingQueueSize(gQueue) == BURST && spillingQueueSpilled(gQueue) == BURST - CAPACITY);
+
+    for (long i = 1; i <= BURST / 2; i++)
+        assert((long) spillingQueuePop(gQueue) == i);
+    for (long i = BURST + 1; i <= BURST + 10; i++) // the overflow isn't drained yet, so these go after it even though the ring has room
+        spillingQueuePush(gQueue, (void*) i);
+    for (long i = BURST / 2 + 1; i <= BURST + 10; i++)
+        assert((long) spillingQueuePop(gQueue) == i);
+    assert(!spillingQueuePop(gQueue) && !spillingQueueSize(gQueue) && !spillingQueueSpilled(gQueue));
+
+    spillingQueuePush(gQueue, (void*) 1l); // back to the ring
+    assert(!spillingQueueSpilled(gQueue) && (long) spillingQueuePop(gQueue) == 1);
+
+    spillingQueueDestroy(gQueue);
+}
+
+static void destroyNonEmpty(void) {
+    gQueue = spillingQueueCreate(DEFAULT_ALLOCATOR, CAPACITY, xfree);
+    for (int i = 0; i < CAPACITY * 2; i++)
+        spillingQueuePush(gQueue, xmalloc(sizeof(int)));
+    spillingQueueDestroy(gQueue);
+}
+
+static void* nullable produce(void* const parameter) {
+    const long producer = (long) parameter;
+    for (long i = 0; i < ITEMS_PER_PRODUCER; i++)
+        spillingQueuePush(gQueue, (void*) (producer << 32 | (i + 1)));
+    return nullptr;
+}
+
+static void concurrent(void) { // a single consumer, like a looper's thread
+    gQueue = spillingQueueCreate(DEFAULT_ALLOCATOR, CAPACITY, nullptr);
+
+    pthread_t producers[THREADS];
+    for (long i = 0; i < THREADS; i++)
+        assert(!pthread_create(producers + i, nullptr, produce, (void*) i));
+
+    long lastPerProducer[THREADS] = {}, sum = 0;
+    for (int count = 0; count < THREADS * ITEMS_PER_PRODUCER;) {
+        const long value = (long) spillingQueuePop(gQueue);
+        if (!value) {
+            xyield();
+            continue;
+        }
+
+        const long producer = value >> 32, item = value & 0xffffffffl;
+        assert(item == lastPerProducer[producer] + 1); // values of a single producer come out in the order they went in, whether they spilled or not
+        lastPerProducer[producer] = item;
+
+        sum += item;
+        count++;
+    }
+
+    for (int i = 0; i < THREADS; i++)
+        assert(!pthread_join(producers[i], nullptr));
+
+    assert(sum == (long) THREADS * ITEMS_PER_PRODUCER * (ITEMS_PER_PRODUCER + 1) / 2);
+    assert(!spillingQueuePop(gQueue));
+
+    spillingQueueDestroy(gQueue);
+}
+
+void testCollectionsSpillingQueue(void) {
+    burst();
+    destroyNonEmpty();
+    concurrent();
+}
@@ -0,0 +1,139 @@
+
+#include <limits.h>
+#include "../src/collections/treeMap.h"
+
+static const int ITEMS_AMOUNT = 100, STEP = 10; // keys are 0, 10, 20, ...
+static TreeMap* gMap = nullptr;
+static bool gNdm; // no dynamic memory
+
+static void init(void) {
+    gMap = treeMapCreate(DEFAULT_ALLOCATOR, false, gNdm ? nullptr : xfree);
+}
+
+inline static void* newValue(const int value) {
+    if (gNdm) return (void*) (long) (value + 1); // values must be non-null
+    void* const buffer = xmalloc(sizeof(int));
+    *(int*) buffer = value;
+    return buffer;
+}
+
+inline static int valueToInt(const void* const value) {
+    return gNdm ? (int) (long) value - 1 : *(int*) value;
+}
+
+static void insert(void) {
+    for (int i = 0; i < ITEMS_AMOUNT; i += 2) // inserted out of order
+        treeMapInsert(gMap, i * STEP, newValue(i * STEP));
+    for (int i = 1; i < ITEMS_AMOUNT; i += 2)
+        treeMapInsert(gMap, i * STEP, newValue(i * STEP));
+
+    assert(treeMapCount(gMap) == ITEMS_AMOUNT);
+    for (int i = 0; i < ITEMS_AMOUNT; i++)
+        assert(valueToInt(treeMapSearchKey(gMap, i * STEP)) == i * STEP);
+    assert(!treeMapSearchKey(gMap, 1));
+}
+
+static void floorAndCeiling(void) {
+    int key;
+
+    assert(valueToInt(treeMapFloor(gMap, 15, &key)) == 10 && key == 10);
+    assert(valueToInt(treeMapCeiling(gMap, 15, &key)) == 20 && key == 20);
+    assert(valueToInt(treeMapFloor(gMap, 20, &key)) == 20 && key == 20);
+    assert(valueToInt(treeMapCeiling(gMap, 20, &key)) == 20 && key == 20);
+
+    assert(!treeMapFloor(gMap, -1, &key) && !key);
+    assert(!treeMapCeiling(gMap, (ITEMS_AMOUNT - 1) * STEP + 1, nullptr));
+    assert(valueToInt(treeMapFloor(gMap, INT_MAX, &key)) == (ITEMS_AMOUNT - 1) * STEP);
+    assert(valueToInt(treeMapCeiling(gMap, INT_MIN, &key)) == 0);
+}
+
+static void iterate(void) {
+    TreeMapIterator* iterator;
+    treeMapIterateBegin(gMap, iterator);
+
+    void* value;
+    int key, expected = 0;
+    while ((value = treeMapIterate(iterator, &key))) {
+        assert(key == expected && valueToInt(value) == expected);
+        expected += STEP;
+    }
+
+    treeMapIterateEnd(iterator);
+    assert(expected == ITEMS_AMOUNT * STEP);
+
+    treeMapIterateReverseBegin(gMap, iterator);
+
+    while ((value = treeMapIterate(iterator, &key))) {
+        expected -= STEP;
+        assert(key == expected && valueToInt(value) == expected);
+    }
+
+    treeMapIterateEnd(iterator);
+    assert(!expected);
+}
+
+static void iterateRange(void) {
+    TreeMapIterator* iterator;
+    treeMapIterateRangeBegin(gMap, iterator, 25, 70);
+
+    int key, expected = 30;
+    while (treeMapIterate(iterator, &key)) {
+        assert(key == expected);
+        expected += STEP;
+    }
+
+    treeMapIterateEnd(iterator);
+    assert(expected == 80);
+
+    treeMapIterateRangeBegin(gMap, iterator, 70, 25); // reversed
+    while (treeMapIterate(iterator, &key)) {
+        expected -= STEP;
+        assert(key == expected);
+    }
+
+    treeMapIterateEnd(iterator);
+    assert(expected == 30);
+
+    treeMapIterateRangeBegin(gMap, iterator, 31, 39); // empty
+    assert(!treeMapIterate(iterator, nullptr));
+    treeMapIterateEnd(iterator);
+}
+
+static void delete(void) {
+    for (int i = 0; i < ITEMS_AMOUNT; i += 2)
+        treeMapDelete(gMap, i * STEP);
+    assert(treeMapCount(gMap) == ITEMS_AMOUNT / 2);
+
+    int key;
+    assert(valueToInt(treeMapFloor(gMap, 20, &key)) == 10 && key == 10);
+    assert(valueToInt(treeMapSearchMinOrMax(gMap, true, &key)) == STEP && key == STEP);
+
+    TreeMapIterator* iterator;
+    treeMapIterateBegin(gMap, iterator);
+
+    int count = 0;
+    while (treeMapIterate(iterator, &key))
+        assert(key == (count++ * 2 + 1) * STEP);
+
+    treeMapIterateEnd(iterator);
+    assert(count == ITEMS_AMOUNT / 2);
+}
+
+static void quit(void) {
+    treeMapDestroy(gMap);
+}
+
+void testCollectionsTreeMap(void) {
+    gNdm = 1;
+
+    round:
+    init();
+    insert();
+    floorAndCeiling();
+    iterate();
+    iterateRange();
+    delete();
+    quit();
+
+    if (gNdm--) goto round;
+}
@@ -0,0 +1,92 @@
+
+#include <pthread.h>
+#include "../src/collections/workStealingDeque.h"
+
+static const int CAPACITY = 60; // rounded up to 64
+static const int THIEVES = 3, ITEMS = 200'000;
+static WorkStealingDeque* gDeque = nullptr;
+static atomic bool gProducing = false;
+static atomic long gTakenSum = 0;
+static atomic int gTakenCount = 0;
+
+static void ends(void) {
+    gDeque = workStealingDequeCreate(DEFAULT_ALLOCATOR, CAPACITY, nullptr);
+    assert(!workStealingDequePop(gDeque) && !workStealingDequeSteal(gDeque));
+
+    for (long i = 1; i <= 64; i++)
+        assert(workStealingDequePush(gDeque, (void*) i));
+    assert(!workStealingDequePush(gDeque, (void*) 65l));
+    assert(workStealingDequeSize(gDeque) == 64);
+
+    assert((long) workStealingDequePop(gDeque) == 64); // the owner takes the newest
+    assert((long) workStealingDequeSteal(gDeque) == 1); // thieves take the oldest
+    assert(workStealingDequeSize(gDeque) == 62);
+
+    for (long i = 63; i >= 2; i--)
+        assert((long) workStealingDequePop(gDeque) == i);
+    assert(!workStealingDequePop(gDeque) && !workStealingDequeSize(gDeque));
+
+    for (long i = 1; i <= 1000; i++) { // wraps around many times
+        assert(workStealingDequePush(gDeque, (void*) i));
+        assert((long) workStealingDequeSteal(gDeque) == i);
+    }
+
+    workStealingDequeDestroy(gDeque);
+}
+
+static void destroyNonEmpty(void) {
+    gDeque = workStealingDequeCreate(DEFAULT_ALLOCATOR, CAPACITY, xfree);
+    for (int i = 0; i < 10; i++)
+        assert(workStealingDequePush(gDeque, xmalloc(sizeof(int))));
+    workStealingDequeDestroy(gDeque);
+}
+
+static void take(const long value) {
+    gTakenSum += value;
+    gTakenCount++;
+}
+
+static void* nullable steal(void* const) {
+    while (gProducing || workStealingDequeSize(gDeque)) {
+        const long value = (long) workStealingDequeSteal(gDeque);
+        if (value) take(value);
+    }
+    return nullptr;
+}
+
+static void concurrent(void) { // every value is taken exactly once either by the owner or by one of the thieves
+    gDeque = workStealingDequeCreate(DEFAULT_ALLOCATOR, CAPACITY, nullptr);
+    gProducing = true;
+
+    pthread_t thieves[THIEVES];
+    for (int i = 0; i < THIEVES; i++)
+        assert(!pthread_create(thieves + i, nullptr, steal, nullptr));
+
+    for (long i = 1; i <= ITEMS; i++) {
+        while (!workStealingDequePush(gDeque, (void*) i)) {
+            const long value = (long) workStealingDequePop(gDeque);
+            if (value) take(value);
+        }
+
+        if (!(i % 3)) { // the owner races the thieves for the last values
+            const long value = (long) workStealingDequePop(gDeque);
+            if (value) take(value);
+        }
+    }
+
+    long value;
+    while ((value = (long) workStealingDequePop(gDeque))) take(value);
+    gProducing = false;
+
+    for (int i = 0; i < THIEVES; i++)
+        assert(!pthread_join(thieves[i], nullptr));
+
+    assert(gTakenCount == ITEMS && gTakenSum == (long) ITEMS * (ITEMS + 1) / 2);
+    workStealingDequeDestroy(gDeque);
+}
+
+void testCollectionsWorkStealingDeque(void) {
+    ends();
+    destroyNonEmpty();
+    concurrent();
+}
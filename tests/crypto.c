@@ -1,4 +1,6 @@
 
+#include <pthread.h>
+#include <sys/uio.h>
 #include "../src/crypto/crypto.h"
 
 [[gnu::section(".data")]] /*so it can be written initially*/ static const CryptoGenericKey PUBLIC_KEY, SECRET_KEY;
@@ -35,6 +37,44 @@ static void singleCrypt(void) {
     assert(cryptoSingleDecrypt(bundle, DATA_SIZE, &SECRET_KEY));
 }
 
+static void scatteredCrypt(void) {
+    enum : int {SIZE = 4 << 20}; // far more than a thread's stack would take
+
+    CryptoSingleEncryptedBundle* const bundle = xmalloc(sizeof *bundle + SIZE);
+    byte* const scattered = xmalloc(SIZE);
+    for (int i = 0; i < SIZE; i++) bundle->data[i] = scattered[i] = (byte) (i * 7);
+    cryptoRandomBytes(bundle->nonce, CRYPTO_SINGLE_CRYPT_NONCE_SIZE);
+
+    const int sizes[] = {5, 60, 1, 64, 64 * 3 + 31, 0, 100'000}; // the keystream's blocks get split in all sorts of ways, the rest goes last
+    struct iovec segments[arraySize(sizes) + 1];
+    int offset = 0;
+    for (int i = 0; i < (int) arraySize(sizes); offset += sizes[i], i++)
+        segments[i] = (struct iovec) {scattered + offset, (unsigned long) sizes[i]};
+    segments[arraySize(sizes)] = (struct iovec) {scattered + offset, (unsigned long) (SIZE - offset)};
+
+    byte mac[CRYPTO_SINGLE_CRYPT_MAC_SIZE];
+    cryptoSingleEncryptScattered(mac, bundle->nonce, segments, arraySize(segments), &SECRET_KEY);
+    cryptoSingleEncrypt(bundle, SIZE, &SECRET_KEY);
+    assert(!xmemcmp(mac, bundle->mac, sizeof mac) && !xmemcmp(scattered, bundle->data, SIZE)); // the same as if it were contiguous
+
+    bundle->data[SIZE / 2] ^= 1;
+    assert(!cryptoSingleDecrypt(bundle, SIZE, &SECRET_KEY));
+    assert(!xmemcmp(scattered, bundle->data, SIZE / 2) && bundle->data[SIZE / 2] == (scattered[SIZE / 2] ^ 1)); // intact
+    bundle->data[SIZE / 2] ^= 1;
+
+    scattered[SIZE - 1] ^= 1;
+    assert(!cryptoSingleDecryptScattered(mac, bundle->nonce, segments, arraySize(segments), &SECRET_KEY));
+    assert(!xmemcmp(scattered, bundle->data, SIZE - 1));
+    scattered[SIZE - 1] ^= 1;
+
+    assert(cryptoSingleDecryptScattered(mac, bundle->nonce, segments, arraySize(segments), &SECRET_KEY));
+    assert(cryptoSingleDecrypt(bundle, SIZE, &SECRET_KEY));
+    for (int i = 0; i < SIZE; i++) assert(bundle->data[i] == (byte) (i * 7) && scattered[i] == (byte) (i * 7));
+
+    xfree(bundle);
+    xfree(scattered);
+}
+
 static void streamCrypt(void) {
     CryptoStreamCoder encoder, decoder;
     CryptoStreamHeader header;
@@ -45,35 +85,111 @@ static void streamCrypt(void) {
     assert(cryptoStreamCreateDecoder(&decoder, &header, &key));
 
     const int chunksAmount = 5;
-    CryptoStreamEncryptedChunkBundle* const chunks[chunksAmount] = {
-        xalloca(sizeof *chunks[0] + 5),
-        xalloca(sizeof *chunks[0] + 6),
-        xalloca(sizeof *chunks[0] + 1),
-        xalloca(sizeof *chunks[0] + 1),
-        xalloca(sizeof *chunks[0] + 3),
+    const int sizes[chunksAmount] = {5, 6, 1, 1, 3};
+    const char* const data[chunksAmount] = {"Abcd", "01234", " ", "X", "\xff\x05\x00"};
+
+    CryptoStreamEncryptedChunkBundle* chunks[chunksAmount];
+    for (int i = 0; i < chunksAmount; i++)
+        chunks[i] = xalloca2(sizeof *chunks[i] + sizes[i] + CRYPTO_STREAM_MAC_SIZE);
+
+    for (int i = 0; i < chunksAmount; i++) {
+        if (i % 2) { // in place
+            xmemcpy(chunks[i]->data, data[i], sizes[i]);
+            cryptoStreamEncrypt(&encoder, chunks[i], nullptr, sizes[i]);
+        } else
+            cryptoStreamEncrypt(&encoder, chunks[i], (const byte*) data[i], sizes[i]);
+    }
+
+    byte decrypted[6] = {};
+    chunks[0]->data[sizes[0]] ^= 1; // the mac
+    assert(!cryptoStreamDecrypt(&decoder, chunks[0], decrypted, sizes[0]));
+    assert(!decrypted[0]);
+    chunks[0]->data[sizes[0]] ^= 1;
+
+    for (int i = 0; i < chunksAmount; i++) {
+        if (i % 2) {
+            assert(cryptoStreamDecrypt(&decoder, chunks[i], decrypted, sizes[i]));
+            assert(!xmemcmp(decrypted, data[i], sizes[i]));
+        } else {
+            assert(cryptoStreamDecrypt(&decoder, chunks[i], nullptr, sizes[i]));
+            assert(!xmemcmp(chunks[i]->data, data[i], sizes[i]));
+        }
+    }
+}
+
+enum : int {CHUNKS = 16, CHUNK_SIZE = 1000, LAST_CHUNK_SIZE = 123, CHUNK_THREADS = 4};
+static CryptoChunkedCoder gChunkedDecoder;
+static CryptoChunkedEncryptedBundle* gChunks[CHUNKS];
+
+static inline int chunkSize(const int index) {
+    return index < CHUNKS - 1 ? CHUNK_SIZE : LAST_CHUNK_SIZE;
+}
+
+static void* nullable decryptChunks(void* const parameter) { // every CHUNK_THREADS-th chunk starting from the thread's number, backwards
+    for (int i = CHUNKS - 1; i >= 0; i--) {
+        if (i % CHUNK_THREADS != (int) (long) parameter) continue;
+
+        assert(cryptoChunkedDecrypt(&gChunkedDecoder, gChunks[i], chunkSize(i), i, i == CHUNKS - 1));
+        for (int j = 0; j < chunkSize(i); j++) assert(gChunks[i]->data[j] == (byte) (i + j));
+    }
+    return nullptr;
+}
+
+static void chunkedCrypt(void) {
+    CryptoGenericKey key;
+    cryptoRandomBytes((byte*) &key, CRYPTO_GENERIC_KEY_SIZE);
+
+    CryptoChunkedCoder encoder;
+    CryptoChunkedHeader header;
+    cryptoChunkedCreateEncoder(&encoder, &header, &key);
+
+    for (int i = 0; i < CHUNKS; i++) {
+        gChunks[i] = xmalloc(sizeof *gChunks[i] + chunkSize(i));
+        for (int j = 0; j < chunkSize(i); j++) gChunks[i]->data[j] = (byte) (i + j);
+    }
+
+    for (int i = CHUNKS - 1; i >= 0; i--) // any order
+        cryptoChunkedEncrypt(&encoder, gChunks[i], chunkSize(i), i, i == CHUNKS - 1);
+    cryptoChunkedDestroyCoder(&encoder);
+
+    cryptoChunkedCreateDecoder(&gChunkedDecoder, &header, &key);
+
+    CryptoChunkedEncryptedBundle* const copy = xmalloc(sizeof *copy + CHUNK_SIZE); // a failed decryption wipes the data
+    bool (^ const decryptCopy)(const CryptoChunkedCoder* const, const int, const unsigned long, const bool) = ^(const CryptoChunkedCoder* const coder, const int chunk, const unsigned long index, const bool final) {
+        xmemcpy(copy, gChunks[chunk], sizeof *copy + chunkSize(chunk));
+        return cryptoChunkedDecrypt(coder, copy, chunkSize(chunk), index, final);
     };
-    xmemcpy(chunks[0]->data, "Abcd", 5);
-    xmemcpy(chunks[1]->data, "01234", 6);
-    xmemcpy(chunks[2]->data, " ", 1);
-    xmemcpy(chunks[3]->data, "X", 1);
-    xmemcpy(chunks[4]->data, "\xff\x05\x00", 3);
-
-    cryptoStreamEncrypt(&encoder, chunks[0], 5);
-    cryptoStreamEncrypt(&encoder, chunks[1], 6);
-    cryptoStreamEncrypt(&encoder, chunks[2], 1);
-    cryptoStreamEncrypt(&encoder, chunks[3], 1);
-    cryptoStreamEncrypt(&encoder, chunks[4], 3);
-
-    assert(cryptoStreamDecrypt(&decoder, chunks[0], 5));
-    assert(!xmemcmp(chunks[0]->data, "Abcd", 5));
-    assert(cryptoStreamDecrypt(&decoder, chunks[1], 6));
-    assert(!xmemcmp(chunks[1]->data, "01234", 6));
-    assert(cryptoStreamDecrypt(&decoder, chunks[2], 1));
-    assert(!xmemcmp(chunks[2]->data, " ", 1));
-    assert(cryptoStreamDecrypt(&decoder, chunks[3], 1));
-    assert(!xmemcmp(chunks[3]->data, "X", 1));
-    assert(cryptoStreamDecrypt(&decoder, chunks[4], 3));
-    assert(!xmemcmp(chunks[4]->data, "\xff\x05\x00", 3));
+
+    assert(!decryptCopy(&gChunkedDecoder, 1, 2, false)); // moved
+    assert(!decryptCopy(&gChunkedDecoder, CHUNKS - 2, CHUNKS - 2, true)); // truncated
+    assert(!decryptCopy(&gChunkedDecoder, CHUNKS - 1, CHUNKS - 1, false)); // extended
+
+    gChunks[3]->data[7] ^= 1;
+    assert(!decryptCopy(&gChunkedDecoder, 3, 3, false)); // tampered
+    gChunks[3]->data[7] ^= 1;
+
+    CryptoChunkedCoder otherDecoder;
+    header._[0] ^= 1;
+    cryptoChunkedCreateDecoder(&otherDecoder, &header, &key);
+    assert(!decryptCopy(&otherDecoder, 0, 0, false)); // another file
+    cryptoChunkedDestroyCoder(&otherDecoder);
+    xfree(copy);
+
+    pthread_t threads[CHUNK_THREADS];
+    for (long i = 0; i < CHUNK_THREADS; i++)
+        assert(!pthread_create(threads + i, nullptr, decryptChunks, (void*) i));
+    for (int i = 0; i < CHUNK_THREADS; i++)
+        assert(!pthread_join(threads[i], nullptr));
+
+    for (int i = 0; i < CHUNKS; xfree(gChunks[i]), i++);
+    cryptoChunkedDestroyCoder(&gChunkedDecoder);
+
+    CryptoChunkedEncryptedBundle empty;
+    cryptoChunkedCreateEncoder(&encoder, &header, &key);
+    cryptoChunkedEncrypt(&encoder, &empty, 0, 0, true); // an empty file still has its final chunk, so it can't be confused with a truncated one
+    assert(cryptoChunkedDecrypt(&encoder, &empty, 0, 0, true));
+    assert(!cryptoChunkedDecrypt(&encoder, &empty, 0, 0, false));
+    cryptoChunkedDestroyCoder(&encoder);
 }
 
 static void nonce(void) {
@@ -138,7 +254,9 @@ void testCrypto(void) {
     sign();
     seal();
     singleCrypt();
+    scatteredCrypt();
     streamCrypt();
+    chunkedCrypt();
     nonce();
     base64();
     padding();
@@ -0,0 +1,78 @@
+
+#include "../src/defs.h"
+
+enum : int {DATA_SIZE = 5000};
+static byte gData[DATA_SIZE];
+
+static const struct {
+    int size;
+    unsigned long seed, hash;
+} VECTORS[] = { // produced by the reference xxh3 implementation, cover every length class
+        {0, 0, 0x2d06800538d394c2ul},
+        {1, 0, 0x4c5cca45d0f4811ful},
+        {3, 0, 0x15f7093b173d005cul},
+        {4, 0, 0xdca012f95811b6b9ul},
+        {8, 0, 0xdec6a9a43575982eul},
+        {9, 0, 0xcbe393399f17ffbdul},
+        {16, 0, 0x7e484c18d74895d0ul},
+        {17, 0, 0x208bde5ee2bed407ul},
+        {100, 0, 0x8c97158042fbf926ul},
+        {128, 0, 0xf92b70eaa21a6288ul},
+        {129, 0, 0xf8f76713f2bb60faul},
+        {240, 0, 0xccc7375172c41f03ul},
+        {241, 0, 0x0b3b630948ce4a00ul},
+        {1024, 0, 0x23bc880ebf0d29c6ul},
+        {1025, 0, 0xc09fdfbc398c7d82ul},
+        {4999, 0, 0x00710881668d48ebul},
+        {0, 0x9e3779b97f4a7c15ul, 0x602b0e2cd6662c8bul},
+        {1, 0x9e3779b97f4a7c15ul, 0x2f3acd3805f81de3ul},
+        {3, 0x9e3779b97f4a7c15ul, 0x079dd5d54d89480aul},
+        {4, 0x9e3779b97f4a7c15ul, 0x1a246e2efb9c9b2eul},
+        {8, 0x9e3779b97f4a7c15ul, 0x19ef7d3919108afful},
+        {9, 0x9e3779b97f4a7c15ul, 0x9c98d3e24dc54d34ul},
+        {16, 0x9e3779b97f4a7c15ul, 0xa106510078b0a252ul},
+        {17, 0x9e3779b97f4a7c15ul, 0x0b2caf8bf9648efful},
+        {100, 0x9e3779b97f4a7c15ul, 0xa0f79a4ca977f3f1ul},
+        {128, 0x9e3779b97f4a7c15ul, 0x95425530beb89fe8ul},
+        {129, 0x9e3779b97f4a7c15ul, 0x29fa850b97ed9666ul},
+        {240, 0x9e3779b97f4a7c15ul, 0x2d882e7899ff64ccul},
+        {241, 0x9e3779b97f4a7c15ul, 0x422e82e8913e49e0ul},
+        {1024, 0x9e3779b97f4a7c15ul, 0x7e249adc60e1f9b4ul},
+        {1025, 0x9e3779b97f4a7c15ul, 0x16cfe055154ff1ddul},
+        {4999, 0x9e3779b97f4a7c15ul, 0xfc5dc94bed0a8103ul}
+};
+
+static void oneShot(void) {
+    for (int i = 0; i < (int) arraySize(VECTORS); i++)
+        assert(hashValueLongSeeded(gData, VECTORS[i].size, VECTORS[i].seed) == VECTORS[i].hash);
+
+    assert(hashValueLong(gData, 100) == VECTORS[8].hash);
+    assert(hashPrimitiveLong(1l) != hashPrimitiveLong(2l));
+}
+
+static void streaming(void) {
+    const int chunkSizes[] = {1, 3, 63, 64, 65, 255, 256, 257, 1000, DATA_SIZE};
+    HashState state;
+
+    for (int i = 0; i < (int) arraySize(VECTORS); i++) {
+        for (int j = 0; j < (int) arraySize(chunkSizes); j++) {
+            hashStateInit(&state, VECTORS[i].seed);
+            for (int offset = 0; offset < VECTORS[i].size; offset += chunkSizes[j])
+                hashStateUpdate(&state, gData + offset, min(chunkSizes[j], VECTORS[i].size - offset));
+            assert(hashStateDigest(&state) == VECTORS[i].hash);
+        }
+    }
+
+    hashStateInit(&state, 7); // digesting midway doesn't disturb the state
+    for (int size = 0; size < DATA_SIZE; size += 97) {
+        assert(hashStateDigest(&state) == hashValueLongSeeded(gData, size, 7));
+        hashStateUpdate(&state, gData + size, min(97, DATA_SIZE - size));
+    }
+    assert(hashStateDigest(&state) == hashValueLongSeeded(gData, DATA_SIZE, 7));
+}
+
+void testDefsHash(void) {
+    for (int i = 0; i < DATA_SIZE; i++) gData[i] = (byte) (i * 31 + 7);
+    oneShot();
+    streaming();
+}
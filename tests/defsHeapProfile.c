@@ -0,0 +1,73 @@
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "../src/defs.h"
+
+static const int ALLOCATIONS = 100, SIZE = 1000;
+static const int THREADS = 4, CHURN = 100'000;
+
+static long heldBytes(void) { // sums up the folded profile
+    const int fileDescriptor = memfd_create("heapProfile", 0);
+    assert(fileDescriptor >= 0);
+    dumpHeapProfile(fileDescriptor, true);
+    assert(!lseek(fileDescriptor, 0, SEEK_SET));
+
+    FILE* const file = fdopen(fileDescriptor, "r");
+    assert(file);
+
+    long total = 0, bytes;
+    char site[0xff];
+    while (fscanf(file, "%254s %ld", site, &bytes) == 2) {
+        assert(bytes > 0);
+        total += bytes;
+    }
+
+    fclose(file);
+    return total;
+}
+
+static void* nullable churn(void* const) { // libc tends to hand the just freed chunks right back, to this and to the other threads, so tracked addresses get reused at once
+    for (int i = 0; i < CHURN; i++) {
+        void* const memory = xmalloc(16);
+        if (i % 2) xfree(memory);
+        else xfree(xrealloc(memory, 32));
+    }
+    return nullptr;
+}
+
+static void concurrentReuse(void) {
+    const long initial = heldBytes();
+
+    pthread_t threads[THREADS];
+    for (int i = 0; i < THREADS; i++)
+        assert(!pthread_create(threads + i, nullptr, churn, nullptr));
+    for (int i = 0; i < THREADS; i++)
+        assert(!pthread_join(threads[i], nullptr));
+
+    assert(heldBytes() == initial);
+}
+
+void testDefsHeapProfile(void) {
+    const long initial = heldBytes();
+
+    void* allocations[ALLOCATIONS];
+    for (int i = 0; i < ALLOCATIONS; allocations[i++] = xmalloc(SIZE));
+    assert(heldBytes() - initial == (long) ALLOCATIONS * SIZE);
+
+    allocations[0] = xrealloc(allocations[0], SIZE * 2);
+    assert(heldBytes() - initial == (long) (ALLOCATIONS + 1) * SIZE);
+
+    for (int i = 0; i < ALLOCATIONS; xfree(allocations[i++]));
+    assert(heldBytes() == initial);
+
+    concurrentReuse();
+
+    dumpHeapProfile(STDOUT_FILENO, false);
+    dumpHeapProfileIfRequested(); // nothing requested
+    assert(!raise(SIGUSR1));
+    dumpHeapProfileIfRequested(); // to stderr
+}
@@ -7,6 +7,24 @@ void testCrypto(void);
 void testCollectionsList(void);
 void testCollectionsDeque(void);
 void testCollectionsHashtable(void);
+void testCollectionsBlockDeque(void);
+void testCollectionsTreeMap(void);
+void testCollectionsBPlusTreeMap(void);
+void testCollectionsMpmcQueue(void);
+void testUtilsPoolAllocator(void);
+void testUtilsArenaAllocator(void);
+void testDefsHeapProfile(void);
+void testDefsHash(void);
+void testUtilsRwMutex(void);
+void testUtilsBarrier(void);
+void testUtilsConditionObserver(void);
+void testCollectionsWorkStealingDeque(void);
+void testUtilsExecutor(void);
+void testUtilsTimerWheel(void);
+void testUtilsCoroutine(void);
+void testUtilsReactor(void);
+void testUtilsAsyncIo(void);
+void testCollectionsSpillingQueue(void);
 
 int main(const int argc, const char* const* const argv) {
     assert(argc == 2);
@@ -17,6 +35,24 @@ int main(const int argc, const char* const* const argv) {
         case 1: testCollectionsList(); break;
         case 2: testCollectionsDeque(); break;
         case 3: testCollectionsHashtable(); break;
+        case 4: testCollectionsBlockDeque(); break;
+        case 5: testCollectionsTreeMap(); break;
+        case 6: testCollectionsBPlusTreeMap(); break;
+        case 7: testCollectionsMpmcQueue(); break;
+        case 8: testUtilsPoolAllocator(); break;
+        case 9: testUtilsArenaAllocator(); break;
+        case 10: testDefsHeapProfile(); break;
+        case 11: testDefsHash(); break;
+        case 12: testUtilsRwMutex(); break;
+        case 13: testUtilsBarrier(); break;
+        case 14: testUtilsConditionObserver(); break;
+        case 15: testCollectionsWorkStealingDeque(); break;
+        case 16: testUtilsExecutor(); break;
+        case 17: testUtilsTimerWheel(); break;
+        case 18: testUtilsCoroutine(); break;
+        case 19: testUtilsReactor(); break;
+        case 20: testUtilsAsyncIo(); break;
+        case 21: testCollectionsSpillingQueue(); break;
         default: assert(false);
     }
 
@@ -0,0 +1,108 @@
+
+#include "../src/utils/arenaAllocator.h"
+#include "../src/collections/treeMap.h"
+
+static const int CHUNK_SIZE = 256;
+static ArenaAllocator* gArena = nullptr;
+
+static void bump(void) {
+    gArena = arenaCreate(CHUNK_SIZE);
+    const Allocator* const allocator = arenaAllocator(gArena);
+
+    byte* objects[100]; // spans many chunks
+    for (int i = 0; i < 100; i++) {
+        objects[i] = allocator->malloc((unsigned long) i + 1);
+        assert(!((unsigned long) objects[i] % 16));
+        xmemset(objects[i], i, (unsigned long) i + 1);
+    }
+
+    for (int i = 0; i < 100; i++)
+        for (int j = 0; j <= i; j++)
+            assert(objects[i][j] == i); // no overlapping
+
+    byte* const big = allocator->malloc(CHUNK_SIZE * 4); // gets a dedicated chunk
+    xmemset(big, 1, CHUNK_SIZE * 4);
+
+    byte* const zeroed = allocator->calloc(4, 8);
+    for (int i = 0; i < 32; assert(!zeroed[i++]));
+    allocator->free(zeroed);
+
+    arenaDestroy(gArena);
+}
+
+static void reallocation(void) {
+    gArena = arenaCreate(CHUNK_SIZE);
+    const Allocator* const allocator = arenaAllocator(gArena);
+
+    int* const latest = allocator->realloc(nullptr, sizeof(int));
+    *latest = 7;
+    assert(allocator->realloc(latest, sizeof(int) * 32) == latest); // the latest allocation grows in place
+    for (int i = 1; i < 32; latest[i] = i, i++);
+
+    int* const other = allocator->malloc(sizeof(int));
+    int* const moved = allocator->realloc(latest, sizeof(int) * 40); // not the latest anymore
+    assert(moved != latest && moved != other && moved[0] == 7);
+    for (int i = 1; i < 32; i++) assert(moved[i] == i);
+
+    assert(allocator->realloc(other, 1) == other);
+    int* const grown = allocator->realloc(moved, CHUNK_SIZE * 2); // doesn't fit into the chunk
+    assert(grown[0] == 7 && grown[31] == 31);
+    assert(!allocator->realloc(grown, 0));
+
+    arenaDestroy(gArena);
+}
+
+static void scopes(void) {
+    gArena = arenaCreate(CHUNK_SIZE);
+    const Allocator* const allocator = arenaAllocator(gArena);
+
+    void* const outer = allocator->malloc(16);
+    void* inner;
+    {
+        arenaScope(gArena);
+        inner = allocator->malloc(16);
+        {
+            arenaScope(gArena);
+            for (int i = 0; i < 100; allocator->malloc(64), i++); // several chunks
+        }
+        assert(allocator->malloc(16) != inner); // only the innermost scope has been released
+    }
+    assert(allocator->malloc(16) == inner); // the space right after the outer allocation is reused
+
+    const ArenaMark mark = arenaMark(gArena);
+    void* const first = allocator->malloc(CHUNK_SIZE * 3);
+    arenaRestore(&mark);
+    assert(allocator->malloc(CHUNK_SIZE * 3) == first); // spare chunks are reused
+
+    arenaReset(gArena);
+    assert(allocator->malloc(16) == outer);
+
+    arenaDestroy(gArena);
+}
+
+static void container(void) {
+    gArena = arenaCreate(4096);
+
+    for (int round = 0; round < 3; round++) {
+        TreeMap* const map = treeMapCreate(arenaAllocator(gArena), false, nullptr);
+        for (long i = 0; i < 1000; i++)
+            treeMapInsert(map, (int) i, (void*) (i + 1));
+        for (long i = 0; i < 1000; i += 2)
+            treeMapDelete(map, (int) i);
+
+        assert(treeMapCount(map) == 500);
+        for (long i = 1; i < 1000; i += 2)
+            assert((long) treeMapSearchKey(map, (int) i) == i + 1);
+
+        arenaReset(gArena); // instead of destroying the map
+    }
+
+    arenaDestroy(gArena);
+}
+
+void testUtilsArenaAllocator(void) {
+    bump();
+    reallocation();
+    scopes();
+    container();
+}
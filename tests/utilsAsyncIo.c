@@ -0,0 +1,169 @@
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <errno.h>
+#include "../src/utils/asyncIo.h"
+
+enum : int {CHUNKS = 256, CHUNK = 64 * 1024};
+static const int DEPTH = 16, BUFFERS = 8;
+static AsyncIo* gIo = nullptr;
+static atomic int gCompleted = 0;
+static atomic int gChained = 0;
+static int gFile = -1;
+
+static void expectWhole(const long result, void* nullable const) {
+    assert(result == CHUNK);
+    gCompleted++;
+}
+
+static void waitAll(void) {
+    while (asyncIoInFlight(gIo)) asyncIoComplete(gIo, true);
+}
+
+static void fill(byte* const chunk, const int index) {
+    for (int i = 0; i < CHUNK; i++) chunk[i] = (byte) (index * 31 + i);
+}
+
+static void bulk(void) { // writes a file in batches of chunks from plain memory, then reads it back into the registered buffers
+    static byte chunks[CHUNKS][CHUNK];
+    gCompleted = 0;
+
+    for (int i = 0; i < CHUNKS; i++) {
+        fill(chunks[i], i);
+        asyncIoQueue(gIo, false, gFile, chunks[i], CHUNK, (long) i * CHUNK, expectWhole, nullptr);
+        if (i % DEPTH == DEPTH - 1) asyncIoSubmit(gIo); // a batch per syscall
+    }
+    asyncIoSubmit(gIo);
+    waitAll();
+    assert(gCompleted == CHUNKS);
+
+    byte* buffers[BUFFERS];
+    for (int i = 0; i < BUFFERS; i++) assert(buffers[i] = asyncIoAcquireBuffer(gIo));
+    assert(!asyncIoAcquireBuffer(gIo));
+
+    static byte expected[CHUNK];
+    for (int i = 0; i < CHUNKS; i += BUFFERS) {
+        for (int j = 0; j < BUFFERS; j++)
+            asyncIoQueue(gIo, true, gFile, buffers[j], CHUNK, (long) (i + j) * CHUNK, expectWhole, nullptr);
+        asyncIoSubmit(gIo);
+        waitAll();
+
+        for (int j = 0; j < BUFFERS; j++) {
+            fill(expected, i + j);
+            assert(!xmemcmp(buffers[j], expected, CHUNK));
+        }
+    }
+    assert(gCompleted == CHUNKS * 2);
+
+    for (int i = 0; i < BUFFERS; i++) asyncIoReleaseBuffer(gIo, buffers[i]);
+}
+
+static void chain(const long result, void* nullable const parameter) { // queues the next read from within the callback, beyond the depth
+    assert(result == CHUNK);
+    const long next = (long) parameter + 1;
+    if (++gChained >= CHUNKS * 2) return;
+
+    static byte sink[CHUNK];
+    for (int i = 0; i < 2; i++) // two for one, so it fills up
+        asyncIoQueue(gIo, true, gFile, sink, CHUNK, (next % CHUNKS) * CHUNK, chain, (void*) next);
+    asyncIoSubmit(gIo);
+}
+
+static void chained(void) {
+    gChained = 0;
+    static byte sink[CHUNK];
+    asyncIoQueue(gIo, true, gFile, sink, CHUNK, 0, chain, (void*) 0l);
+    asyncIoSubmit(gIo);
+    waitAll();
+    assert(gChained >= CHUNKS * 2);
+}
+
+static void store(const long result, void* nullable const parameter) {
+    *(long*) parameter = result;
+}
+
+static void edges(void) {
+    static byte buffer[CHUNK];
+    long result = 1;
+
+    asyncIoQueue(gIo, true, gFile, buffer, CHUNK, (long) CHUNKS * CHUNK, store, &result); // at the end of the file
+    asyncIoSubmit(gIo);
+    waitAll();
+    assert(!result);
+
+    const int closed = dup(gFile);
+    close(closed);
+    asyncIoQueue(gIo, true, closed, buffer, CHUNK, 0, store, &result);
+    asyncIoSubmit(gIo);
+    waitAll();
+    assert(result == -EBADF);
+}
+
+static atomic int gHolding = 0; // 1 while the callback holds the reaping, 2 once it's let go
+
+static void hold(const long result, void* nullable const) {
+    assert(result == CHUNK);
+    gHolding = 1;
+    while (gHolding == 1) xyield();
+}
+
+static void* nullable reapConcurrently(void* nullable const) {
+    while (asyncIoInFlight(gIo)) asyncIoComplete(gIo, true);
+    return nullptr;
+}
+
+static bool signalled(void) {
+    return poll(&(struct pollfd) {asyncIoEventFileDescriptor(gIo), POLLIN, 0}, 1, 0) > 0;
+}
+
+static void contended(void) { // the eventfd is drained by a thread that finds another one reaping, the completion is still handled by the latter
+    static byte buffer[CHUNK];
+    gHolding = 0;
+    gCompleted = 0;
+
+    asyncIoQueue(gIo, true, gFile, buffer, CHUNK, 0, hold, nullptr);
+    asyncIoSubmit(gIo);
+
+    pthread_t reaper;
+    assert(!pthread_create(&reaper, nullptr, reapConcurrently, nullptr));
+    while (!gHolding) xyield();
+
+    asyncIoQueue(gIo, true, gFile, buffer, CHUNK, CHUNK, expectWhole, nullptr);
+    asyncIoSubmit(gIo);
+    while (!signalled()) xyield();
+
+    assert(!asyncIoComplete(gIo, false));
+    assert(!signalled() && !gCompleted);
+
+    gHolding = 2;
+    assert(!pthread_join(reaper, nullptr));
+    assert(gCompleted == 1 && !asyncIoInFlight(gIo));
+}
+
+static void run(const int flags) {
+    char path[] = "/tmp/klenaloAsyncIoXXXXXX";
+    assert((gFile = mkstemp(path)) >= 0);
+    unlink(path);
+
+    Executor* const executor = executorCreate(2, "asyncIo");
+    gIo = asyncIoCreate(DEPTH, BUFFERS, CHUNK, executor, flags);
+    assert(asyncIoBufferSize(gIo) == CHUNK);
+    assert(asyncIoRing(gIo) == (asyncIoEventFileDescriptor(gIo) >= 0));
+    if (flags & ASYNC_IO_FLAG_NO_RING) assert(!asyncIoRing(gIo));
+
+    bulk();
+    chained();
+    edges();
+    if (asyncIoRing(gIo)) contended();
+
+    asyncIoDestroy(gIo);
+    executorDestroy(executor);
+    close(gFile);
+}
+
+void testUtilsAsyncIo(void) {
+    run(ASYNC_IO_FLAG_NONE);
+    run(ASYNC_IO_FLAG_NO_RING);
+}
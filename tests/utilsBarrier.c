@@ -0,0 +1,89 @@
+
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+#include "../src/utils/barrier.h"
+
+static const int THREADS = 4, ITERATIONS = 100'000, TIMEOUT = 20;
+static BARRIER(gBarrier);
+static long gCounter = 0; // guarded by gBarrier
+
+static long millisSince(const struct timespec* const start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000 + (now.tv_nsec - start->tv_nsec) / 1'000'000;
+}
+
+static void scopes(void) {
+    assert(!barrierScopeBegin(&gBarrier));
+    assert(barrierScopeBegin(&gBarrier)); // skipped while taken
+    barrierScopeEnd(&gBarrier);
+    assert(!barrierScopeBegin(&gBarrier));
+    barrierReset(&gBarrier);
+    assert(!gBarrier);
+}
+
+static void timeout(void) {
+    assert(!barrierScopeBegin(&gBarrier));
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    assert(!barrierWaitTimeout(&gBarrier, TIMEOUT));
+    assert(millisSince(&start) >= TIMEOUT);
+
+    barrierScopeEnd(&gBarrier);
+    assert(barrierWaitTimeout(&gBarrier, TIMEOUT));
+    barrierScopeEnd(&gBarrier);
+}
+
+static void* nullable waitAndTake(void* const) {
+    barrierWait(&gBarrier);
+    gCounter++;
+    barrierScopeEnd(&gBarrier);
+    return nullptr;
+}
+
+static void wakeUp(void) {
+    gCounter = 0;
+    assert(!barrierScopeBegin(&gBarrier));
+
+    pthread_t threads[THREADS];
+    for (int i = 0; i < THREADS; i++)
+        assert(!pthread_create(threads + i, nullptr, waitAndTake, nullptr));
+    usleep(TIMEOUT * 1000); // let them fall asleep
+
+    assert(!gCounter);
+    barrierScopeEnd(&gBarrier); // every one of them gets woken in turn
+
+    for (int i = 0; i < THREADS; i++)
+        assert(!pthread_join(threads[i], nullptr));
+    assert(gCounter == THREADS && !gBarrier);
+}
+
+static void* nullable contend(void* const) {
+    for (int i = 0; i < ITERATIONS; i++) {
+        barrierWait(&gBarrier);
+        gCounter++;
+        barrierScopeEnd(&gBarrier);
+    }
+    return nullptr;
+}
+
+static void concurrent(void) {
+    gCounter = 0;
+
+    pthread_t threads[THREADS];
+    for (int i = 0; i < THREADS; i++)
+        assert(!pthread_create(threads + i, nullptr, contend, nullptr));
+    for (int i = 0; i < THREADS; i++)
+        assert(!pthread_join(threads[i], nullptr));
+
+    assert(gCounter == (long) THREADS * ITERATIONS && !gBarrier);
+}
+
+void testUtilsBarrier(void) {
+    scopes();
+    timeout();
+    wakeUp();
+    concurrent();
+}
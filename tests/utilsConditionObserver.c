@@ -0,0 +1,82 @@
+
+#include <pthread.h>
+#include <unistd.h>
+#include "../src/utils/conditionObserver.h"
+
+static const int TARGET = 1000, TIMEOUT = 20;
+static ConditionObserver* gObserver = nullptr;
+static int gVariable = 0;
+
+static void values(void) {
+    long longVariable = 0;
+    ConditionObserver* const observer = conditionObserverCreate(&longVariable, CONDITION_OBSERVER_VARIABLE_TYPE_LONG);
+
+    const long value = 0x1122334455667788l;
+    conditionObserverSetVariableValue(observer, &value);
+    assert(longVariable == value);
+
+    long buffer = 0;
+    conditionObserverGetVariableValue(observer, &buffer);
+    assert(buffer == value);
+
+    conditionObserverWaitForVariableValue(observer, &value); // already equal
+    conditionObserverDestroy(observer);
+
+    bool flag = false;
+    ConditionObserver* const flagObserver = conditionObserverCreate(&flag, CONDITION_OBSERVER_VARIABLE_TYPE_BOOL);
+    conditionObserverSetVariableValue(flagObserver, &(bool) {true});
+    assert(flag);
+    conditionObserverDestroy(flagObserver);
+}
+
+static void timeout(void) {
+    gVariable = 0;
+    gObserver = conditionObserverCreate(&gVariable, CONDITION_OBSERVER_VARIABLE_TYPE_INT);
+
+    assert(!conditionObserverWaitForVariableValueTimeout(gObserver, &(int) {1}, TIMEOUT));
+    assert(!conditionObserverWaitFor(gObserver, ^ bool (const void* const value) { return *(const int*) value < 0; }, 0));
+
+    conditionObserverDestroy(gObserver);
+}
+
+static void* nullable increment(void* const) {
+    for (int i = 1; i <= TARGET; i++) {
+        if (i == TARGET / 2) usleep(TIMEOUT * 1000); // so the waiters give up spinning and sleep
+        conditionObserverSetVariableValue(gObserver, &i);
+    }
+    return nullptr;
+}
+
+static void* nullable waitHalf(void* const) {
+    assert(conditionObserverWaitFor(gObserver, ^ bool (const void* const value) { return *(const int*) value >= TARGET / 2; }, FUTEX_WAIT_FOREVER));
+    return nullptr;
+}
+
+static void* nullable waitTarget(void* const) {
+    conditionObserverWaitForVariableValue(gObserver, &TARGET);
+    return nullptr;
+}
+
+static void wakeUp(void) {
+    gVariable = 0;
+    gObserver = conditionObserverCreate(&gVariable, CONDITION_OBSERVER_VARIABLE_TYPE_INT);
+
+    pthread_t half, target, incrementer;
+    assert(!pthread_create(&half, nullptr, waitHalf, nullptr));
+    assert(!pthread_create(&target, nullptr, waitTarget, nullptr));
+    usleep(TIMEOUT * 1000);
+    assert(!pthread_create(&incrementer, nullptr, increment, nullptr));
+
+    assert(!pthread_join(half, nullptr));
+    assert(!pthread_join(target, nullptr));
+    assert(!pthread_join(incrementer, nullptr));
+    assert(gVariable == TARGET);
+
+    conditionObserverDestroy(gObserver);
+}
+
+void testUtilsConditionObserver(void) {
+    values();
+    timeout();
+    wakeUp();
+}
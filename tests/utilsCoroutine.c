@@ -0,0 +1,97 @@
+
+#include "../src/utils/coroutine.h"
+
+enum : int {COROUTINES = 10'000};
+static const int STEPS = 10, SMALL_STACK = 8 * 1024;
+static long gValue = 0;
+static int gFinished = 0;
+
+static void generate(void* nullable const parameter) { // yields the numbers up to the parameter through gValue
+    assert(coroutineCurrent());
+    for (long i = 1; i <= (long) parameter; i++) {
+        gValue = i;
+        coroutineYield();
+    }
+}
+
+static void generator(void) {
+    Coroutine* const coroutine = coroutineCreate(generate, (void*) 5l, 0);
+    assert(!coroutineCurrent() && !coroutineFinished(coroutine));
+
+    long sum = 0;
+    while (coroutineResume(coroutine)) sum += gValue;
+
+    assert(sum == 15 && coroutineFinished(coroutine) && !coroutineCurrent());
+    coroutineDestroy(coroutine);
+}
+
+static void outer(void* nullable const) { // resumes a coroutine of its own, the inner one yields back here rather than to the main stack
+    Coroutine* const self = coroutineCurrent();
+    Coroutine* const inner = coroutineCreate(generate, (void*) 3l, 0);
+
+    while (coroutineResume(inner)) {
+        assert(coroutineCurrent() == self);
+        gValue *= 10;
+        coroutineYield();
+    }
+
+    coroutineDestroy(inner);
+}
+
+static void nested(void) {
+    Coroutine* const coroutine = coroutineCreate(outer, nullptr, 0);
+
+    for (long expected = 10; coroutineResume(coroutine); expected += 10)
+        assert(gValue == expected);
+
+    coroutineDestroy(coroutine);
+}
+
+static long recurse(const int depth) { // uses the stack for real so the frames of different coroutines would collide if they shared one
+    volatile byte frame[64];
+    frame[0] = (byte) depth;
+    if (!(depth % 10)) coroutineYield();
+    return depth ? frame[0] + recurse(depth - 1) : 0;
+}
+
+static void step(void* nullable const parameter) {
+    for (int i = 0; i < STEPS; i++) {
+        assert(recurse(20) == 210);
+        *(int*) parameter += 1;
+        coroutineYield();
+    }
+    gFinished++;
+}
+
+static void many(void) { // round robin over lots of suspended coroutines with small stacks
+    static Coroutine* coroutines[COROUTINES];
+    static int counters[COROUTINES];
+
+    for (int i = 0; i < COROUTINES; i++)
+        coroutines[i] = coroutineCreate(step, counters + i, SMALL_STACK);
+
+    for (int alive = COROUTINES; alive;) {
+        alive = 0;
+        for (int i = 0; i < COROUTINES; i++)
+            if (!coroutineFinished(coroutines[i])) alive += coroutineResume(coroutines[i]);
+    }
+
+    assert(gFinished == COROUTINES);
+    for (int i = 0; i < COROUTINES; i++) {
+        assert(counters[i] == STEPS);
+        coroutineDestroy(coroutines[i]);
+    }
+}
+
+static void abandoned(void) { // destroyed while suspended
+    Coroutine* const coroutine = coroutineCreate(generate, (void*) 100l, 0);
+    assert(coroutineResume(coroutine) && coroutineResume(coroutine) && gValue == 2);
+    coroutineDestroy(coroutine);
+}
+
+void testUtilsCoroutine(void) {
+    generator();
+    nested();
+    many();
+    abandoned();
+}
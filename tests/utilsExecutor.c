@@ -0,0 +1,102 @@
+
+#include <unistd.h>
+#include <time.h>
+#include "../src/utils/executor.h"
+
+static const int THREADS = 4, TASKS = 100'000, FAN_OUT = 100, SLEEP_MICROS = 20'000, DEADLINE_MILLIS = 10'000;
+static Executor* gExecutor = nullptr;
+static atomic long gSum = 0;
+static atomic int gDone = 0;
+static atomic int gStarted = 0;
+
+static long millisSince(const struct timespec* const start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000 + (now.tv_nsec - start->tv_nsec) / 1'000'000;
+}
+
+static void add(void* nullable const parameter) {
+    gSum += (long) parameter;
+    gDone++;
+}
+
+static void waitDone(const int amount) {
+    while (gDone < amount) xyield();
+}
+
+static void external(void) { // submitted from outside of the workers, through the injection queue
+    gSum = 0;
+    gDone = 0;
+
+    for (long i = 1; i <= TASKS; i++)
+        executorSubmit(gExecutor, add, (void*) i);
+
+    waitDone(TASKS);
+    assert(gSum == (long) TASKS * (TASKS + 1) / 2);
+}
+
+static void fanOut(void* nullable const) { // submitted from a worker, to its own deque, others steal
+    for (long i = 1; i <= FAN_OUT; i++)
+        executorSubmit(gExecutor, add, (void*) i);
+}
+
+static void nested(void) {
+    gSum = 0;
+    gDone = 0;
+
+    for (int i = 0; i < FAN_OUT; i++)
+        executorSubmit(gExecutor, fanOut, nullptr);
+
+    waitDone(FAN_OUT * FAN_OUT);
+    assert(gSum == (long) FAN_OUT * FAN_OUT * (FAN_OUT + 1) / 2);
+}
+
+static void busy(void* nullable const) {
+    usleep(SLEEP_MICROS);
+    gDone++;
+}
+
+static void rendezvous(void* nullable const) { // blocks till every worker has picked one up, counts only if they all did
+    gStarted++;
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (gStarted < executorThreads(gExecutor) && millisSince(&start) < DEADLINE_MILLIS) usleep(1000);
+
+    if (gStarted == executorThreads(gExecutor)) gDone++;
+}
+
+static void parallel(void) { // blocking tasks don't hold the rest up
+    gStarted = 0;
+    gDone = 0;
+    const int threads = executorThreads(gExecutor);
+
+    for (int i = 0; i < threads; i++)
+        executorSubmit(gExecutor, rendezvous, nullptr);
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (gDone < threads && millisSince(&start) < DEADLINE_MILLIS * 2) xyield();
+    assert(gDone == threads); // the first one would've given up waiting for the rest if they ran one after another
+}
+
+void testUtilsExecutor(void) {
+    gExecutor = executorCreate(0, nullptr);
+    assert(executorThreads(gExecutor) >= 1);
+    executorDestroy(gExecutor);
+
+    gExecutor = executorCreate(THREADS, "test:executor"); // more threads than cores are fine
+    assert(executorThreads(gExecutor) == THREADS);
+
+    external();
+    nested();
+    parallel();
+    external();
+
+    executorDestroy(gExecutor);
+
+    gExecutor = executorCreate(2, nullptr); // tasks still queued at destruction are dropped
+    for (int i = 0; i < 100; i++)
+        executorSubmit(gExecutor, busy, nullptr);
+    executorDestroy(gExecutor);
+}
@@ -0,0 +1,118 @@
+
+#include <pthread.h>
+#include "../src/utils/poolAllocator.h"
+#include "../src/collections/deque.h"
+
+static const int OBJECT_SIZE = 24, OBJECTS_PER_PAGE = 10; // rounded up to 32
+static const int THREADS = 4, ITERATIONS = 100'000, HELD = 100;
+static PoolAllocator* gPool = nullptr;
+
+static void reuse(void) {
+    gPool = poolAllocatorCreate(OBJECT_SIZE, OBJECTS_PER_PAGE, false, false);
+    const Allocator* const allocator = poolAllocatorAllocator(gPool);
+
+    void* objects[35]; // spans several pages
+    for (int i = 0; i < 35; i++) {
+        objects[i] = allocator->malloc(OBJECT_SIZE);
+        assert(!((unsigned long) objects[i] % 16));
+        xmemset(objects[i], i, OBJECT_SIZE);
+    }
+
+    for (int i = 0; i < 35; i++)
+        for (int j = 0; j < i; j++)
+            assert(objects[i] != objects[j]);
+
+    for (int i = 0; i < 35; i++)
+        assert(((byte*) objects[i])[OBJECT_SIZE - 1] == i); // no overlapping
+
+    void* const freed = objects[7];
+    allocator->free(freed);
+    assert(allocator->malloc(1) == freed); // the most recently freed object goes first
+
+    byte* const zeroed = allocator->calloc(2, 16);
+    for (int i = 0; i < 32; assert(!zeroed[i++]));
+
+    assert(allocator->realloc(zeroed, 32) == zeroed); // still fits
+    assert(!allocator->realloc(zeroed, 0));
+    void* const reallocated = allocator->realloc(nullptr, 8);
+    assert(reallocated == zeroed);
+    allocator->free(reallocated);
+    allocator->free(nullptr);
+
+    for (int i = 0; i < 35; allocator->free(objects[i++]));
+    poolAllocatorDestroy(gPool);
+}
+
+static void container(void) {
+    gPool = poolAllocatorCreate(64, 32, false, false); // covers both the deque and its nodes
+    Deque* const deque = dequeCreate(poolAllocatorAllocator(gPool), false, nullptr);
+
+    for (long i = 1; i <= 1000; i++)
+        dequePushBack(deque, (void*) i);
+    for (long i = 1; i <= 500; i++)
+        assert((long) dequePopFirst(deque) == i);
+    for (long i = 1001; i <= 1500; i++)
+        dequePushBack(deque, (void*) i);
+
+    assert(dequeSize(deque) == 1000);
+    for (long i = 501; i <= 1500; i++)
+        assert((long) dequePopFirst(deque) == i);
+
+    dequeDestroy(deque);
+    poolAllocatorDestroy(gPool);
+}
+
+static void* nullable churn(void* const parameter) {
+    const Allocator* const allocator = poolAllocatorAllocator(gPool);
+    const long thread = (long) parameter;
+    long* held[HELD];
+
+    for (int i = 0; i < HELD; i++) {
+        held[i] = allocator->malloc(sizeof(long));
+        *held[i] = thread;
+    }
+
+    for (int i = 0; i < ITERATIONS; i++) {
+        long** const slot = held + i % HELD;
+        assert(**slot == thread); // nobody else has been handed this object meanwhile
+        allocator->free(*slot);
+        *slot = allocator->malloc(sizeof(long));
+        **slot = thread;
+    }
+
+    for (int i = 0; i < HELD; allocator->free(held[i++]));
+    return nullptr;
+}
+
+static void concurrent(const bool threadCached) {
+    gPool = poolAllocatorCreate(OBJECT_SIZE, OBJECTS_PER_PAGE, true, threadCached);
+
+    pthread_t threads[THREADS];
+    for (long i = 0; i < THREADS; i++)
+        assert(!pthread_create(threads + i, nullptr, churn, (void*) i));
+    for (int i = 0; i < THREADS; i++)
+        assert(!pthread_join(threads[i], nullptr));
+
+    poolAllocatorDestroy(gPool);
+}
+
+static void recreated(void) { // a new pool takes over the cache slot of a destroyed one
+    for (int i = 0; i < 3; i++) {
+        gPool = poolAllocatorCreate(OBJECT_SIZE, OBJECTS_PER_PAGE, true, true);
+        const Allocator* const allocator = poolAllocatorAllocator(gPool);
+
+        void* objects[100];
+        for (int j = 0; j < 100; objects[j++] = allocator->malloc(OBJECT_SIZE));
+        for (int j = 0; j < 100; allocator->free(objects[j++]));
+
+        poolAllocatorDestroy(gPool);
+    }
+}
+
+void testUtilsPoolAllocator(void) {
+    reuse();
+    container();
+    concurrent(false);
+    concurrent(true);
+    recreated();
+}
@@ -0,0 +1,98 @@
+
+#include <pthread.h>
+#include <unistd.h>
+#include "../src/utils/reactor.h"
+
+static const int PIPES = 100, MESSAGES = 1'000;
+static Reactor* gReactor = nullptr;
+static int gPipe[2] = {};
+static int gEvents = 0, gCalls = 0;
+static long gReceived = 0;
+
+static void record(const int fileDescriptor, const int events, void* nullable const parameter) {
+    assert(fileDescriptor == gPipe[0] && parameter == &gEvents);
+    gEvents = events;
+    gCalls++;
+}
+
+static void readiness(void) {
+    gReactor = reactorCreate();
+    assert(!pipe(gPipe));
+
+    reactorWatch(gReactor, gPipe[0], REACTOR_EVENT_READABLE, record, &gEvents);
+    assert(reactorWatched(gReactor) == 1);
+    assert(!reactorRunOnce(gReactor, 0) && !gCalls); // nothing to read
+
+    assert(write(gPipe[1], "x", 1) == 1);
+    assert(reactorRunOnce(gReactor, 0) == 1 && gCalls == 1 && gEvents == REACTOR_EVENT_READABLE);
+    assert(reactorRunOnce(gReactor, 0) == 1 && gCalls == 2); // level-triggered - still unread
+
+    char buffer;
+    assert(read(gPipe[0], &buffer, 1) == 1);
+    assert(!reactorRunOnce(gReactor, 0) && gCalls == 2);
+
+    reactorWatch(gReactor, gPipe[0], REACTOR_EVENT_READABLE | REACTOR_EVENT_ONE_SHOT, record, &gEvents); // replaces the previous one
+    assert(reactorWatched(gReactor) == 1);
+    assert(write(gPipe[1], "x", 1) == 1);
+    assert(reactorRunOnce(gReactor, 0) == 1 && gCalls == 3);
+    assert(!reactorWatched(gReactor) && !reactorRunOnce(gReactor, 0)); // removed though still readable
+
+    reactorWatch(gReactor, gPipe[0], REACTOR_EVENT_READABLE, record, &gEvents); // and can be watched again
+    assert(reactorRunOnce(gReactor, 0) == 1 && gCalls == 4);
+    assert(reactorUnwatch(gReactor, gPipe[0]) && !reactorUnwatch(gReactor, gPipe[0]));
+    assert(!reactorRunOnce(gReactor, 0) && gCalls == 4);
+
+    reactorWatch(gReactor, gPipe[0], REACTOR_EVENT_READABLE, record, &gEvents);
+    assert(read(gPipe[0], &buffer, 1) == 1);
+    close(gPipe[1]);
+    assert(reactorRunOnce(gReactor, 0) == 1 && gEvents & REACTOR_EVENT_CLOSED);
+
+    assert(reactorUnwatch(gReactor, gPipe[0]));
+    close(gPipe[0]);
+    reactorDestroy(gReactor);
+}
+
+static void drain(const int fileDescriptor, const int, void* nullable const) {
+    long value;
+    assert(read(fileDescriptor, &value, sizeof value) == sizeof value);
+    gReceived += value; // only the reactor's thread touches it
+}
+
+static void* nullable runReactor(void* nullable const) {
+    reactorRun(gReactor);
+    return nullptr;
+}
+
+static void threaded(void) { // a reactor thread serving lots of descriptors written to from another thread
+    gReactor = reactorCreate();
+    gReceived = 0;
+
+    int pipes[PIPES][2];
+    for (int i = 0; i < PIPES; i++) {
+        assert(!pipe(pipes[i]));
+        reactorWatch(gReactor, pipes[i][0], REACTOR_EVENT_READABLE, drain, nullptr);
+    }
+
+    pthread_t thread;
+    assert(!pthread_create(&thread, nullptr, runReactor, nullptr));
+
+    for (long i = 1; i <= MESSAGES; i++)
+        assert(write(pipes[i % PIPES][1], &i, sizeof i) == sizeof i);
+
+    while (__atomic_load_n(&gReceived, __ATOMIC_RELAXED) != (long) MESSAGES * (MESSAGES + 1) / 2) usleep(1'000);
+
+    reactorStop(gReactor); // wakes it up from waiting indefinitely
+    assert(!pthread_join(thread, nullptr));
+
+    for (int i = 0; i < PIPES; i++) {
+        assert(reactorUnwatch(gReactor, pipes[i][0]));
+        close(pipes[i][0]);
+        close(pipes[i][1]);
+    }
+    reactorDestroy(gReactor);
+}
+
+void testUtilsReactor(void) {
+    readiness();
+    threaded();
+}
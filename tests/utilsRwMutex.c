@@ -0,0 +1,195 @@
+
+#include <pthread.h>
+#include <unistd.h>
+#include "../src/utils/rwMutex.h"
+
+static const int THREADS = 4, ITERATIONS = 100'000, WRITE_EVERY = 10;
+static RWMutex* gRWMutex = nullptr;
+static atomic int gOrder = 0;
+static long gCounter = 0; // guarded by gRWMutex, written in pairs of increments so readers can spot torn updates
+static long gPair[2] = {}; // guarded by gRWMutex, always holds opposite values outside of writes
+
+static void plain(void) {
+    gRWMutex = rwMutexCreate(RW_MUTEX_FLAG_NONE);
+    assert(!rwMutexLocked(gRWMutex));
+
+    rwMutexReadLock(gRWMutex);
+    rwMutexReadLock(gRWMutex); // no writer waits, so it's fine even without the recursive flag
+    assert(rwMutexLocked(gRWMutex));
+    rwMutexReadUnlock(gRWMutex);
+    rwMutexReadUnlock(gRWMutex);
+    assert(!rwMutexLocked(gRWMutex));
+
+    rwMutexCommand(gRWMutex, RW_MUTEX_COMMAND_WRITE_LOCK);
+    assert(rwMutexLocked(gRWMutex));
+    rwMutexCommand(gRWMutex, RW_MUTEX_COMMAND_WRITE_UNLOCK);
+    assert(!rwMutexLocked(gRWMutex));
+
+    rwMutexDestroy(gRWMutex);
+}
+
+static void recursive(void) {
+    gRWMutex = rwMutexCreate(RW_MUTEX_FLAG_RECURSIVE | RW_MUTEX_FLAG_STATISTICS);
+
+    rwMutexWriteLock(gRWMutex);
+    rwMutexWriteLock(gRWMutex);
+    rwMutexReadLock(gRWMutex); // under its own write lock
+    rwMutexReadUnlock(gRWMutex);
+    rwMutexWriteUnlock(gRWMutex);
+    assert(rwMutexLocked(gRWMutex));
+    rwMutexWriteUnlock(gRWMutex);
+    assert(!rwMutexLocked(gRWMutex));
+
+    for (int i = 0; i < 5; rwMutexReadLock(gRWMutex), i++);
+    for (int i = 0; i < 5; i++) {
+        assert(rwMutexLocked(gRWMutex));
+        rwMutexReadUnlock(gRWMutex);
+    }
+    assert(!rwMutexLocked(gRWMutex));
+
+    const RWMutexStatistics statistics = rwMutexStatistics(gRWMutex);
+    assert(statistics.readAcquisitions == 1 && statistics.writeAcquisitions == 1); // relocks aren't counted
+    assert(!statistics.contendedReads && !statistics.contendedWrites);
+
+    rwMutexDestroy(gRWMutex);
+}
+
+static void* nullable preferredWriter(void* const) {
+    rwMutexWriteLock(gRWMutex);
+    assert(!gOrder);
+    gOrder = 1;
+    usleep(10'000);
+    rwMutexWriteUnlock(gRWMutex);
+    return nullptr;
+}
+
+static void* nullable lateReader(void* const) {
+    rwMutexReadLock(gRWMutex);
+    assert(gOrder == 1); // the writer that came earlier went first
+    gOrder = 2;
+    rwMutexReadUnlock(gRWMutex);
+    return nullptr;
+}
+
+static void writerPreference(void) {
+    gRWMutex = rwMutexCreate(RW_MUTEX_FLAG_STATISTICS);
+    gOrder = 0;
+
+    rwMutexReadLock(gRWMutex);
+
+    pthread_t writer, reader;
+    assert(!pthread_create(&writer, nullptr, preferredWriter, nullptr));
+    usleep(50'000); // let the writer fall asleep
+    assert(!pthread_create(&reader, nullptr, lateReader, nullptr));
+    usleep(50'000);
+
+    assert(!gOrder);
+    rwMutexReadUnlock(gRWMutex);
+
+    assert(!pthread_join(writer, nullptr));
+    assert(!pthread_join(reader, nullptr));
+    assert(gOrder == 2);
+
+    const RWMutexStatistics statistics = rwMutexStatistics(gRWMutex);
+    assert(statistics.contendedWrites == 1 && statistics.contendedReads == 1);
+    assert(statistics.waitNanos >= 50'000'000ul);
+
+    rwMutexDestroy(gRWMutex);
+}
+
+static void* nullable contend(void* const) {
+    for (int i = 0; i < ITERATIONS; i++) {
+        if (i % WRITE_EVERY) {
+            rwMutexReadLock(gRWMutex);
+            assert(!(gCounter % 2));
+            rwMutexReadUnlock(gRWMutex);
+        } else {
+            rwMutexWriteLock(gRWMutex);
+            gCounter++;
+            gCounter++;
+            rwMutexWriteUnlock(gRWMutex);
+        }
+    }
+    return nullptr;
+}
+
+static void concurrent(const int flags) {
+    gRWMutex = rwMutexCreate(flags | RW_MUTEX_FLAG_STATISTICS);
+    gCounter = 0;
+
+    pthread_t threads[THREADS];
+    for (int i = 0; i < THREADS; i++)
+        assert(!pthread_create(threads + i, nullptr, contend, nullptr));
+    for (int i = 0; i < THREADS; i++)
+        assert(!pthread_join(threads[i], nullptr));
+
+    assert(gCounter == 2l * THREADS * (ITERATIONS / WRITE_EVERY));
+
+    const RWMutexStatistics statistics = rwMutexStatistics(gRWMutex);
+    assert(statistics.writeAcquisitions == (unsigned long) THREADS * (ITERATIONS / WRITE_EVERY));
+    assert(statistics.readAcquisitions + statistics.writeAcquisitions == (unsigned long) THREADS * ITERATIONS);
+    assert(statistics.contendedReads <= statistics.readAcquisitions && statistics.contendedWrites <= statistics.writeAcquisitions);
+
+    rwMutexDestroy(gRWMutex);
+}
+
+static void* nullable writePairs(void* const) {
+    for (long i = 1; i <= ITERATIONS; i++) {
+        rwMutexWriteLock(gRWMutex);
+        gPair[0] = i;
+        gPair[1] = -i;
+        rwMutexWriteUnlock(gRWMutex);
+    }
+    return nullptr;
+}
+
+static void* nullable readPairs(void* const) {
+    for (long previous = 0, i = 0; i < ITERATIONS; i++) {
+        long first, second;
+        unsigned version;
+        do {
+            version = rwMutexOptimisticReadBegin(gRWMutex);
+            first = __atomic_load_n(gPair, __ATOMIC_RELAXED);
+            second = __atomic_load_n(gPair + 1, __ATOMIC_RELAXED);
+        } while (!rwMutexOptimisticReadValidate(gRWMutex, version));
+
+        assert(first == -second && first >= previous); // never torn, never goes back
+        previous = first;
+    }
+    return nullptr;
+}
+
+static void optimistic(void) {
+    gRWMutex = rwMutexCreate(RW_MUTEX_FLAG_OPTIMISTIC_READS | RW_MUTEX_FLAG_STATISTICS);
+
+    assert(rwMutexOptimisticRead(gRWMutex, gPair[0]) == 0);
+
+    pthread_t writer, readers[THREADS];
+    assert(!pthread_create(&writer, nullptr, writePairs, nullptr));
+    for (int i = 0; i < THREADS; i++)
+        assert(!pthread_create(readers + i, nullptr, readPairs, nullptr));
+    assert(!pthread_join(writer, nullptr));
+    for (int i = 0; i < THREADS; i++)
+        assert(!pthread_join(readers[i], nullptr));
+
+    assert(rwMutexOptimisticRead(gRWMutex, gPair[0]) == ITERATIONS);
+    assert(!rwMutexStatistics(gRWMutex).readAcquisitions); // the readers haven't touched the lock
+
+    rwMutexDestroy(gRWMutex);
+
+    gRWMutex = rwMutexCreate(RW_MUTEX_FLAG_OPTIMISTIC_READS | RW_MUTEX_FLAG_RECURSIVE);
+    rwMutexWriteLock(gRWMutex);
+    gPair[0] = 1;
+    assert(rwMutexOptimisticRead(gRWMutex, gPair[0]) == 1); // the writer reads its own writes instead of waiting for itself
+    rwMutexWriteUnlock(gRWMutex);
+    rwMutexDestroy(gRWMutex);
+}
+
+void testUtilsRwMutex(void) {
+    plain();
+    recursive();
+    writerPreference();
+    concurrent(RW_MUTEX_FLAG_NONE);
+    concurrent(RW_MUTEX_FLAG_RECURSIVE);
+    optimistic();
+}
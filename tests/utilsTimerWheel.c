@@ -0,0 +1,176 @@
+
+#include "../src/collections/spillingQueue.h"
+#include "../src/utils/timerWheel.h"
+
+enum : int {TIMERS = 10'000};
+static const int MAX_DELAY = 300'000, MAX_STEP = 5'000; // the delays span all the levels
+static const unsigned long START = 1'000'000'000; // not aligned to any of the levels
+static TimerWheel* gWheel = nullptr;
+
+static void ordering(void) {
+    gWheel = timerWheelCreate(START, nullptr);
+
+    static unsigned long ids[TIMERS];
+    for (int i = 0; i < TIMERS; i++) { // the values are the due times
+        const unsigned long due = START + (unsigned long) xrand(1, MAX_DELAY);
+        ids[i] = timerWheelSchedule(gWheel, due, 0, (void*) due);
+        assert(ids[i]);
+    }
+    assert(timerWheelCount(gWheel) == TIMERS);
+
+    int cancelled = 0;
+    for (int i = 0; i < TIMERS; i += 3, cancelled++) {
+        assert(timerWheelCancel(gWheel, ids[i]));
+        assert(!timerWheelCancel(gWheel, ids[i]));
+    }
+    assert(timerWheelCount(gWheel) == TIMERS - cancelled);
+
+    __block int fired = 0;
+    __block unsigned long previous = START, last = 0;
+
+    for (unsigned long now = START; now < START + MAX_DELAY + MAX_STEP;) {
+        now += (unsigned long) xrand(1, MAX_STEP);
+
+        timerWheelAdvance(gWheel, now, ^(void* const value, const bool periodic) {
+            const unsigned long due = (unsigned long) value;
+            assert(!periodic);
+            assert(due > previous && due <= now); // not before its time, nor an advance later
+            assert(due >= last); // in order
+            last = due;
+            fired++;
+        });
+
+        previous = now;
+    }
+
+    assert(fired == TIMERS - cancelled && !timerWheelCount(gWheel));
+    timerWheelDestroy(gWheel);
+}
+
+static void exactness(void) { // ticked one by one, every timer fires exactly at its due tick
+    gWheel = timerWheelCreate(START, nullptr);
+
+    static const unsigned long delays[] = {1, 2, 63, 64, 65, 127, 128, 4'095, 4'096, 4'097, 262'143, 262'144, 262'145, 16'777'216, 16'777'300};
+    for (int i = 0; i < (int) arraySize(delays); i++)
+        timerWheelSchedule(gWheel, START + delays[i], 0, (void*) (START + delays[i]));
+    timerWheelSchedule(gWheel, START - 100, 0, (void*) (START + 1)); // already passed, fires on the next tick
+
+    __block int fired = 0;
+    for (unsigned long now = START + 1; timerWheelCount(gWheel); now++)
+        timerWheelAdvance(gWheel, now, ^(void* const value, const bool) {
+            assert((unsigned long) value == now);
+            fired++;
+        });
+
+    assert(fired == (int) arraySize(delays) + 1);
+    timerWheelDestroy(gWheel);
+}
+
+static void expiry(void) { // jumping from one expiry to the next never skips a timer and takes a few jumps at most
+    gWheel = timerWheelCreate(START, nullptr);
+    assert(timerWheelNextExpiry(gWheel) == ~0ul);
+
+    unsigned long now = START;
+    for (int i = 0; i < 1'000; i++) {
+        const unsigned long due = now + (unsigned long) xrand(1, MAX_DELAY) * (unsigned long) xrand(1, 100);
+        const unsigned long id = timerWheelSchedule(gWheel, due, 0, (void*) due);
+        const unsigned long laterId = timerWheelSchedule(gWheel, due + (unsigned long) xrand(0, 100), 0, (void*) ~0ul); // mustn't get in the way
+
+        __block bool fired = false;
+        int jumps = 0;
+        while (!fired) {
+            now = timerWheelNextExpiry(gWheel);
+            assert(now <= due && ++jumps <= 5); // down through the four levels, plus a round at the top for the delays beyond its window
+
+            timerWheelAdvance(gWheel, now, ^(void* const value, const bool) {
+                if (value == (void*) ~0ul) return;
+                assert((unsigned long) value == due && now == due);
+                fired = true;
+            });
+        }
+        assert(!timerWheelCancel(gWheel, id));
+        timerWheelCancel(gWheel, laterId); // unless it's been due at the same tick
+    }
+
+    timerWheelDestroy(gWheel);
+}
+
+static void periodic(void) {
+    gWheel = timerWheelCreate(START, nullptr);
+
+    __block int everyTen = 0, everySeven = 0, once = 0;
+    const unsigned long tenId = timerWheelSchedule(gWheel, START + 10, 10, (void*) 10l);
+    __block unsigned long sevenId = timerWheelSchedule(gWheel, START + 7, 7, (void*) 7l);
+
+    const TimerWheelExpired expired = ^(void* const value, const bool periodic) {
+        switch ((long) value) {
+            case 10:
+                assert(periodic);
+                everyTen++;
+                break;
+            case 7:
+                assert(periodic);
+                if (++everySeven == 5) assert(timerWheelCancel(gWheel, sevenId) == (void*) 7l); // from its own callback
+                if (everySeven == 1) timerWheelSchedule(gWheel, 0, 0, (void*) 1l); // from within an advance, in the past
+                break;
+            case 1:
+                assert(!periodic);
+                once++;
+                break;
+            default:
+                assert(false);
+        }
+    };
+
+    timerWheelAdvance(gWheel, START + 1'000, expired); // at once, not drifting
+    assert(everyTen == 100 && everySeven == 5 && once == 1);
+
+    for (unsigned long now = START + 1'001; now <= START + 2'000; now++) // tick by tick
+        timerWheelAdvance(gWheel, now, expired);
+    assert(everyTen == 200);
+
+    assert(timerWheelCancel(gWheel, tenId) == (void*) 10l);
+    assert(!timerWheelCount(gWheel));
+    timerWheelDestroy(gWheel);
+}
+
+static void burst(void) { // the lifecycle's main loop pushes the due timers into a queue it drains itself afterwards, so a burst above the queue's capacity mustn't wait for room
+    enum : int {CAPACITY = 1'024, BURST = 3'000};
+
+    gWheel = timerWheelCreate(START, nullptr);
+    SpillingQueue* const queue = spillingQueueCreate(DEFAULT_ALLOCATOR, CAPACITY, nullptr);
+
+    for (long i = 1; i <= BURST; i++)
+        timerWheelSchedule(gWheel, START + 5, 0, (void*) i);
+
+    timerWheelAdvance(gWheel, START + 5, ^(void* const value, const bool) { spillingQueuePush(queue, value); });
+    assert(!timerWheelCount(gWheel) && spillingQueueSize(queue) == BURST && spillingQueueSpilled(queue) == BURST - CAPACITY);
+
+    static bool seen[BURST + 1];
+    long value;
+    int drained = 0;
+    for (; (value = (long) spillingQueuePop(queue)); drained++) {
+        assert(value >= 1 && value <= BURST && !seen[value]);
+        seen[value] = true;
+    }
+    assert(drained == BURST);
+
+    spillingQueueDestroy(queue);
+    timerWheelDestroy(gWheel);
+}
+
+static void destruction(void) {
+    gWheel = timerWheelCreate(0, xfree);
+    for (int i = 0; i < 100; i++)
+        timerWheelSchedule(gWheel, (unsigned long) xrand(1, MAX_DELAY), i % 2 ? 0 : xrand(1, 100), xmalloc(1));
+    timerWheelDestroy(gWheel); // the values are freed
+}
+
+void testUtilsTimerWheel(void) {
+    ordering();
+    exactness();
+    expiry();
+    periodic();
+    burst();
+    destruction();
+}